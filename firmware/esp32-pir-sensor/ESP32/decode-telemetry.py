@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Décodeur de télémétrie ESP32 (JSON ou MessagePack) pour le pipeline.
+
+Le firmware publie dans l'encodage choisi par le Device Twin (`encoding`)
+et déclare le format via les propriétés système IoT Hub :
+  - application/json (+ $.ce=utf-8) : JSON
+  - application/msgpack             : MessagePack
+
+Usage:
+  ./decode-telemetry.py --content-type application/msgpack message.bin
+  ./decode-telemetry.py --hex 85a474797065...        # corps en hexadécimal
+  az iot hub monitor-events ... --properties sys --output json | ./decode-telemetry.py --az
+
+Depuis Python : decode_body(body, content_type) -> dict
+Aucune dépendance : le sous-ensemble de MessagePack produit par
+ArduinoJson est décodé ici.
+"""
+
+import argparse
+import base64
+import json
+import struct
+import sys
+
+MSGPACK_TYPES = ("application/msgpack", "application/x-msgpack")
+
+
+class MsgPackError(ValueError):
+    pass
+
+
+class _Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, count):
+        if self.pos + count > len(self.data):
+            raise MsgPackError("message tronqué à l'octet %d" % self.pos)
+        chunk = self.data[self.pos:self.pos + count]
+        self.pos += count
+        return chunk
+
+    def unpack(self, fmt):
+        return struct.unpack(">" + fmt, self.take(struct.calcsize(">" + fmt)))[0]
+
+
+def _read_value(reader):
+    tag = reader.unpack("B")
+    if tag <= 0x7F:
+        return tag
+    if tag >= 0xE0:
+        return tag - 0x100
+    if 0x80 <= tag <= 0x8F:
+        return _read_map(reader, tag & 0x0F)
+    if 0x90 <= tag <= 0x9F:
+        return _read_array(reader, tag & 0x0F)
+    if 0xA0 <= tag <= 0xBF:
+        return reader.take(tag & 0x1F).decode("utf-8")
+
+    simple = {0xC0: None, 0xC2: False, 0xC3: True}
+    if tag in simple:
+        return simple[tag]
+    numbers = {0xCA: "f", 0xCB: "d", 0xCC: "B", 0xCD: "H", 0xCE: "I", 0xCF: "Q",
+               0xD0: "b", 0xD1: "h", 0xD2: "i", 0xD3: "q"}
+    if tag in numbers:
+        return reader.unpack(numbers[tag])
+    strings = {0xD9: "B", 0xDA: "H", 0xDB: "I"}
+    if tag in strings:
+        return reader.take(reader.unpack(strings[tag])).decode("utf-8")
+    binaries = {0xC4: "B", 0xC5: "H", 0xC6: "I"}
+    if tag in binaries:
+        return base64.b64encode(reader.take(reader.unpack(binaries[tag]))).decode("ascii")
+    if tag == 0xDC:
+        return _read_array(reader, reader.unpack("H"))
+    if tag == 0xDD:
+        return _read_array(reader, reader.unpack("I"))
+    if tag == 0xDE:
+        return _read_map(reader, reader.unpack("H"))
+    if tag == 0xDF:
+        return _read_map(reader, reader.unpack("I"))
+    raise MsgPackError("type MessagePack 0x%02x non supporté" % tag)
+
+
+def _read_array(reader, count):
+    return [_read_value(reader) for _ in range(count)]
+
+
+def _read_map(reader, count):
+    result = {}
+    for _ in range(count):
+        key = _read_value(reader)
+        result[key] = _read_value(reader)
+    return result
+
+
+def decode_msgpack(body):
+    reader = _Reader(bytes(body))
+    value = _read_value(reader)
+    if reader.pos != len(reader.data):
+        raise MsgPackError("%d octets en trop après le message" % (len(reader.data) - reader.pos))
+    return value
+
+
+def decode_body(body, content_type=None):
+    """Décode un corps de message selon son $.ct (JSON par défaut)."""
+    if isinstance(body, str):
+        body = body.encode("utf-8")
+    if content_type and content_type.split(";")[0].strip().lower() in MSGPACK_TYPES:
+        return decode_msgpack(body)
+    return json.loads(body.decode("utf-8"))
+
+
+def _decode_az_events(stream):
+    """Sortie JSON de `az iot hub monitor-events --properties sys`."""
+    text = stream.read().strip()
+    events = json.loads(text) if text.startswith("[") else [json.loads(line) for line in text.splitlines() if line]
+    for event in events:
+        event = event.get("event", event)
+        system = event.get("properties", {}).get("system", {})
+        content_type = system.get("content_type") or system.get("content-type")
+        payload = event.get("payload")
+        if isinstance(payload, (dict, list)):
+            yield payload
+        elif content_type in MSGPACK_TYPES:
+            # az ne sait pas afficher un corps binaire : encodé en latin-1 ou base64 selon la version
+            try:
+                yield decode_msgpack(payload.encode("latin-1"))
+            except (MsgPackError, UnicodeEncodeError):
+                yield decode_msgpack(base64.b64decode(payload))
+        else:
+            yield decode_body(payload, content_type)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Décode la télémétrie ESP32 (JSON ou MessagePack)")
+    parser.add_argument("input", nargs="?", help="fichier du corps du message (stdin par défaut)")
+    parser.add_argument("--content-type", default=None,
+                        help="valeur de $.ct (application/json ou application/msgpack)")
+    parser.add_argument("--hex", help="corps en hexadécimal (MessagePack)")
+    parser.add_argument("--az", action="store_true",
+                        help="lit la sortie JSON de az iot hub monitor-events --properties sys")
+    args = parser.parse_args()
+
+    if args.az:
+        for message in _decode_az_events(sys.stdin):
+            print(json.dumps(message, ensure_ascii=False))
+        return
+
+    if args.hex:
+        body = bytes.fromhex(args.hex)
+        content_type = args.content_type or MSGPACK_TYPES[0]
+    else:
+        stream = open(args.input, "rb") if args.input else sys.stdin.buffer
+        with stream:
+            body = stream.read()
+        content_type = args.content_type
+        if content_type is None and body[:1] not in (b"{", b"["):
+            content_type = MSGPACK_TYPES[0]
+
+    print(json.dumps(decode_body(body, content_type), indent=2, ensure_ascii=False))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,550 @@
+#!/usr/bin/env python3
+"""Générateur des encodeurs/décodeurs de messages à partir de messages.schema.json.
+
+Produit :
+  - include/message_schema.h    : structures, tailles de document constexpr,
+                                  encodeMessage()/decodeMessage() (firmware et backend),
+                                  égalité champ à champ (tests aller-retour)
+  - host/telemetry_decoder.h    : décodeur côté backend Linux (JSON ou MessagePack
+                                  selon $.ct, aiguillage sur "event")
+
+Usage:
+  ./generate-messages.py            # régénère les deux fichiers
+  ./generate-messages.py --check    # échoue si les fichiers générés ne sont pas à jour
+
+Types de champ : u8 u16 u32 u64 i8 i16 i32 f32 bool str, "object" (champs
+imbriqués), "list" (tableau borné par "max"), ou un nom de la section "types"
+(tuple codé en tableau, ex. [ts, sensor]). "optional": true ajoute un booléen
+hasXxx ; "maxLength" borne une chaîne reçue (taille de désérialisation).
+Les messages reçus par l'appareil ("direction": "c2d" ou "desired") ont en
+plus un filtre de désérialisation (buildXxxFilter) qui écarte tout le reste.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+SCHEMA = os.path.join(ROOT, "messages.schema.json")
+FIRMWARE_HEADER = os.path.join(ROOT, "include", "message_schema.h")
+HOST_HEADER = os.path.join(ROOT, "host", "telemetry_decoder.h")
+
+SCALARS = {
+    "u8": "uint8_t", "u16": "uint16_t", "u32": "uint32_t", "u64": "uint64_t",
+    "i8": "int8_t", "i16": "int16_t", "i32": "int32_t",
+    "f32": "float", "bool": "bool", "str": "const char*",
+}
+
+BANNER = "// Généré par generate-messages.py depuis messages.schema.json : ne pas modifier.\n"
+
+
+class SchemaError(ValueError):
+    pass
+
+
+def camel(name):
+    return "".join(part[:1].upper() + part[1:] for part in re.split(r"[_\s]+", name) if part)
+
+
+def constant(name):
+    return re.sub(r"(?<=[a-z0-9])(?=[A-Z])", "_", name).upper()
+
+
+class Struct:
+    """Structure C++ : message, objet imbriqué ou tuple."""
+
+    def __init__(self, name, fields, doc=None, event=None, tuple_=False, match=None, direction=None):
+        self.name = name
+        self.fields = fields
+        self.doc = doc
+        self.event = event
+        self.tuple = tuple_
+        self.match = match
+        self.direction = direction
+
+    @property
+    def const(self):
+        return constant(self.name)
+
+
+class Generator:
+    def __init__(self, schema):
+        self.schema = schema
+        self.structs = []           # Ordre de déclaration (dépendances d'abord)
+        self.tuples = {}
+        self.messages = []
+        for name, spec in schema.get("types", {}).items():
+            struct = Struct(name, spec["tuple"], spec.get("doc"), tuple_=True)
+            self.check_fields(struct)
+            self.tuples[name] = struct
+            self.structs.append(struct)
+        for name, spec in schema["messages"].items():
+            struct = self.add_object(camel(name) + "Message", camel(name), spec["fields"], spec.get("doc"))
+            struct.event = spec.get("event")
+            struct.match = spec.get("match")
+            struct.direction = spec.get("direction", "d2c")
+            struct.message = name
+            self.messages.append(struct)
+
+    def add_object(self, struct_name, prefix, fields, doc):
+        for field in fields:
+            if field["type"] == "object":
+                field["struct"] = self.add_object(prefix + camel(field["name"]), prefix + camel(field["name"]),
+                                                  field["fields"], field.get("doc"))
+        struct = Struct(struct_name, fields, doc)
+        self.check_fields(struct)
+        self.structs.append(struct)
+        return struct
+
+    def check_fields(self, struct):
+        names = set()
+        for field in struct.fields:
+            if field["name"] in names:
+                raise SchemaError("%s : champ %s en double" % (struct.name, field["name"]))
+            names.add(field["name"])
+            kind = field["type"]
+            if kind == "list":
+                if "max" not in field:
+                    raise SchemaError("%s.%s : liste sans \"max\"" % (struct.name, field["name"]))
+                item = field["of"]
+                if item not in SCALARS and item not in self.tuples:
+                    raise SchemaError("%s.%s : type d'élément %s inconnu" % (struct.name, field["name"], item))
+            elif kind not in SCALARS and kind != "object" and kind not in self.tuples:
+                raise SchemaError("%s.%s : type %s inconnu" % (struct.name, field["name"], kind))
+            if struct.tuple and (kind not in SCALARS or field.get("optional")):
+                raise SchemaError("%s : un tuple ne contient que des scalaires obligatoires" % struct.name)
+
+    # --- Tailles ---
+
+    def value_size(self, kind, field=None, parse=False):
+        """Contribution d'une valeur à la taille du document (hors emplacement)."""
+        suffix = "_PARSE_SIZE" if parse else "_DOC_SIZE"
+        if kind == "object":
+            return [field["struct"].const + suffix]
+        if kind in self.tuples:
+            return [self.tuples[kind].const + suffix]
+        if kind == "list":
+            terms = ["JSON_ARRAY_SIZE(%d)" % field["max"]]
+            item = self.value_size(field["of"], parse=parse)
+            if item:
+                terms.append("%d * (%s)" % (field["max"], " + ".join(item)))
+            return terms
+        if kind == "str" and parse:
+            return ["JSON_STRING_SIZE(%d)" % field.get("maxLength", 32)]
+        return []
+
+    def size_terms(self, struct, parse):
+        slots = len(struct.fields) + (1 if struct.event else 0)
+        terms = ["JSON_%s_SIZE(%d)" % ("ARRAY" if struct.tuple else "OBJECT", slots)]
+        if parse and not struct.tuple:
+            # Clés et valeur de "event" copiées par le désérialiseur
+            keys = [len(field["name"]) for field in struct.fields]
+            if struct.event:
+                keys += [len("event"), len(struct.event)]
+            terms += ["JSON_STRING_SIZE(%d)" % length for length in keys]
+        for field in struct.fields:
+            terms += self.value_size(field["type"], field, parse)
+        return terms
+
+    # --- firmware : include/message_schema.h ---
+
+    def cpp_type(self, kind, field=None):
+        if kind in SCALARS:
+            return SCALARS[kind]
+        if kind == "object":
+            return field["struct"].name
+        return self.tuples[kind].name
+
+    def emit_struct(self, out, struct):
+        out.append("")
+        if struct.doc:
+            out.append("// %s" % struct.doc)
+        out.append("struct %s {" % struct.name)
+        for field in struct.fields:
+            comment = "  // %s" % field["doc"] if field.get("doc") else ""
+            kind = field["type"]
+            if kind == "list":
+                out.append("  %s %s[%s_%s_MAX];%s" % (self.cpp_type(field["of"]), field["name"], struct.const,
+                                                      constant(field["name"]), comment))
+                out.append("  size_t %sCount = 0;" % field["name"])
+                continue
+            initial = {"bool": " = false", "str": " = nullptr"}.get(kind, " = 0" if kind in SCALARS else "")
+            out.append("  %s %s%s;%s" % (self.cpp_type(kind, field), field["name"], initial, comment))
+            if field.get("optional"):
+                out.append("  bool has%s = false;" % camel(field["name"]))
+        out.append("};")
+
+    def emit_sizes(self, out, struct):
+        for parse in (False, True):
+            terms = self.size_terms(struct, parse)
+            lines = ["constexpr size_t %s_%s_SIZE = " % (struct.const, "PARSE" if parse else "DOC")]
+            for term in terms:
+                if len(lines[-1]) + len(term) > 110 and not lines[-1].endswith("= "):
+                    lines[-1] = lines[-1].rstrip()
+                    lines.append("    ")
+                    lines[-1] += "+ " + term + " "
+                elif lines[-1].endswith("= "):
+                    lines[-1] += term + " "
+                else:
+                    lines[-1] += "+ " + term + " "
+            lines[-1] = lines[-1].rstrip() + ";"
+            out.extend(lines)
+
+    def emit_encoder(self, out, struct):
+        if struct.tuple:
+            out.append("inline void encodeValue(const %s& value, JsonArray array) {" % struct.name)
+            for field in struct.fields:
+                out.append("  array.add(value.%s);" % field["name"])
+            out.append("}")
+            return
+        out.append("inline void encodeValue(const %s& value, JsonObject object) {" % struct.name)
+        if struct.event:
+            out.append("  object[\"event\"] = \"%s\";" % struct.event)
+        for field in struct.fields:
+            name, kind = field["name"], field["type"]
+            indent = "  "
+            if field.get("optional"):
+                out.append("  if (value.has%s) {" % camel(name))
+                indent = "    "
+            if kind == "object":
+                out.append("%sencodeValue(value.%s, object.createNestedObject(\"%s\"));" % (indent, name, name))
+            elif kind in self.tuples:
+                out.append("%sencodeValue(value.%s, object.createNestedArray(\"%s\"));" % (indent, name, name))
+            elif kind == "list":
+                out.append("%sJsonArray %s = object.createNestedArray(\"%s\");" % (indent, name, name))
+                out.append("%sfor (size_t i = 0; i < value.%sCount; i++) {" % (indent, name))
+                if field["of"] in self.tuples:
+                    out.append("%s  encodeValue(value.%s[i], %s.createNestedArray());" % (indent, name, name))
+                else:
+                    out.append("%s  %s.add(value.%s[i]);" % (indent, name, name))
+                out.append("%s}" % indent)
+            else:
+                out.append("%sobject[\"%s\"] = value.%s;" % (indent, name, name))
+            if field.get("optional"):
+                out.append("  }")
+        out.append("}")
+
+    def emit_decoder(self, out, struct):
+        if struct.tuple:
+            out.append("inline bool decodeValue(JsonVariantConst variant, %s& value) {" % struct.name)
+            out.append("  JsonArrayConst array = variant.as<JsonArrayConst>();")
+            out.append("  return variant.is<JsonArrayConst>() && array.size() == %d &&" % len(struct.fields))
+            reads = ["decodeValue(array[%d], value.%s)" % (i, f["name"]) for i, f in enumerate(struct.fields)]
+            out.append("         " + " &&\n         ".join(reads) + ";")
+            out.append("}")
+            return
+        out.append("inline bool decodeValue(JsonVariantConst variant, %s& value) {" % struct.name)
+        out.append("  if (!variant.is<JsonObjectConst>()) {")
+        out.append("    return false;")
+        out.append("  }")
+        out.append("  JsonObjectConst object = variant.as<JsonObjectConst>();")
+        if struct.event:
+            out.append("  if (object[\"event\"] != \"%s\") {" % struct.event)
+            out.append("    return false;")
+            out.append("  }")
+        for field in struct.fields:
+            name = field["name"]
+            if field["type"] == "list":
+                call = "decodeList(object[\"%s\"], value.%s, value.%sCount)" % (name, name, name)
+            else:
+                call = "decodeValue(object[\"%s\"], value.%s)" % (name, name)
+            if field.get("optional"):
+                call = "decodeOptional(object[\"%s\"], value.%s, value.has%s)" % (name, name, camel(name))
+            out.append("  if (!%s) {" % call)
+            out.append("    return false;")
+            out.append("  }")
+        out.append("  return true;")
+        out.append("}")
+
+    def emit_equality(self, out, struct):
+        out.append("inline bool operator==(const %s& a, const %s& b) {" % (struct.name, struct.name))
+        checks = []
+        for field in struct.fields:
+            name = field["name"]
+            if field["type"] == "list":
+                checks.append("sameList(a.%s, a.%sCount, b.%s, b.%sCount)" % (name, name, name, name))
+            elif field.get("optional"):
+                flag = "has" + camel(name)
+                checks.append("a.%s == b.%s" % (flag, flag))
+                checks.append("(!a.%s || sameValue(a.%s, b.%s))" % (flag, name, name))
+            else:
+                checks.append("sameValue(a.%s, b.%s)" % (name, name))
+        out.append("  return " + " &&\n         ".join(checks or ["true"]) + ";")
+        out.append("}")
+        out.append("")
+        out.append("inline bool operator!=(const %s& a, const %s& b) {" % (struct.name, struct.name))
+        out.append("  return !(a == b);")
+        out.append("}")
+
+    def filter_terms(self, struct):
+        terms = ["JSON_OBJECT_SIZE(%d)" % len(struct.fields)]
+        for field in struct.fields:
+            if field["type"] == "object":
+                terms += self.filter_terms(field["struct"])
+        return terms
+
+    def emit_filter_fields(self, out, struct, target, indent):
+        for field in struct.fields:
+            if field["type"] == "object":
+                nested = field["name"] + "Filter"
+                out.append("%sJsonObject %s = %s.createNestedObject(\"%s\");" % (indent, nested, target, field["name"]))
+                self.emit_filter_fields(out, field["struct"], nested, indent)
+            else:
+                out.append("%s%s[\"%s\"] = true;" % (indent, target, field["name"]))
+
+    def emit_filter(self, out, struct):
+        out.append("constexpr size_t %s_FILTER_SIZE = %s;" % (struct.const, " + ".join(self.filter_terms(struct))))
+        out.append("inline void build%sFilter(JsonObject filter) {" % camel(struct.message))
+        self.emit_filter_fields(out, struct, "filter", "  ")
+        out.append("}")
+
+    def firmware_header(self):
+        out = ["#pragma once", "", BANNER.rstrip(), "", "#include <ArduinoJson.h>", "#include <stddef.h>",
+               "#include <stdint.h>", "#include <string.h>", ""]
+        out.append("// === MESSAGES (messages.schema.json) ===")
+        out.append("// Une structure par message ; encodeMessage() remplit un document à")
+        out.append("// sérialiser en JSON ou en MessagePack, decodeMessage() vérifie types et")
+        out.append("// champs obligatoires. Les chaînes ne sont pas copiées : elles pointent")
+        out.append("// vers les données de l'appelant (encodage) ou du document (décodage).")
+        out.append("// XXX_DOC_SIZE : capacité pour encoder (toutes options présentes).")
+        out.append("// XXX_PARSE_SIZE : capacité pour désérialiser (clés et chaînes copiées) ;")
+        out.append("// XXX_DOC_SIZE suffit pour une désérialisation en place (char* modifiable).")
+        for struct in self.structs:
+            for field in struct.fields:
+                if field["type"] == "list":
+                    out.append("")
+                    out.append("constexpr size_t %s_%s_MAX = %d;" % (struct.const, constant(field["name"]), field["max"]))
+        for struct in self.structs:
+            self.emit_struct(out, struct)
+        out.append("")
+        out.append("// === CAPACITÉS DES DOCUMENTS ===")
+        for struct in self.structs:
+            out.append("")
+            self.emit_sizes(out, struct)
+        out.append("")
+        out.append("// === ENCODAGE ===")
+        for struct in self.structs:
+            out.append("")
+            self.emit_encoder(out, struct)
+        for struct in self.messages:
+            out.append("")
+            out.append("// false si le document est trop petit")
+            out.append("inline bool encodeMessage(const %s& message, JsonDocument& doc) {" % struct.name)
+            out.append("  encodeValue(message, doc.to<JsonObject>());")
+            out.append("  return !doc.overflowed();")
+            out.append("}")
+        inbound = [m for m in self.messages if m.direction != "d2c"]
+        if inbound:
+            out.append("")
+            out.append("// === FILTRES DE DÉSÉRIALISATION ===")
+            out.append("// À passer à DeserializationOption::Filter : seuls les champs du schéma")
+            out.append("// sont gardés ($version, métadonnées et champs inconnus n'occupent rien).")
+            for struct in inbound:
+                out.append("")
+                self.emit_filter(out, struct)
+        out.append("")
+        out.append("// === DÉCODAGE ===")
+        out.append("")
+        out.append("template <typename T>")
+        out.append("inline bool decodeValue(JsonVariantConst variant, T& value) {")
+        out.append("  if (!variant.is<T>()) {")
+        out.append("    return false;")
+        out.append("  }")
+        out.append("  value = variant.as<T>();")
+        out.append("  return true;")
+        out.append("}")
+        out.append("")
+        out.append("// Champ facultatif : absent, ou présent et valide")
+        out.append("template <typename T>")
+        out.append("inline bool decodeOptional(JsonVariantConst variant, T& value, bool& present) {")
+        out.append("  present = !variant.isNull();")
+        out.append("  return !present || decodeValue(variant, value);")
+        out.append("}")
+        out.append("")
+        out.append("template <typename T, size_t N>")
+        out.append("inline bool decodeList(JsonVariantConst variant, T (&items)[N], size_t& count) {")
+        out.append("  JsonArrayConst array = variant.as<JsonArrayConst>();")
+        out.append("  if (!variant.is<JsonArrayConst>() || array.size() > N) {")
+        out.append("    return false;")
+        out.append("  }")
+        out.append("  count = 0;")
+        out.append("  for (JsonVariantConst item : array) {")
+        out.append("    if (!decodeValue(item, items[count++])) {")
+        out.append("      return false;")
+        out.append("    }")
+        out.append("  }")
+        out.append("  return true;")
+        out.append("}")
+        for struct in self.structs:
+            out.append("")
+            self.emit_decoder(out, struct)
+        for struct in self.messages:
+            out.append("")
+            out.append("inline bool decodeMessage(JsonObjectConst object, %s& message) {" % struct.name)
+            out.append("  message = %s();" % struct.name)
+            out.append("  return decodeValue(object, message);")
+            out.append("}")
+        out.append("")
+        out.append("// === COMPARAISON ===")
+        out.append("// Égalité champ à champ, pour vérifier un aller-retour encodage → décodage :")
+        out.append("// un champ facultatif absent n'est pas comparé, une chaîne l'est par contenu.")
+        out.append("")
+        out.append("template <typename T>")
+        out.append("inline bool sameValue(const T& a, const T& b) {")
+        out.append("  return a == b;")
+        out.append("}")
+        out.append("")
+        out.append("inline bool sameValue(const char* a, const char* b) {")
+        out.append("  return a == b || (a != nullptr && b != nullptr && strcmp(a, b) == 0);")
+        out.append("}")
+        out.append("")
+        out.append("template <typename T, size_t N>")
+        out.append("inline bool sameList(const T (&a)[N], size_t aCount, const T (&b)[N], size_t bCount) {")
+        out.append("  if (aCount != bCount) {")
+        out.append("    return false;")
+        out.append("  }")
+        out.append("  for (size_t i = 0; i < aCount; i++) {")
+        out.append("    if (!sameValue(a[i], b[i])) {")
+        out.append("      return false;")
+        out.append("    }")
+        out.append("  }")
+        out.append("  return true;")
+        out.append("}")
+        for struct in self.structs:
+            out.append("")
+            self.emit_equality(out, struct)
+        return "\n".join(out) + "\n"
+
+    # --- backend : host/telemetry_decoder.h ---
+
+    def host_header(self):
+        telemetry = [m for m in self.messages if m.event and m.direction == "d2c"]
+        # Les messages discriminés par un champ ("match") sont testés en premier
+        dispatch = sorted(telemetry, key=lambda m: 0 if m.match else 1)
+        twin = [m for m in self.messages if not m.event and m.direction == "d2c"]
+
+        out = ["#pragma once", "", BANNER.rstrip(), "", "#include <ArduinoJson.h>", "#include <string.h>", "",
+               "#include \"../include/message_schema.h\"", ""]
+        out.append("// === DÉCODEUR DE TÉLÉMÉTRIE (BACKEND) ===")
+        out.append("// Désérialise un corps de message IoT Hub selon son $.ct (MessagePack ou")
+        out.append("// JSON) puis le range dans la structure de son \"event\". Les chaînes des")
+        out.append("// structures pointent dans le document du décodeur : elles restent valides")
+        out.append("// jusqu'au décodage suivant. Un statut delta (\"delta\": true) ne porte")
+        out.append("// que les champs modifiés : il est exposé tel quel via object().")
+        out.append("")
+        out.append("enum TelemetryKind {")
+        out.append("  TELEMETRY_INVALID,       // Corps illisible ou champs manquants")
+        for struct in telemetry:
+            out.append("  TELEMETRY_%s," % constant(camel(struct.message)))
+        out.append("  TELEMETRY_STATUS_DELTA,")
+        out.append("  TELEMETRY_UNKNOWN        // \"event\" inconnu (document lisible via object())")
+        out.append("};")
+        out.append("")
+        out.append("constexpr size_t maxParseSize(size_t a, size_t b) { return a > b ? a : b; }")
+        sizes = ["%s_PARSE_SIZE" % struct.const for struct in telemetry + twin]
+        expression = sizes[-1]
+        for size in reversed(sizes[:-1]):
+            expression = "maxParseSize(%s,\n    %s)" % (size, expression)
+        out.append("constexpr size_t TELEMETRY_PARSE_SIZE =\n    %s;" % expression)
+        out.append("")
+        out.append("inline bool isMsgPackContentType(const char* contentType) {")
+        out.append("  return contentType != nullptr && (strncmp(contentType, \"application/msgpack\", 19) == 0 ||")
+        out.append("                                    strncmp(contentType, \"application/x-msgpack\", 21) == 0);")
+        out.append("}")
+        out.append("")
+        out.append("class TelemetryDecoder {")
+        out.append(" public:")
+        out.append("  TelemetryDecoder() : doc_(TELEMETRY_PARSE_SIZE) {}")
+        out.append("")
+        out.append("  // contentType : valeur de $.ct (JSON si nullptr)")
+        out.append("  TelemetryKind decode(const char* contentType, const void* body, size_t length) {")
+        out.append("    if (!parse(contentType, body, length)) {")
+        out.append("      return TELEMETRY_INVALID;")
+        out.append("    }")
+        out.append("    JsonObjectConst object = doc_.as<JsonObjectConst>();")
+        out.append("    const char* event = object[\"event\"];")
+        out.append("    if (event == nullptr) {")
+        out.append("      return TELEMETRY_INVALID;")
+        out.append("    }")
+        out.append("    if (strcmp(event, \"status\") == 0 && object[\"delta\"] == true) {")
+        out.append("      return TELEMETRY_STATUS_DELTA;")
+        out.append("    }")
+        for struct in dispatch:
+            kind = "TELEMETRY_%s" % constant(camel(struct.message))
+            condition = "strcmp(event, \"%s\") == 0" % struct.event
+            if struct.match:
+                condition += " && object.containsKey(\"%s\")" % struct.match
+            out.append("    if (%s) {" % condition)
+            out.append("      return decodeMessage(object, %s) ? %s : TELEMETRY_INVALID;" % (self.member(struct), kind))
+            out.append("    }")
+        out.append("    return TELEMETRY_UNKNOWN;")
+        out.append("  }")
+        for struct in twin:
+            out.append("")
+            out.append("  // Propriétés reported lues depuis le Device Twin (JSON)")
+            out.append("  bool decode%s(const void* body, size_t length) {" % camel(struct.message))
+            out.append("    return parse(nullptr, body, length) && decodeMessage(doc_.as<JsonObjectConst>(), %s);"
+                       % self.member(struct))
+            out.append("  }")
+        out.append("")
+        out.append("  JsonObjectConst object() const { return doc_.as<JsonObjectConst>(); }")
+        out.append("")
+        for struct in telemetry + twin:
+            out.append("  %s %s;" % (struct.name, self.member(struct)))
+        out.append("")
+        out.append(" private:")
+        out.append("  bool parse(const char* contentType, const void* body, size_t length) {")
+        out.append("    DeserializationError error = isMsgPackContentType(contentType)")
+        out.append("                                     ? deserializeMsgPack(doc_, (const char*)body, length)")
+        out.append("                                     : deserializeJson(doc_, (const char*)body, length);")
+        out.append("    return !error && doc_.is<JsonObjectConst>();")
+        out.append("  }")
+        out.append("")
+        out.append("  DynamicJsonDocument doc_;")
+        out.append("};")
+        return "\n".join(out) + "\n"
+
+    @staticmethod
+    def member(struct):
+        name = camel(struct.message)
+        return name[:1].lower() + name[1:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Génère les encodeurs/décodeurs de messages")
+    parser.add_argument("--check", action="store_true", help="vérifie que les fichiers générés sont à jour")
+    args = parser.parse_args()
+
+    with open(SCHEMA, encoding="utf-8") as stream:
+        generator = Generator(json.load(stream))
+    outputs = {FIRMWARE_HEADER: generator.firmware_header(), HOST_HEADER: generator.host_header()}
+
+    stale = []
+    for path, content in outputs.items():
+        current = None
+        if os.path.exists(path):
+            with open(path, encoding="utf-8") as stream:
+                current = stream.read()
+        if current == content:
+            continue
+        stale.append(os.path.relpath(path, ROOT))
+        if not args.check:
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, "w", encoding="utf-8") as stream:
+                stream.write(content)
+
+    if args.check and stale:
+        print("Fichiers à régénérer (./generate-messages.py) : %s" % ", ".join(stale), file=sys.stderr)
+        sys.exit(1)
+    for path in stale:
+        print("%s généré" % path)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except SchemaError as error:
+        print("messages.schema.json : %s" % error, file=sys.stderr)
+        sys.exit(1)
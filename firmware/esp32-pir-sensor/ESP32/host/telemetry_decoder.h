@@ -0,0 +1,94 @@
+#pragma once
+
+// Généré par generate-messages.py depuis messages.schema.json : ne pas modifier.
+
+#include <ArduinoJson.h>
+#include <string.h>
+
+#include "../include/message_schema.h"
+
+// === DÉCODEUR DE TÉLÉMÉTRIE (BACKEND) ===
+// Désérialise un corps de message IoT Hub selon son $.ct (MessagePack ou
+// JSON) puis le range dans la structure de son "event". Les chaînes des
+// structures pointent dans le document du décodeur : elles restent valides
+// jusqu'au décodage suivant. Un statut delta ("delta": true) ne porte
+// que les champs modifiés : il est exposé tel quel via object().
+
+enum TelemetryKind {
+  TELEMETRY_INVALID,       // Corps illisible ou champs manquants
+  TELEMETRY_MOTION,
+  TELEMETRY_MOTION_BATCH,
+  TELEMETRY_SESSION,
+  TELEMETRY_STATUS,
+  TELEMETRY_STATUS_DELTA,
+  TELEMETRY_UNKNOWN        // "event" inconnu (document lisible via object())
+};
+
+constexpr size_t maxParseSize(size_t a, size_t b) { return a > b ? a : b; }
+constexpr size_t TELEMETRY_PARSE_SIZE =
+    maxParseSize(MOTION_MESSAGE_PARSE_SIZE,
+    maxParseSize(MOTION_BATCH_MESSAGE_PARSE_SIZE,
+    maxParseSize(SESSION_MESSAGE_PARSE_SIZE,
+    maxParseSize(STATUS_MESSAGE_PARSE_SIZE,
+    TWIN_REPORTED_MESSAGE_PARSE_SIZE))));
+
+inline bool isMsgPackContentType(const char* contentType) {
+  return contentType != nullptr && (strncmp(contentType, "application/msgpack", 19) == 0 ||
+                                    strncmp(contentType, "application/x-msgpack", 21) == 0);
+}
+
+class TelemetryDecoder {
+ public:
+  TelemetryDecoder() : doc_(TELEMETRY_PARSE_SIZE) {}
+
+  // contentType : valeur de $.ct (JSON si nullptr)
+  TelemetryKind decode(const char* contentType, const void* body, size_t length) {
+    if (!parse(contentType, body, length)) {
+      return TELEMETRY_INVALID;
+    }
+    JsonObjectConst object = doc_.as<JsonObjectConst>();
+    const char* event = object["event"];
+    if (event == nullptr) {
+      return TELEMETRY_INVALID;
+    }
+    if (strcmp(event, "status") == 0 && object["delta"] == true) {
+      return TELEMETRY_STATUS_DELTA;
+    }
+    if (strcmp(event, "motion") == 0 && object.containsKey("detections")) {
+      return decodeMessage(object, motionBatch) ? TELEMETRY_MOTION_BATCH : TELEMETRY_INVALID;
+    }
+    if (strcmp(event, "motion") == 0) {
+      return decodeMessage(object, motion) ? TELEMETRY_MOTION : TELEMETRY_INVALID;
+    }
+    if (strcmp(event, "session") == 0) {
+      return decodeMessage(object, session) ? TELEMETRY_SESSION : TELEMETRY_INVALID;
+    }
+    if (strcmp(event, "status") == 0) {
+      return decodeMessage(object, status) ? TELEMETRY_STATUS : TELEMETRY_INVALID;
+    }
+    return TELEMETRY_UNKNOWN;
+  }
+
+  // Propriétés reported lues depuis le Device Twin (JSON)
+  bool decodeTwinReported(const void* body, size_t length) {
+    return parse(nullptr, body, length) && decodeMessage(doc_.as<JsonObjectConst>(), twinReported);
+  }
+
+  JsonObjectConst object() const { return doc_.as<JsonObjectConst>(); }
+
+  MotionMessage motion;
+  MotionBatchMessage motionBatch;
+  SessionMessage session;
+  StatusMessage status;
+  TwinReportedMessage twinReported;
+
+ private:
+  bool parse(const char* contentType, const void* body, size_t length) {
+    DeserializationError error = isMsgPackContentType(contentType)
+                                     ? deserializeMsgPack(doc_, (const char*)body, length)
+                                     : deserializeJson(doc_, (const char*)body, length);
+    return !error && doc_.is<JsonObjectConst>();
+  }
+
+  DynamicJsonDocument doc_;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdint.h>
+
+// === COOLDOWN ADAPTATIF ===
+// Suit les intervalles entre détections candidates (acceptées ou refusées
+// par le cooldown) : moyenne exponentielle (EWMA) et quantiles p50/p90
+// estimés en ligne. Le cooldown effectif est choisi pour que l'intervalle
+// entre deux publications (≈ cooldown + attente du candidat suivant) ne
+// descende pas sous 3600 s / budget.
+//
+// Le cooldown s'applique à chaque capteur séparément : le budget est
+// partagé entre les capteurs actifs sur la dernière heure. Un silence plus
+// long que l'écart typique compte comme un écart observé, si bien que le
+// cooldown redescend sans attendre le candidat suivant (update() est
+// appelé périodiquement par loop()).
+
+class AdaptiveCooldown {
+ public:
+  // Un début de mouvement candidat vient d'être vu
+  void onCandidate(uint8_t sensor, uint64_t nowUs) {
+    rotateSensors(nowUs);
+    sensorMask_ |= 1UL << sensor;
+
+    if (lastCandidateUs_ != 0 && nowUs > lastCandidateUs_) {
+      float intervalMs = (float)(nowUs - lastCandidateUs_) / 1000.0f;
+      if (samples_ == 0) {
+        ewmaMs_ = intervalMs;
+        p50Ms_ = intervalMs;
+        p90Ms_ = intervalMs;
+      } else {
+        ewmaMs_ += EWMA_ALPHA * (intervalMs - ewmaMs_);
+        updateQuantile(p50Ms_, intervalMs, 0.5f);
+        updateQuantile(p90Ms_, intervalMs, 0.9f);
+      }
+      if (samples_ < UINT32_MAX) {
+        samples_++;
+      }
+    }
+    lastCandidateUs_ = nowUs;
+  }
+
+  // Recalcule le cooldown effectif (ms). budgetPerHour = 0 : cooldown configuré.
+  uint32_t update(uint64_t nowUs, uint32_t configuredMs, uint32_t budgetPerHour, uint32_t maxMs) {
+    rotateSensors(nowUs);
+    uint32_t target = configuredMs;
+
+    if (budgetPerHour > 0 && samples_ >= MIN_SAMPLES) {
+      uint32_t sensors = activeSensors();
+      float intervalMs = 3600000.0f / (float)budgetPerHour;
+      // Écart typique entre candidats : p50 résiste mieux aux rafales
+      float typicalGapMs = p50Ms_ < ewmaMs_ ? p50Ms_ : ewmaMs_;
+      float silenceMs = nowUs > lastCandidateUs_ ? (float)(nowUs - lastCandidateUs_) / 1000.0f : 0.0f;
+      if (silenceMs > typicalGapMs) {
+        typicalGapMs = silenceMs;
+      }
+      // Chaque capteur voit en moyenne un candidat sur `sensors` et doit
+      // tenir budget / sensors messages par heure
+      float needed = (float)sensors * (intervalMs - typicalGapMs);
+      if (needed > (float)target) {
+        target = needed > (float)maxMs ? maxMs : (uint32_t)needed;
+      }
+    }
+
+    // Montée immédiate, descente progressive pour éviter les oscillations
+    if (target >= effectiveMs_ || effectiveMs_ == 0) {
+      effectiveMs_ = target;
+    } else {
+      effectiveMs_ -= (effectiveMs_ - target) / 4 + 1;
+      if (effectiveMs_ < target) {
+        effectiveMs_ = target;
+      }
+    }
+    return effectiveMs_;
+  }
+
+  // Capteurs ayant produit un candidat sur la dernière heure (au moins 1)
+  uint32_t activeSensors() const {
+    uint32_t count = (uint32_t)__builtin_popcount(sensorMask_ | previousSensorMask_);
+    return count > 0 ? count : 1;
+  }
+
+  void reset() {
+    lastCandidateUs_ = 0;
+    samples_ = 0;
+    ewmaMs_ = p50Ms_ = p90Ms_ = 0.0f;
+    effectiveMs_ = 0;
+    sensorMask_ = previousSensorMask_ = 0;
+    sensorWindowStartUs_ = 0;
+  }
+
+  uint32_t effectiveMs() const { return effectiveMs_; }
+  float ewmaIntervalMs() const { return ewmaMs_; }
+  float p50IntervalMs() const { return p50Ms_; }
+  float p90IntervalMs() const { return p90Ms_; }
+  uint32_t samples() const { return samples_; }
+
+ private:
+  static constexpr float EWMA_ALPHA = 0.1f;
+  static constexpr float QUANTILE_GAIN = 0.05f;
+  static constexpr uint32_t MIN_SAMPLES = 4;
+  static constexpr uint64_t SENSOR_WINDOW_US = 3600000000ULL;
+
+  // Deux fenêtres d'une heure : un capteur reste compté entre 1 et 2 h
+  void rotateSensors(uint64_t nowUs) {
+    if (nowUs - sensorWindowStartUs_ < SENSOR_WINDOW_US) {
+      return;
+    }
+    bool skipped = nowUs - sensorWindowStartUs_ >= 2 * SENSOR_WINDOW_US;
+    previousSensorMask_ = skipped ? 0 : sensorMask_;
+    sensorMask_ = 0;
+    sensorWindowStartUs_ = nowUs;
+  }
+
+  // Approximation stochastique : q avance de gain·p si x > q,
+  // recule de gain·(1-p) sinon, avec un pas à l'échelle de la moyenne
+  void updateQuantile(float& q, float x, float p) {
+    float step = QUANTILE_GAIN * (ewmaMs_ > 10.0f ? ewmaMs_ : 10.0f);
+    if (x > q) {
+      q += step * p;
+    } else {
+      q -= step * (1.0f - p);
+    }
+    if (q < 0.0f) {
+      q = 0.0f;
+    }
+  }
+
+  uint64_t lastCandidateUs_ = 0;
+  uint32_t samples_ = 0;
+  float ewmaMs_ = 0.0f;
+  float p50Ms_ = 0.0f;
+  float p90Ms_ = 0.0f;
+  uint32_t effectiveMs_ = 0;
+  uint32_t sensorMask_ = 0;
+  uint32_t previousSensorMask_ = 0;
+  uint64_t sensorWindowStartUs_ = 0;
+};
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// === PIPELINE DE FILTRAGE DES DÉTECTIONS ===
+// Chaîne d'étages assemblée à la compilation :
+//
+//   DetectionPipeline<N, Params, DebounceStage, CooldownStage> p(...);
+//
+// Chaque étage reçoit les transitions d'un capteur (PirSignal), peut les
+// laisser passer, les bloquer ou les différer. La fin de chaîne est un
+// verrou qui transforme les fronts en début/fin de mouvement.
+// Les appels étant résolus statiquement, le compilateur met tout en ligne.
+//
+// Params est soit FixedDetectionParams<...> (constantes de compilation),
+// soit DetectionParams (modifiable à l'exécution, ex. depuis le Device Twin).
+//
+// Ordre conseillé : Debounce → Hysteresis → MinPulseWidth → RetriggerMerge
+// → Cooldown. CooldownStage doit rester le dernier étage : il considère
+// qu'un front montant qu'il laisse passer démarre un mouvement.
+
+enum PirEvent {
+  PIR_EVENT_NONE,
+  PIR_EVENT_MOTION_START,
+  PIR_EVENT_MOTION_END,
+  PIR_EVENT_COOLDOWN_REJECTED,
+  PIR_EVENT_RETRIGGER
+};
+
+struct PirSignal {
+  uint8_t sensor;
+  bool level;
+  uint64_t timestampUs;
+};
+
+// Paramètres modifiables à l'exécution (0 = étage transparent)
+struct DetectionParams {
+  uint32_t debounceUs = 500000;
+  uint32_t cooldownUs = 5000000;
+  uint32_t minPulseUs = 0;
+  uint32_t riseHoldUs = 0;
+  uint32_t fallHoldUs = 0;
+  uint32_t mergeUs = 0;
+};
+
+// Paramètres figés à la compilation
+template <uint32_t DebounceUs, uint32_t CooldownUs, uint32_t MinPulseUs = 0,
+          uint32_t RiseHoldUs = 0, uint32_t FallHoldUs = 0, uint32_t MergeUs = 0>
+struct FixedDetectionParams {
+  static constexpr uint32_t debounceUs = DebounceUs;
+  static constexpr uint32_t cooldownUs = CooldownUs;
+  static constexpr uint32_t minPulseUs = MinPulseUs;
+  static constexpr uint32_t riseHoldUs = RiseHoldUs;
+  static constexpr uint32_t fallHoldUs = FallHoldUs;
+  static constexpr uint32_t mergeUs = MergeUs;
+};
+
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D, uint32_t E, uint32_t F>
+constexpr uint32_t FixedDetectionParams<A, B, C, D, E, F>::debounceUs;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D, uint32_t E, uint32_t F>
+constexpr uint32_t FixedDetectionParams<A, B, C, D, E, F>::cooldownUs;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D, uint32_t E, uint32_t F>
+constexpr uint32_t FixedDetectionParams<A, B, C, D, E, F>::minPulseUs;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D, uint32_t E, uint32_t F>
+constexpr uint32_t FixedDetectionParams<A, B, C, D, E, F>::riseHoldUs;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D, uint32_t E, uint32_t F>
+constexpr uint32_t FixedDetectionParams<A, B, C, D, E, F>::fallHoldUs;
+template <uint32_t A, uint32_t B, uint32_t C, uint32_t D, uint32_t E, uint32_t F>
+constexpr uint32_t FixedDetectionParams<A, B, C, D, E, F>::mergeUs;
+
+// --------------------------------------------
+// ÉTAGES
+// Interface : onEdge() renvoie true pour transmettre le signal à l'étage
+// suivant ; poll() renvoie true tant qu'un signal différé est prêt.
+// --------------------------------------------
+
+// Ignore un front trop proche du précédent (même ignoré)
+template <size_t N>
+class DebounceStage {
+ public:
+  template <class Params, class Sink>
+  bool onEdge(const PirSignal& s, const Params& p, uint32_t, Sink&) {
+    bool pass = (s.timestampUs - lastEdgeUs_[s.sensor]) > p.debounceUs;
+    lastEdgeUs_[s.sensor] = s.timestampUs;
+    return pass;
+  }
+
+  template <class Params>
+  bool poll(uint64_t, const Params&, PirSignal&) { return false; }
+
+  uint64_t nextDeadlineUs() const { return UINT64_MAX; }
+  void clearPending() {}
+
+ private:
+  uint64_t lastEdgeUs_[N] = {};
+};
+
+// Seuils asymétriques : niveau bas tenu riseHoldUs avant un front montant,
+// niveau haut tenu fallHoldUs avant un front descendant
+template <size_t N>
+class HysteresisStage {
+ public:
+  template <class Params, class Sink>
+  bool onEdge(const PirSignal& s, const Params& p, uint32_t, Sink&) {
+    uint32_t hold = s.level ? p.riseHoldUs : p.fallHoldUs;
+    bool pass = (s.timestampUs - lastEdgeUs_[s.sensor]) >= hold;
+    lastEdgeUs_[s.sensor] = s.timestampUs;
+    return pass;
+  }
+
+  template <class Params>
+  bool poll(uint64_t, const Params&, PirSignal&) { return false; }
+
+  uint64_t nextDeadlineUs() const { return UINT64_MAX; }
+  void clearPending() {}
+
+ private:
+  uint64_t lastEdgeUs_[N] = {};
+};
+
+// Un front montant n'est transmis que si le niveau haut dure minPulseUs
+template <size_t N>
+class MinPulseWidthStage {
+ public:
+  template <class Params, class Sink>
+  bool onEdge(const PirSignal& s, const Params& p, uint32_t, Sink&) {
+    uint32_t bit = 1UL << s.sensor;
+    if (s.level) {
+      if (p.minPulseUs == 0) {
+        return true;
+      }
+      pendingMask_ |= bit;
+      riseUs_[s.sensor] = s.timestampUs;
+      deadlineUs_ = earliest(p);
+      return false;
+    }
+    if (pendingMask_ & bit) {
+      // Impulsion trop courte : le front montant et le descendant disparaissent
+      pendingMask_ &= ~bit;
+      deadlineUs_ = earliest(p);
+      return false;
+    }
+    return true;
+  }
+
+  template <class Params>
+  bool poll(uint64_t nowUs, const Params& p, PirSignal& out) {
+    if (nowUs < deadlineUs_) {
+      return false;
+    }
+    uint32_t pending = pendingMask_;
+    while (pending) {
+      uint8_t i = (uint8_t)__builtin_ctz(pending);
+      pending &= pending - 1;
+      if (nowUs - riseUs_[i] >= p.minPulseUs) {
+        pendingMask_ &= ~(1UL << i);
+        deadlineUs_ = earliest(p);
+        out.sensor = i;
+        out.level = true;
+        out.timestampUs = riseUs_[i];
+        return true;
+      }
+    }
+    deadlineUs_ = earliest(p);
+    return false;
+  }
+
+  uint64_t nextDeadlineUs() const { return deadlineUs_; }
+
+  void clearPending() {
+    pendingMask_ = 0;
+    deadlineUs_ = UINT64_MAX;
+  }
+
+ private:
+  template <class Params>
+  uint64_t earliest(const Params& p) const {
+    uint64_t deadline = UINT64_MAX;
+    uint32_t pending = pendingMask_;
+    while (pending) {
+      uint8_t i = (uint8_t)__builtin_ctz(pending);
+      pending &= pending - 1;
+      uint64_t d = riseUs_[i] + p.minPulseUs;
+      if (d < deadline) {
+        deadline = d;
+      }
+    }
+    return deadline;
+  }
+
+  uint64_t riseUs_[N] = {};
+  uint32_t pendingMask_ = 0;
+  uint64_t deadlineUs_ = UINT64_MAX;
+};
+
+// Un front descendant est retenu mergeUs : si le capteur se redéclenche
+// entre-temps, le mouvement continue (PIR_EVENT_RETRIGGER) au lieu de
+// produire une fin puis un nouveau début
+template <size_t N>
+class RetriggerMergeStage {
+ public:
+  template <class Params, class Sink>
+  bool onEdge(const PirSignal& s, const Params& p, uint32_t motionMask, Sink& sink) {
+    uint32_t bit = 1UL << s.sensor;
+    if (!s.level) {
+      if (p.mergeUs == 0 || !(motionMask & bit)) {
+        return true;
+      }
+      pendingMask_ |= bit;
+      fallUs_[s.sensor] = s.timestampUs;
+      deadlineUs_ = earliest(p);
+      return false;
+    }
+    if (pendingMask_ & bit) {
+      pendingMask_ &= ~bit;
+      deadlineUs_ = earliest(p);
+      sink(s.sensor, PIR_EVENT_RETRIGGER, s.timestampUs, (uint64_t)0);
+      return false;
+    }
+    return true;
+  }
+
+  template <class Params>
+  bool poll(uint64_t nowUs, const Params& p, PirSignal& out) {
+    if (nowUs < deadlineUs_) {
+      return false;
+    }
+    uint32_t pending = pendingMask_;
+    while (pending) {
+      uint8_t i = (uint8_t)__builtin_ctz(pending);
+      pending &= pending - 1;
+      if (nowUs - fallUs_[i] >= p.mergeUs) {
+        pendingMask_ &= ~(1UL << i);
+        deadlineUs_ = earliest(p);
+        out.sensor = i;
+        out.level = false;
+        out.timestampUs = fallUs_[i];
+        return true;
+      }
+    }
+    deadlineUs_ = earliest(p);
+    return false;
+  }
+
+  uint64_t nextDeadlineUs() const { return deadlineUs_; }
+
+  void clearPending() {
+    pendingMask_ = 0;
+    deadlineUs_ = UINT64_MAX;
+  }
+
+ private:
+  template <class Params>
+  uint64_t earliest(const Params& p) const {
+    uint64_t deadline = UINT64_MAX;
+    uint32_t pending = pendingMask_;
+    while (pending) {
+      uint8_t i = (uint8_t)__builtin_ctz(pending);
+      pending &= pending - 1;
+      uint64_t d = fallUs_[i] + p.mergeUs;
+      if (d < deadline) {
+        deadline = d;
+      }
+    }
+    return deadline;
+  }
+
+  uint64_t fallUs_[N] = {};
+  uint32_t pendingMask_ = 0;
+  uint64_t deadlineUs_ = UINT64_MAX;
+};
+
+// Refuse un nouveau mouvement moins de cooldownUs après le précédent
+template <size_t N>
+class CooldownStage {
+ public:
+  template <class Params, class Sink>
+  bool onEdge(const PirSignal& s, const Params& p, uint32_t motionMask, Sink& sink) {
+    if (!s.level || (motionMask & (1UL << s.sensor))) {
+      return true;
+    }
+    uint64_t sinceLast = s.timestampUs - lastValidUs_[s.sensor];
+    if (sinceLast > p.cooldownUs) {
+      lastValidUs_[s.sensor] = s.timestampUs;
+      return true;
+    }
+    sink(s.sensor, PIR_EVENT_COOLDOWN_REJECTED, s.timestampUs, p.cooldownUs - sinceLast);
+    return false;
+  }
+
+  template <class Params>
+  bool poll(uint64_t, const Params&, PirSignal&) { return false; }
+
+  uint64_t nextDeadlineUs() const { return UINT64_MAX; }
+  void clearPending() {}
+
+ private:
+  uint64_t lastValidUs_[N] = {};
+};
+
+// --------------------------------------------
+// CHAÎNAGE DES ÉTAGES
+// --------------------------------------------
+
+template <size_t N, class Params, template <size_t> class... Stages>
+class StageChain;
+
+// Fin de chaîne : verrou mouvement en cours / terminé
+template <size_t N, class Params>
+class StageChain<N, Params> {
+ public:
+  template <class Sink>
+  void process(const PirSignal& s, const Params&, Sink& sink) {
+    uint32_t bit = 1UL << s.sensor;
+    if (s.level && !(motionMask_ & bit)) {
+      motionMask_ |= bit;
+      sink(s.sensor, PIR_EVENT_MOTION_START, s.timestampUs, (uint64_t)0);
+    } else if (!s.level && (motionMask_ & bit)) {
+      motionMask_ &= ~bit;
+      sink(s.sensor, PIR_EVENT_MOTION_END, s.timestampUs, (uint64_t)0);
+    }
+  }
+
+  template <class Sink>
+  void poll(uint64_t, const Params&, Sink&) {}
+
+  uint64_t nextDeadlineUs() const { return UINT64_MAX; }
+  uint32_t motionMask() const { return motionMask_; }
+  void clearMotion() { motionMask_ = 0; }
+
+ private:
+  uint32_t motionMask_ = 0;
+};
+
+template <size_t N, class Params, template <size_t> class Head, template <size_t> class... Tail>
+class StageChain<N, Params, Head, Tail...> {
+ public:
+  template <class Sink>
+  void process(const PirSignal& s, const Params& p, Sink& sink) {
+    if (head_.onEdge(s, p, tail_.motionMask(), sink)) {
+      tail_.process(s, p, sink);
+    }
+  }
+
+  template <class Sink>
+  void poll(uint64_t nowUs, const Params& p, Sink& sink) {
+    PirSignal out;
+    while (head_.poll(nowUs, p, out)) {
+      tail_.process(out, p, sink);
+    }
+    tail_.poll(nowUs, p, sink);
+  }
+
+  uint64_t nextDeadlineUs() const {
+    uint64_t a = head_.nextDeadlineUs();
+    uint64_t b = tail_.nextDeadlineUs();
+    return a < b ? a : b;
+  }
+
+  uint32_t motionMask() const { return tail_.motionMask(); }
+
+  void clearMotion() {
+    head_.clearPending();
+    tail_.clearMotion();
+  }
+
+ private:
+  Head<N> head_;
+  StageChain<N, Params, Tail...> tail_;
+};
+
+// --------------------------------------------
+// PIPELINE
+// --------------------------------------------
+
+template <size_t N, class Params, template <size_t> class... Stages>
+class DetectionPipeline {
+  static_assert(N >= 1 && N <= 32, "1 à 32 capteurs");
+
+ public:
+  DetectionPipeline() {}
+  explicit DetectionPipeline(const Params& params) : params_(params) {}
+
+  // Transition d'un capteur. sink(sensor, event, timestampUs, cooldownRemainingUs)
+  // est appelé pour chaque événement produit.
+  template <class Sink>
+  void process(const PirSignal& s, Sink&& sink) {
+    // Les signaux différés arrivés à échéance passent avant ce front
+    chain_.poll(s.timestampUs, params_, sink);
+    chain_.process(s, params_, sink);
+  }
+
+  // Libère les signaux différés arrivés à échéance
+  template <class Sink>
+  void poll(uint64_t nowUs, Sink&& sink) {
+    chain_.poll(nowUs, params_, sink);
+  }
+
+  // Prochaine échéance d'un étage différé (UINT64_MAX si aucune)
+  uint64_t nextDeadlineUs() const { return chain_.nextDeadlineUs(); }
+
+  uint32_t motionMask() const { return chain_.motionMask(); }
+  bool anyMotion() const { return chain_.motionMask() != 0; }
+  void clearMotion() { chain_.clearMotion(); }
+
+  Params& params() { return params_; }
+  const Params& params() const { return params_; }
+
+ private:
+  Params params_;
+  StageChain<N, Params, Stages...> chain_;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// === ENREGISTREMENTS BINAIRES DE L'OUTBOX ===
+// Les événements en attente sont gardés sous forme compacte (quelques
+// entiers) et ne sont rendus qu'au moment de l'envoi. Une détection ne
+// porte que son numéro, son heure et son capteur : l'état du système part
+// dans le rapport de santé (statut).
+// Les structures sont packées : toujours les copier avec readRecord(),
+// le payload lu dans l'outbox n'est pas aligné.
+// Un type garde son format : un enregistrement peut attendre dans l'outbox
+// pendant une mise à jour. Un nouveau format prend un nouveau type, et un
+// type n'a qu'un format : sa longueur est vérifiée, jamais devinée.
+
+enum OutboxRecordType : uint8_t {
+  RECORD_JSON = 0,            // JSON déjà rendu (détection RTC, fenêtre QoS 1)
+  RECORD_MOTION = 1,          // MotionRecord
+  RECORD_MOTION_BATCH = 2,    // MotionRecord suivi de PackedBatchEntry[]
+  RECORD_SESSION = 3,         // SessionRecord
+  RECORD_STATUS = 4,          // JSON du statut, sans "seq" (ajouté à l'envoi)
+  RECORD_TWIN_REPORTED = 5,   // JSON du Device Twin reported
+  RECORD_MSGPACK = 6          // Télémétrie déjà rendue en MessagePack, seq compris (fenêtre QoS 1)
+};
+
+// Enregistrements déjà rendus, envoyés tels quels
+inline bool recordIsJson(uint8_t type) {
+  return type == RECORD_JSON || type == RECORD_STATUS || type == RECORD_TWIN_REPORTED;
+}
+
+// Détection (ou en-tête d'un lot : heure de publication du lot)
+struct __attribute__((packed)) MotionRecord {
+  uint64_t seq;               // Numéro de séquence du message
+  uint32_t timestampMs;       // ms depuis le boot
+  uint8_t sensor;
+};
+
+struct __attribute__((packed)) PackedBatchEntry {
+  uint32_t timestampMs;
+  uint8_t sensor;
+};
+
+struct __attribute__((packed)) SessionRecord {
+  uint64_t seq;
+  uint32_t startEpoch;        // Heure Unix du début (0 si l'heure n'était pas connue)
+  uint32_t startMs;
+  uint32_t dwellMs;
+  uint16_t detections;
+  uint16_t retriggers;
+  uint32_t sensorMask;
+  uint8_t partial;
+};
+
+static_assert(sizeof(MotionRecord) == 13, "MotionRecord : format stocké en flash");
+static_assert(sizeof(PackedBatchEntry) == 5, "PackedBatchEntry : format stocké en flash");
+static_assert(sizeof(SessionRecord) == 29, "SessionRecord : format stocké en flash");
+
+inline uint16_t saturate16(uint32_t value) {
+  return value > UINT16_MAX ? UINT16_MAX : (uint16_t)value;
+}
+
+inline size_t batchRecordSize(size_t entries) {
+  return sizeof(MotionRecord) + entries * sizeof(PackedBatchEntry);
+}
+
+// Copie un enregistrement depuis un payload non aligné
+template <typename T>
+bool readRecord(const uint8_t* data, size_t length, T& out, size_t offset = 0) {
+  if (offset + sizeof(T) > length) {
+    return false;
+  }
+  memcpy(&out, data + offset, sizeof(T));
+  return true;
+}
+
+// === DÉCODAGE ===
+// false si le type ou la longueur ne correspond pas
+
+inline bool decodeMotionRecord(uint8_t type, const uint8_t* data, size_t length, MotionRecord& out) {
+  return type == RECORD_MOTION && length == sizeof(MotionRecord) && readRecord(data, length, out);
+}
+
+// Lot lu en place : en-tête copié, entrées lues par readBatchEntry()
+struct BatchRecordView {
+  MotionRecord header;
+  size_t entries;
+};
+
+inline bool decodeBatchRecord(uint8_t type, const uint8_t* data, size_t length, BatchRecordView& view) {
+  if (type != RECORD_MOTION_BATCH || length <= sizeof(MotionRecord) ||
+      (length - sizeof(MotionRecord)) % sizeof(PackedBatchEntry) != 0 ||
+      !readRecord(data, length, view.header)) {
+    return false;
+  }
+  view.entries = (length - sizeof(MotionRecord)) / sizeof(PackedBatchEntry);
+  return true;
+}
+
+// Entrée `index` d'un lot décodé par decodeBatchRecord()
+inline PackedBatchEntry readBatchEntry(const uint8_t* data, size_t index) {
+  PackedBatchEntry entry;
+  memcpy(&entry, data + batchRecordSize(index), sizeof(entry));
+  return entry;
+}
+
+inline bool decodeSessionRecord(uint8_t type, const uint8_t* data, size_t length, SessionRecord& out) {
+  return type == RECORD_SESSION && length == sizeof(SessionRecord) && readRecord(data, length, out);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+// === ÉCHANTILLONNAGE DE L'ÉTAT DU SYSTÈME ===
+// RSSI et heap libre sont relevés périodiquement par un timer, hors du
+// chemin des détections, puis résumés sur la fenêtre du rapport de santé
+// (dernière valeur, min, max, moyenne). reset() ouvre une nouvelle
+// fenêtre en gardant les dernières valeurs.
+
+class HealthSampler {
+ public:
+  void addHeap(uint32_t freeHeap) {
+    heapLast_ = freeHeap;
+    if (heapSamples_ == 0 || freeHeap < heapMin_) {
+      heapMin_ = freeHeap;
+    }
+    heapSamples_++;
+  }
+
+  // Uniquement quand le WiFi est associé (le driver renvoie 0 sinon)
+  void addRssi(int8_t rssi) {
+    rssiLast_ = rssi;
+    if (rssiSamples_ == 0 || rssi < rssiMin_) {
+      rssiMin_ = rssi;
+    }
+    if (rssiSamples_ == 0 || rssi > rssiMax_) {
+      rssiMax_ = rssi;
+    }
+    rssiSum_ += rssi;
+    rssiSamples_++;
+  }
+
+  void reset() {
+    heapMin_ = heapLast_;
+    heapSamples_ = 0;
+    rssiMin_ = rssiLast_;
+    rssiMax_ = rssiLast_;
+    rssiSum_ = 0;
+    rssiSamples_ = 0;
+  }
+
+  uint32_t heapLast() const { return heapLast_; }
+  uint32_t heapMin() const { return heapSamples_ > 0 ? heapMin_ : heapLast_; }
+  uint32_t heapSamples() const { return heapSamples_; }
+
+  bool hasRssi() const { return rssiSamples_ > 0; }
+  int8_t rssiLast() const { return rssiLast_; }
+  int8_t rssiMin() const { return rssiMin_; }
+  int8_t rssiMax() const { return rssiMax_; }
+  int8_t rssiAvg() const { return rssiSamples_ > 0 ? (int8_t)(rssiSum_ / (int32_t)rssiSamples_) : rssiLast_; }
+
+ private:
+  uint32_t heapLast_ = 0;
+  uint32_t heapMin_ = 0;
+  uint32_t heapSamples_ = 0;
+  int8_t rssiLast_ = 0;
+  int8_t rssiMin_ = 0;
+  int8_t rssiMax_ = 0;
+  int32_t rssiSum_ = 0;
+  uint32_t rssiSamples_ = 0;
+};
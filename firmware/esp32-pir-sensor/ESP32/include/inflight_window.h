@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "message_ring.h"
+
+// === FENÊTRE DE PUBLICATIONS QOS 1 ===
+// Messages publiés en QoS 1 et pas encore acquittés, dans l'ordre d'envoi,
+// avec une copie de leur payload pour pouvoir les republier. L'appelant
+// ne libère leur source (marque en flash de l'outbox) qu'au PUBACK.
+// Le broker acquitte dans l'ordre de réception ; un PUBACK en avance est
+// noté et attend que les messages qui le précèdent soient acquittés.
+// Après une coupure, les messages non acquittés sont republiés avec le
+// même identifiant et le drapeau DUP.
+// La fenêtre est pleine quand `limit` messages attendent leur PUBACK ou
+// quand leurs payloads ne tiennent plus dans PoolBytes.
+
+template <class Tag, size_t Capacity, size_t PoolBytes>
+class InflightWindow {
+  static_assert(Capacity >= 1, "Capacity doit être >= 1");
+
+ public:
+  struct Entry {
+    uint16_t packetId;
+    uint8_t type;
+    bool acked;
+    bool sent;          // false : à republier (coupure, ou envoi échoué)
+    uint32_t sentMs;    // Dernier envoi
+    Tag tag;            // Données de l'appelant (source à libérer au PUBACK)
+  };
+
+  InflightWindow() : pool_(EVICT_DROP_NEWEST) {}
+
+  void setLimit(size_t limit) { limit_ = limit < Capacity ? limit : Capacity; }
+  size_t limit() const { return limit_; }
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  size_t bytesUsed() const { return pool_.bytesUsed(); }
+
+  // Place pour un message de `length` octets
+  bool canAdd(size_t length) const { return count_ < limit_ && pool_.fits(length); }
+
+  // Copie un message dans la fenêtre ; NULL si elle est pleine
+  Entry* add(uint16_t packetId, uint8_t type, const uint8_t* payload, size_t length, const Tag& tag) {
+    if (!canAdd(length) || pool_.push(type, payload, length, 0) != MessageRingBase::PUSH_OK) {
+      return nullptr;
+    }
+    Entry& entry = entries_[(head_ + count_) % Capacity];
+    entry.packetId = packetId;
+    entry.type = type;
+    entry.acked = false;
+    entry.sent = false;
+    entry.sentMs = 0;
+    entry.tag = tag;
+    count_++;
+    return &entry;
+  }
+
+  // Message `index` (0 = le plus ancien) et son payload
+  Entry& operator[](size_t index) { return entries_[(head_ + index) % Capacity]; }
+  const uint8_t* payload(size_t index, size_t& length) const {
+    MessageSlot slot;
+    const uint8_t* data = nullptr;
+    length = pool_.peekAt(index, slot, data) ? slot.length : 0;
+    return data;
+  }
+
+  bool contains(uint16_t packetId) const {
+    for (size_t i = 0; i < count_; i++) {
+      if (entries_[(head_ + i) % Capacity].packetId == packetId) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // PUBACK reçu ; NULL si l'identifiant est inconnu ou déjà acquitté
+  Entry* ack(uint16_t packetId) {
+    for (size_t i = 0; i < count_; i++) {
+      Entry& entry = entries_[(head_ + i) % Capacity];
+      if (entry.packetId == packetId && !entry.acked) {
+        entry.acked = true;
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  // Le plus ancien message est acquitté : l'appelant libère sa source puis pop()
+  bool frontAcked() const { return count_ > 0 && entries_[head_].acked; }
+  const Entry& front() const { return entries_[head_]; }
+
+  void pop() {
+    if (count_ == 0) {
+      return;
+    }
+    pool_.pop();
+    head_ = (head_ + 1) % Capacity;
+    count_--;
+  }
+
+  // Dernier envoi du plus ancien message en attente de PUBACK
+  bool oldestUnacked(uint32_t& sentMs) const {
+    for (size_t i = 0; i < count_; i++) {
+      const Entry& entry = entries_[(head_ + i) % Capacity];
+      if (entry.sent && !entry.acked) {
+        sentMs = entry.sentMs;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  Entry entries_[Capacity];
+  MessageRing<PoolBytes> pool_;
+  size_t head_ = 0;
+  size_t count_ = 0;
+  size_t limit_ = Capacity;
+};
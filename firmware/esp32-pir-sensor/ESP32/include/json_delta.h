@@ -0,0 +1,95 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <math.h>
+#include <string.h>
+
+// === DIFFÉRENCES ENTRE DOCUMENTS JSON ===
+// Compare un document complet à la copie du dernier état transmis (shadow)
+// et ne garde que les membres qui ont changé, objets imbriqués compris.
+// Un membre disparu est émis à null (suppression côté Device Twin).
+// Les valeurs bruitées (RSSI, heap...) ont un seuil : tant que l'écart
+// avec la valeur transmise reste sous le seuil, elles ne sont pas renvoyées
+// et la shadow garde l'ancienne valeur (voir settle()).
+
+struct DeltaThreshold {
+  const char* key;
+  float absolute;     // Écart minimal (unités du champ)
+  float relative;     // Écart minimal relatif à la valeur transmise (0.25 = 25 %)
+};
+
+class JsonDelta {
+ public:
+  JsonDelta(const DeltaThreshold* thresholds, size_t count) : thresholds_(thresholds), count_(count) {}
+
+  // Écrit dans `out` les membres de `current` qui diffèrent de `shadow` ;
+  // renvoie le nombre de membres écrits (0 = rien à envoyer)
+  size_t diff(JsonObjectConst current, JsonObjectConst shadow, JsonObject out) const {
+    size_t written = 0;
+    for (JsonPairConst kv : current) {
+      JsonVariantConst before = shadow[kv.key()];
+      if (kv.value().is<JsonObjectConst>() && before.is<JsonObjectConst>()) {
+        JsonObject nested = out.createNestedObject(kv.key());
+        if (diff(kv.value().as<JsonObjectConst>(), before.as<JsonObjectConst>(), nested) == 0) {
+          out.remove(kv.key());
+        } else {
+          written++;
+        }
+      } else if (significant(kv.key().c_str(), kv.value(), before)) {
+        out[kv.key()] = kv.value();
+        written++;
+      }
+    }
+    for (JsonPairConst kv : shadow) {
+      if (!current.containsKey(kv.key())) {
+        out[kv.key()] = nullptr;
+        written++;
+      }
+    }
+    return written;
+  }
+
+  // Après envoi du patch : remet dans `current` les valeurs transmises
+  // pour les membres restés sous leur seuil. `current` devient l'état
+  // connu du destinataire, à recopier dans la shadow.
+  static void settle(JsonObject current, JsonObjectConst shadow, JsonObjectConst patch) {
+    for (JsonPair kv : current) {
+      JsonVariantConst before = shadow[kv.key()];
+      if (before.isNull()) {
+        continue;
+      }
+      JsonVariantConst sent = patch[kv.key()];
+      if (kv.value().is<JsonObject>() && before.is<JsonObjectConst>()) {
+        settle(kv.value().as<JsonObject>(), before.as<JsonObjectConst>(), sent.as<JsonObjectConst>());
+      } else if (!patch.containsKey(kv.key())) {
+        kv.value().set(before);
+      }
+    }
+  }
+
+ private:
+  bool significant(const char* key, JsonVariantConst now, JsonVariantConst before) const {
+    if (before.isNull()) {
+      return true;
+    }
+    const DeltaThreshold* threshold = find(key);
+    if (threshold == nullptr || !now.is<float>() || !before.is<float>()) {
+      return now != before;
+    }
+    double previous = before.as<double>();
+    double limit = fmax(threshold->absolute, threshold->relative * fabs(previous));
+    return fabs(now.as<double>() - previous) > limit;
+  }
+
+  const DeltaThreshold* find(const char* key) const {
+    for (size_t i = 0; i < count_; i++) {
+      if (strcmp(thresholds_[i].key, key) == 0) {
+        return &thresholds_[i];
+      }
+    }
+    return nullptr;
+  }
+
+  const DeltaThreshold* thresholds_;
+  size_t count_;
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// === FILE DE MESSAGES EN ATTENTE (OUTBOX) ===
+// Anneau d'octets alloué une fois pour toutes : chaque message occupe un
+// en-tête de 8 octets suivi de son payload, arrondi à 4 octets. Un petit
+// enregistrement binaire ne coûte donc que quelques dizaines d'octets.
+// Un message n'est jamais coupé en fin d'anneau : s'il ne tient pas dans
+// la fin, il est écrit au début. Ajout et retrait en O(1).
+// Chaque message garde son type (le topic est déduit à l'envoi).
+// Quand la place manque, la politique d'éviction de l'anneau décide :
+//  - EVICT_DROP_OLDEST : les plus anciens messages sont supprimés
+//  - EVICT_DROP_NEWEST : le nouveau message est refusé
+//  - EVICT_KEEP_LATEST : un seul message, remplacé à chaque ajout (statut)
+
+struct MessageSlot {
+  uint32_t timestampMs;
+  uint16_t length;
+  uint8_t type;
+};
+
+enum EvictionPolicy : uint8_t {
+  EVICT_DROP_OLDEST,
+  EVICT_DROP_NEWEST,
+  EVICT_KEEP_LATEST
+};
+
+// Logique de l'anneau ; la mémoire est fournie par MessageRing<Bytes>
+class MessageRingBase {
+ public:
+  enum PushResult {
+    PUSH_OK,
+    PUSH_DROPPED_OLDEST,  // Un ou plusieurs anciens messages supprimés
+    PUSH_DROPPED_NEWEST,  // Anneau plein, le nouveau message est refusé
+    PUSH_REPLACED,        // Le message précédent est remplacé (EVICT_KEEP_LATEST)
+    PUSH_TOO_LARGE        // Payload plus grand que l'anneau, rien n'est ajouté
+  };
+
+  PushResult push(uint8_t type, const uint8_t* payload, size_t length, uint32_t timestampMs) {
+    if (length > payloadCapacity()) {
+      tooLarge_++;
+      return PUSH_TOO_LARGE;
+    }
+
+    PushResult result = PUSH_OK;
+    if (policy_ == EVICT_KEEP_LATEST && count_ > 0) {
+      clear();
+      replaced_++;
+      result = PUSH_REPLACED;
+    }
+
+    size_t need = recordSize(length);
+    size_t at;
+    while (!reserve(need, at)) {
+      if (policy_ == EVICT_DROP_NEWEST) {
+        dropped_++;
+        return PUSH_DROPPED_NEWEST;
+      }
+      pop();
+      dropped_++;
+      result = PUSH_DROPPED_OLDEST;
+    }
+
+    MessageSlot slot;
+    slot.timestampMs = timestampMs;
+    slot.length = (uint16_t)length;
+    slot.type = type;
+    memcpy(buffer_ + at, &slot, sizeof(slot));
+    memcpy(buffer_ + at + sizeof(slot), payload, length);
+    tail_ = at + need;
+    used_ += need;
+    count_++;
+    return result;
+  }
+
+  // Plus ancien message (anneau non vide)
+  MessageSlot front() const {
+    MessageSlot slot;
+    memcpy(&slot, buffer_ + head_, sizeof(slot));
+    return slot;
+  }
+  const uint8_t* frontPayload() const { return buffer_ + head_ + sizeof(MessageSlot); }
+
+  // Lecture sans retrait du message `index` (0 = le plus ancien), en O(index)
+  bool peekAt(size_t index, MessageSlot& slot, const uint8_t*& payload) const {
+    if (index >= count_) {
+      return false;
+    }
+    size_t pos = head_;
+    for (size_t i = 0; i < index; i++) {
+      memcpy(&slot, buffer_ + pos, sizeof(slot));
+      pos += recordSize(slot.length);
+      if (wrapped_ && pos == limit_) {
+        pos = 0;
+      }
+    }
+    memcpy(&slot, buffer_ + pos, sizeof(slot));
+    payload = buffer_ + pos + sizeof(MessageSlot);
+    return true;
+  }
+
+  // Vrai si un payload de `length` octets tient sans rien supprimer
+  bool fits(size_t length) const {
+    size_t need = recordSize(length);
+    if (!wrapped_) {
+      return tail_ + need <= bytes_ || need <= head_;
+    }
+    return tail_ + need <= head_;
+  }
+
+  void pop() {
+    if (count_ == 0) {
+      return;
+    }
+    size_t size = recordSize(front().length);
+    head_ += size;
+    used_ -= size;
+    count_--;
+    if (count_ == 0) {
+      clear();
+    } else if (wrapped_ && head_ == limit_) {
+      head_ = 0;
+      wrapped_ = false;
+    }
+  }
+
+  void clear() {
+    head_ = 0;
+    tail_ = 0;
+    limit_ = 0;
+    used_ = 0;
+    count_ = 0;
+    wrapped_ = false;
+  }
+
+  bool empty() const { return count_ == 0; }
+  size_t size() const { return count_; }
+  size_t bytesUsed() const { return used_; }
+  size_t capacity() const { return bytes_; }
+  size_t payloadCapacity() const { return bytes_ - sizeof(MessageSlot); }
+  EvictionPolicy policy() const { return policy_; }
+  uint32_t dropped() const { return dropped_; }
+  uint32_t replaced() const { return replaced_; }
+  uint32_t tooLarge() const { return tooLarge_; }
+
+  static constexpr size_t recordSize(size_t length) { return (sizeof(MessageSlot) + length + 3) & ~(size_t)3; }
+
+ protected:
+  MessageRingBase(uint8_t* buffer, size_t bytes, EvictionPolicy policy)
+      : buffer_(buffer), bytes_(bytes), policy_(policy) {}
+
+ private:
+  // Cherche une zone libre contiguë de `need` octets, sans rien supprimer
+  bool reserve(size_t need, size_t& at) {
+    if (!wrapped_) {
+      if (tail_ + need <= bytes_) {
+        at = tail_;
+        return true;
+      }
+      if (need <= head_) {
+        // Fin de l'anneau trop courte : les données s'arrêtent à limit_
+        limit_ = tail_;
+        wrapped_ = true;
+        at = 0;
+        return true;
+      }
+      return false;
+    }
+    if (tail_ + need <= head_) {
+      at = tail_;
+      return true;
+    }
+    return false;
+  }
+
+  uint8_t* buffer_;
+  size_t bytes_;
+  EvictionPolicy policy_;
+  size_t head_ = 0;      // Plus ancien message
+  size_t tail_ = 0;      // Fin du plus récent
+  size_t limit_ = 0;     // Fin des données avant le retour au début (si wrapped_)
+  size_t used_ = 0;
+  size_t count_ = 0;
+  bool wrapped_ = false;
+  uint32_t dropped_ = 0;
+  uint32_t replaced_ = 0;
+  uint32_t tooLarge_ = 0;
+};
+
+template <size_t Bytes>
+class MessageRing : public MessageRingBase {
+  static_assert(Bytes % 4 == 0 && Bytes >= 64, "Bytes doit être un multiple de 4 et >= 64");
+  static_assert(Bytes - sizeof(MessageSlot) <= UINT16_MAX, "Un payload doit tenir sur 16 bits");
+
+ public:
+  explicit MessageRing(EvictionPolicy policy = EVICT_DROP_OLDEST)
+      : MessageRingBase(storage_, Bytes, policy) {}
+
+  MessageRing(const MessageRing&) = delete;
+  MessageRing& operator=(const MessageRing&) = delete;
+
+ private:
+  alignas(4) uint8_t storage_[Bytes];
+};
@@ -0,0 +1,1444 @@
+#pragma once
+
+// Généré par generate-messages.py depuis messages.schema.json : ne pas modifier.
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// === MESSAGES (messages.schema.json) ===
+// Une structure par message ; encodeMessage() remplit un document à
+// sérialiser en JSON ou en MessagePack, decodeMessage() vérifie types et
+// champs obligatoires. Les chaînes ne sont pas copiées : elles pointent
+// vers les données de l'appelant (encodage) ou du document (décodage).
+// XXX_DOC_SIZE : capacité pour encoder (toutes options présentes).
+// XXX_PARSE_SIZE : capacité pour désérialiser (clés et chaînes copiées) ;
+// XXX_DOC_SIZE suffit pour une désérialisation en place (char* modifiable).
+
+constexpr size_t MOTION_BATCH_MESSAGE_DETECTIONS_MAX = 32;
+
+// Détection d'un lot, codée [ts, sensor]
+struct BatchDetection {
+  uint32_t ts = 0;
+  uint8_t sensor = 0;
+};
+
+// Occupation d'une file de l'outbox, codée [en attente, perdus]
+struct LaneCounts {
+  uint32_t pending = 0;
+  uint32_t dropped = 0;
+};
+
+// Une détection
+struct MotionMessage {
+  uint64_t seq = 0;
+  uint32_t ts = 0;  // Heure du front PIR (ms depuis le boot)
+  uint8_t sensor = 0;
+  uint32_t time = 0;  // Heure Unix (deep sleep, si connue)
+  bool hasTime = false;
+  uint32_t wakeToPublishMs = 0;  // Deep sleep : réveil → publication confirmée au cycle précédent
+  bool hasWakeToPublishMs = false;
+};
+
+// Détections d'une fenêtre de regroupement
+struct MotionBatchMessage {
+  uint64_t seq = 0;
+  uint32_t ts = 0;  // Heure de publication du lot
+  BatchDetection detections[MOTION_BATCH_MESSAGE_DETECTIONS_MAX];
+  size_t detectionsCount = 0;
+};
+
+// Session d'occupation terminée
+struct SessionMessage {
+  uint64_t seq = 0;
+  uint32_t start = 0;  // Heure Unix du début (si connue)
+  bool hasStart = false;
+  uint32_t startMs = 0;
+  uint32_t dwell = 0;
+  uint16_t detections = 0;
+  uint16_t retriggers = 0;
+  uint32_t sensors = 0;
+  bool partial = false;
+  bool hasPartial = false;
+};
+
+struct StatusSystemLanes {
+  LaneCounts twin;
+  LaneCounts session;
+  LaneCounts health;
+  LaneCounts motion;
+};
+
+// Outbox en flash
+struct StatusSystemOutbox {
+  uint32_t segments = 0;
+  uint32_t erases = 0;
+  uint32_t corrupt = 0;
+  float writeAmp = 0;
+};
+
+struct StatusSystem {
+  int8_t rssi = 0;
+  int8_t rssiMin = 0;
+  bool hasRssiMin = false;
+  int8_t rssiMax = 0;
+  bool hasRssiMax = false;
+  int8_t rssiAvg = 0;
+  bool hasRssiAvg = false;
+  uint32_t freeHeap = 0;
+  uint32_t minFreeHeap = 0;
+  uint32_t cpuFreq = 0;
+  uint32_t buffered = 0;
+  uint32_t bufferDropped = 0;
+  int32_t wifiReconnects = 0;
+  int32_t mqttReconnects = 0;
+  int32_t failedPublishes = 0;
+  uint32_t unreadableRecords = 0;
+  uint32_t pirEdgesDropped = 0;
+  uint32_t seqNvsWrites = 0;
+  uint32_t avgPublishCycles = 0;
+  bool hasAvgPublishCycles = false;
+  uint32_t maxPublishCycles = 0;
+  bool hasMaxPublishCycles = false;
+  float tlsWritesPerPublish = 0;  // Écritures TLS (enregistrements chiffrés) par publication, PUBACK et PINGREQ compris
+  bool hasTlsWritesPerPublish = false;
+  float wakeupsPerSec = 0;
+  uint32_t maxWakeLatencyUs = 0;
+  uint32_t avgWakeLatencyUs = 0;
+  uint32_t avgDetectionPublishUs = 0;
+  bool hasAvgDetectionPublishUs = false;
+  uint32_t maxDetectionPublishUs = 0;
+  bool hasMaxDetectionPublishUs = false;
+  float drainRate = 0;
+  bool hasDrainRate = false;
+  uint32_t maxPirGapUs = 0;
+  bool hasMaxPirGapUs = false;
+  uint32_t maxConnectGapUs = 0;  // Plus long tour de loop() sans traitement PIR pendant une reconnexion
+  bool hasMaxConnectGapUs = false;
+  uint16_t listenInterval = 0;
+  bool hasListenInterval = false;
+  uint32_t sleepWakes = 0;
+  bool hasSleepWakes = false;
+  uint32_t wakeToPublishMs = 0;
+  bool hasWakeToPublishMs = false;
+  uint32_t wakeEventsDropped = 0;
+  bool hasWakeEventsDropped = false;
+  uint32_t inflight = 0;  // QoS 1 : messages en attente de PUBACK
+  bool hasInflight = false;
+  uint32_t avgAckMs = 0;  // QoS 1 : envoi → PUBACK, moyenne depuis le dernier statut
+  bool hasAvgAckMs = false;
+  StatusSystemLanes lanes;
+  StatusSystemOutbox outbox;  // Outbox en flash
+  bool hasOutbox = false;
+};
+
+// Rapport de santé (complet ; les statuts delta ne portent que les champs modifiés)
+struct StatusMessage {
+  uint64_t seq = 0;  // Ajouté à l'envoi
+  bool hasSeq = false;
+  const char* firmware = nullptr;
+  uint32_t uptime = 0;
+  bool detectionEnabled = false;
+  uint32_t cooldown = 0;
+  int32_t detectionCount = 0;
+  int32_t sessionCount = 0;
+  bool occupied = false;
+  const char* powerMode = nullptr;
+  StatusSystem system;
+};
+
+struct TwinReportedInterArrival {
+  uint32_t ewma = 0;
+  uint32_t p50 = 0;
+  uint32_t p90 = 0;
+  uint32_t samples = 0;
+};
+
+struct TwinReportedSystem {
+  int8_t rssi = 0;
+  uint32_t freeHeap = 0;
+  uint32_t cpuFreq = 0;
+  uint32_t buffered = 0;
+};
+
+// Propriétés reported du Device Twin (état complet ; les patchs delta n'en portent qu'une partie)
+struct TwinReportedMessage {
+  const char* firmware = nullptr;
+  uint32_t uptime = 0;
+  bool detectionEnabled = false;
+  uint32_t cooldown = 0;
+  uint32_t minPulse = 0;
+  uint32_t mergeWindow = 0;
+  uint32_t riseHold = 0;
+  uint32_t fallHold = 0;
+  bool sessionMode = false;
+  uint32_t idleTimeout = 0;
+  bool adaptiveCooldown = false;
+  uint32_t maxMessagesPerHour = 0;
+  uint32_t effectiveCooldown = 0;
+  uint32_t batchWindow = 0;
+  const char* powerMode = nullptr;
+  uint32_t c2dLatency = 0;
+  const char* encoding = nullptr;
+  uint8_t inflightWindow = 0;
+  int32_t detectionCount = 0;
+  TwinReportedInterArrival interArrival;
+  TwinReportedSystem system;
+};
+
+// Propriétés desired du Device Twin (patch ou section desired du GET), toutes facultatives
+struct TwinDesiredMessage {
+  bool detectionEnabled = false;
+  bool hasDetectionEnabled = false;
+  uint32_t cooldown = 0;
+  bool hasCooldown = false;
+  bool sessionMode = false;
+  bool hasSessionMode = false;
+  uint32_t idleTimeout = 0;
+  bool hasIdleTimeout = false;
+  bool adaptiveCooldown = false;
+  bool hasAdaptiveCooldown = false;
+  uint32_t maxMessagesPerHour = 0;
+  bool hasMaxMessagesPerHour = false;
+  uint32_t batchWindow = 0;
+  bool hasBatchWindow = false;
+  uint32_t minPulse = 0;
+  bool hasMinPulse = false;
+  uint32_t mergeWindow = 0;
+  bool hasMergeWindow = false;
+  uint32_t riseHold = 0;
+  bool hasRiseHold = false;
+  uint32_t fallHold = 0;
+  bool hasFallHold = false;
+  const char* powerMode = nullptr;
+  bool hasPowerMode = false;
+  uint32_t c2dLatency = 0;
+  bool hasC2dLatency = false;
+  const char* encoding = nullptr;
+  bool hasEncoding = false;
+  uint8_t inflightWindow = 0;  // Messages QoS 1 sans PUBACK (0 = QoS 0)
+  bool hasInflightWindow = false;
+};
+
+// Commande Cloud-to-Device
+struct C2dCommandMessage {
+  const char* command = nullptr;
+  uint32_t value = 0;  // setCooldown : nouveau cooldown (ms)
+  bool hasValue = false;
+};
+
+// === CAPACITÉS DES DOCUMENTS ===
+
+constexpr size_t BATCH_DETECTION_DOC_SIZE = JSON_ARRAY_SIZE(2);
+constexpr size_t BATCH_DETECTION_PARSE_SIZE = JSON_ARRAY_SIZE(2);
+
+constexpr size_t LANE_COUNTS_DOC_SIZE = JSON_ARRAY_SIZE(2);
+constexpr size_t LANE_COUNTS_PARSE_SIZE = JSON_ARRAY_SIZE(2);
+
+constexpr size_t MOTION_MESSAGE_DOC_SIZE = JSON_OBJECT_SIZE(6);
+constexpr size_t MOTION_MESSAGE_PARSE_SIZE = JSON_OBJECT_SIZE(6) + JSON_STRING_SIZE(3) + JSON_STRING_SIZE(2)
+    + JSON_STRING_SIZE(6) + JSON_STRING_SIZE(4) + JSON_STRING_SIZE(15) + JSON_STRING_SIZE(5)
+    + JSON_STRING_SIZE(6);
+
+constexpr size_t MOTION_BATCH_MESSAGE_DOC_SIZE = JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(32)
+    + 32 * (BATCH_DETECTION_DOC_SIZE);
+constexpr size_t MOTION_BATCH_MESSAGE_PARSE_SIZE = JSON_OBJECT_SIZE(4) + JSON_STRING_SIZE(3)
+    + JSON_STRING_SIZE(2) + JSON_STRING_SIZE(10) + JSON_STRING_SIZE(5) + JSON_STRING_SIZE(6)
+    + JSON_ARRAY_SIZE(32) + 32 * (BATCH_DETECTION_PARSE_SIZE);
+
+constexpr size_t SESSION_MESSAGE_DOC_SIZE = JSON_OBJECT_SIZE(9);
+constexpr size_t SESSION_MESSAGE_PARSE_SIZE = JSON_OBJECT_SIZE(9) + JSON_STRING_SIZE(3) + JSON_STRING_SIZE(5)
+    + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(5) + JSON_STRING_SIZE(10) + JSON_STRING_SIZE(10)
+    + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(5) + JSON_STRING_SIZE(7);
+
+constexpr size_t STATUS_SYSTEM_LANES_DOC_SIZE = JSON_OBJECT_SIZE(4) + LANE_COUNTS_DOC_SIZE
+    + LANE_COUNTS_DOC_SIZE + LANE_COUNTS_DOC_SIZE + LANE_COUNTS_DOC_SIZE;
+constexpr size_t STATUS_SYSTEM_LANES_PARSE_SIZE = JSON_OBJECT_SIZE(4) + JSON_STRING_SIZE(4)
+    + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(6) + JSON_STRING_SIZE(6) + LANE_COUNTS_PARSE_SIZE
+    + LANE_COUNTS_PARSE_SIZE + LANE_COUNTS_PARSE_SIZE + LANE_COUNTS_PARSE_SIZE;
+
+constexpr size_t STATUS_SYSTEM_OUTBOX_DOC_SIZE = JSON_OBJECT_SIZE(4);
+constexpr size_t STATUS_SYSTEM_OUTBOX_PARSE_SIZE = JSON_OBJECT_SIZE(4) + JSON_STRING_SIZE(8)
+    + JSON_STRING_SIZE(6) + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(8);
+
+constexpr size_t STATUS_SYSTEM_DOC_SIZE = JSON_OBJECT_SIZE(34) + STATUS_SYSTEM_LANES_DOC_SIZE
+    + STATUS_SYSTEM_OUTBOX_DOC_SIZE;
+constexpr size_t STATUS_SYSTEM_PARSE_SIZE = JSON_OBJECT_SIZE(34) + JSON_STRING_SIZE(4) + JSON_STRING_SIZE(7)
+    + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(11)
+    + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(13) + JSON_STRING_SIZE(14)
+    + JSON_STRING_SIZE(14) + JSON_STRING_SIZE(15) + JSON_STRING_SIZE(17) + JSON_STRING_SIZE(15)
+    + JSON_STRING_SIZE(12) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(19)
+    + JSON_STRING_SIZE(13) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(21)
+    + JSON_STRING_SIZE(21) + JSON_STRING_SIZE(9) + JSON_STRING_SIZE(11) + JSON_STRING_SIZE(15)
+    + JSON_STRING_SIZE(14) + JSON_STRING_SIZE(10) + JSON_STRING_SIZE(15) + JSON_STRING_SIZE(17)
+    + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(5) + JSON_STRING_SIZE(6)
+    + STATUS_SYSTEM_LANES_PARSE_SIZE + STATUS_SYSTEM_OUTBOX_PARSE_SIZE;
+
+constexpr size_t STATUS_MESSAGE_DOC_SIZE = JSON_OBJECT_SIZE(11) + STATUS_SYSTEM_DOC_SIZE;
+constexpr size_t STATUS_MESSAGE_PARSE_SIZE = JSON_OBJECT_SIZE(11) + JSON_STRING_SIZE(3) + JSON_STRING_SIZE(8)
+    + JSON_STRING_SIZE(6) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(14)
+    + JSON_STRING_SIZE(12) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(9) + JSON_STRING_SIZE(6)
+    + JSON_STRING_SIZE(5) + JSON_STRING_SIZE(6) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(12)
+    + STATUS_SYSTEM_PARSE_SIZE;
+
+constexpr size_t TWIN_REPORTED_INTER_ARRIVAL_DOC_SIZE = JSON_OBJECT_SIZE(4);
+constexpr size_t TWIN_REPORTED_INTER_ARRIVAL_PARSE_SIZE = JSON_OBJECT_SIZE(4) + JSON_STRING_SIZE(4)
+    + JSON_STRING_SIZE(3) + JSON_STRING_SIZE(3) + JSON_STRING_SIZE(7);
+
+constexpr size_t TWIN_REPORTED_SYSTEM_DOC_SIZE = JSON_OBJECT_SIZE(4);
+constexpr size_t TWIN_REPORTED_SYSTEM_PARSE_SIZE = JSON_OBJECT_SIZE(4) + JSON_STRING_SIZE(4)
+    + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(7) + JSON_STRING_SIZE(8);
+
+constexpr size_t TWIN_REPORTED_MESSAGE_DOC_SIZE = JSON_OBJECT_SIZE(21) + TWIN_REPORTED_INTER_ARRIVAL_DOC_SIZE
+    + TWIN_REPORTED_SYSTEM_DOC_SIZE;
+constexpr size_t TWIN_REPORTED_MESSAGE_PARSE_SIZE = JSON_OBJECT_SIZE(21) + JSON_STRING_SIZE(8)
+    + JSON_STRING_SIZE(6) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(8)
+    + JSON_STRING_SIZE(11) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(11)
+    + JSON_STRING_SIZE(11) + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(18) + JSON_STRING_SIZE(17)
+    + JSON_STRING_SIZE(11) + JSON_STRING_SIZE(9) + JSON_STRING_SIZE(10) + JSON_STRING_SIZE(8)
+    + JSON_STRING_SIZE(14) + JSON_STRING_SIZE(14) + JSON_STRING_SIZE(12) + JSON_STRING_SIZE(6)
+    + JSON_STRING_SIZE(16) + JSON_STRING_SIZE(12) + JSON_STRING_SIZE(8) + TWIN_REPORTED_INTER_ARRIVAL_PARSE_SIZE
+    + TWIN_REPORTED_SYSTEM_PARSE_SIZE;
+
+constexpr size_t TWIN_DESIRED_MESSAGE_DOC_SIZE = JSON_OBJECT_SIZE(15);
+constexpr size_t TWIN_DESIRED_MESSAGE_PARSE_SIZE = JSON_OBJECT_SIZE(15) + JSON_STRING_SIZE(16)
+    + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(11) + JSON_STRING_SIZE(11) + JSON_STRING_SIZE(16)
+    + JSON_STRING_SIZE(18) + JSON_STRING_SIZE(11) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(11)
+    + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(9) + JSON_STRING_SIZE(10)
+    + JSON_STRING_SIZE(8) + JSON_STRING_SIZE(14) + JSON_STRING_SIZE(12) + JSON_STRING_SIZE(8);
+
+constexpr size_t C2D_COMMAND_MESSAGE_DOC_SIZE = JSON_OBJECT_SIZE(2);
+constexpr size_t C2D_COMMAND_MESSAGE_PARSE_SIZE = JSON_OBJECT_SIZE(2) + JSON_STRING_SIZE(7)
+    + JSON_STRING_SIZE(5) + JSON_STRING_SIZE(16);
+
+// === ENCODAGE ===
+
+inline void encodeValue(const BatchDetection& value, JsonArray array) {
+  array.add(value.ts);
+  array.add(value.sensor);
+}
+
+inline void encodeValue(const LaneCounts& value, JsonArray array) {
+  array.add(value.pending);
+  array.add(value.dropped);
+}
+
+inline void encodeValue(const MotionMessage& value, JsonObject object) {
+  object["event"] = "motion";
+  object["seq"] = value.seq;
+  object["ts"] = value.ts;
+  object["sensor"] = value.sensor;
+  if (value.hasTime) {
+    object["time"] = value.time;
+  }
+  if (value.hasWakeToPublishMs) {
+    object["wakeToPublishMs"] = value.wakeToPublishMs;
+  }
+}
+
+inline void encodeValue(const MotionBatchMessage& value, JsonObject object) {
+  object["event"] = "motion";
+  object["seq"] = value.seq;
+  object["ts"] = value.ts;
+  JsonArray detections = object.createNestedArray("detections");
+  for (size_t i = 0; i < value.detectionsCount; i++) {
+    encodeValue(value.detections[i], detections.createNestedArray());
+  }
+}
+
+inline void encodeValue(const SessionMessage& value, JsonObject object) {
+  object["event"] = "session";
+  object["seq"] = value.seq;
+  if (value.hasStart) {
+    object["start"] = value.start;
+  }
+  object["startMs"] = value.startMs;
+  object["dwell"] = value.dwell;
+  object["detections"] = value.detections;
+  object["retriggers"] = value.retriggers;
+  object["sensors"] = value.sensors;
+  if (value.hasPartial) {
+    object["partial"] = value.partial;
+  }
+}
+
+inline void encodeValue(const StatusSystemLanes& value, JsonObject object) {
+  encodeValue(value.twin, object.createNestedArray("twin"));
+  encodeValue(value.session, object.createNestedArray("session"));
+  encodeValue(value.health, object.createNestedArray("health"));
+  encodeValue(value.motion, object.createNestedArray("motion"));
+}
+
+inline void encodeValue(const StatusSystemOutbox& value, JsonObject object) {
+  object["segments"] = value.segments;
+  object["erases"] = value.erases;
+  object["corrupt"] = value.corrupt;
+  object["writeAmp"] = value.writeAmp;
+}
+
+inline void encodeValue(const StatusSystem& value, JsonObject object) {
+  object["rssi"] = value.rssi;
+  if (value.hasRssiMin) {
+    object["rssiMin"] = value.rssiMin;
+  }
+  if (value.hasRssiMax) {
+    object["rssiMax"] = value.rssiMax;
+  }
+  if (value.hasRssiAvg) {
+    object["rssiAvg"] = value.rssiAvg;
+  }
+  object["freeHeap"] = value.freeHeap;
+  object["minFreeHeap"] = value.minFreeHeap;
+  object["cpuFreq"] = value.cpuFreq;
+  object["buffered"] = value.buffered;
+  object["bufferDropped"] = value.bufferDropped;
+  object["wifiReconnects"] = value.wifiReconnects;
+  object["mqttReconnects"] = value.mqttReconnects;
+  object["failedPublishes"] = value.failedPublishes;
+  object["unreadableRecords"] = value.unreadableRecords;
+  object["pirEdgesDropped"] = value.pirEdgesDropped;
+  object["seqNvsWrites"] = value.seqNvsWrites;
+  if (value.hasAvgPublishCycles) {
+    object["avgPublishCycles"] = value.avgPublishCycles;
+  }
+  if (value.hasMaxPublishCycles) {
+    object["maxPublishCycles"] = value.maxPublishCycles;
+  }
+  if (value.hasTlsWritesPerPublish) {
+    object["tlsWritesPerPublish"] = value.tlsWritesPerPublish;
+  }
+  object["wakeupsPerSec"] = value.wakeupsPerSec;
+  object["maxWakeLatencyUs"] = value.maxWakeLatencyUs;
+  object["avgWakeLatencyUs"] = value.avgWakeLatencyUs;
+  if (value.hasAvgDetectionPublishUs) {
+    object["avgDetectionPublishUs"] = value.avgDetectionPublishUs;
+  }
+  if (value.hasMaxDetectionPublishUs) {
+    object["maxDetectionPublishUs"] = value.maxDetectionPublishUs;
+  }
+  if (value.hasDrainRate) {
+    object["drainRate"] = value.drainRate;
+  }
+  if (value.hasMaxPirGapUs) {
+    object["maxPirGapUs"] = value.maxPirGapUs;
+  }
+  if (value.hasMaxConnectGapUs) {
+    object["maxConnectGapUs"] = value.maxConnectGapUs;
+  }
+  if (value.hasListenInterval) {
+    object["listenInterval"] = value.listenInterval;
+  }
+  if (value.hasSleepWakes) {
+    object["sleepWakes"] = value.sleepWakes;
+  }
+  if (value.hasWakeToPublishMs) {
+    object["wakeToPublishMs"] = value.wakeToPublishMs;
+  }
+  if (value.hasWakeEventsDropped) {
+    object["wakeEventsDropped"] = value.wakeEventsDropped;
+  }
+  if (value.hasInflight) {
+    object["inflight"] = value.inflight;
+  }
+  if (value.hasAvgAckMs) {
+    object["avgAckMs"] = value.avgAckMs;
+  }
+  encodeValue(value.lanes, object.createNestedObject("lanes"));
+  if (value.hasOutbox) {
+    encodeValue(value.outbox, object.createNestedObject("outbox"));
+  }
+}
+
+inline void encodeValue(const StatusMessage& value, JsonObject object) {
+  object["event"] = "status";
+  if (value.hasSeq) {
+    object["seq"] = value.seq;
+  }
+  object["firmware"] = value.firmware;
+  object["uptime"] = value.uptime;
+  object["detectionEnabled"] = value.detectionEnabled;
+  object["cooldown"] = value.cooldown;
+  object["detectionCount"] = value.detectionCount;
+  object["sessionCount"] = value.sessionCount;
+  object["occupied"] = value.occupied;
+  object["powerMode"] = value.powerMode;
+  encodeValue(value.system, object.createNestedObject("system"));
+}
+
+inline void encodeValue(const TwinReportedInterArrival& value, JsonObject object) {
+  object["ewma"] = value.ewma;
+  object["p50"] = value.p50;
+  object["p90"] = value.p90;
+  object["samples"] = value.samples;
+}
+
+inline void encodeValue(const TwinReportedSystem& value, JsonObject object) {
+  object["rssi"] = value.rssi;
+  object["freeHeap"] = value.freeHeap;
+  object["cpuFreq"] = value.cpuFreq;
+  object["buffered"] = value.buffered;
+}
+
+inline void encodeValue(const TwinReportedMessage& value, JsonObject object) {
+  object["firmware"] = value.firmware;
+  object["uptime"] = value.uptime;
+  object["detectionEnabled"] = value.detectionEnabled;
+  object["cooldown"] = value.cooldown;
+  object["minPulse"] = value.minPulse;
+  object["mergeWindow"] = value.mergeWindow;
+  object["riseHold"] = value.riseHold;
+  object["fallHold"] = value.fallHold;
+  object["sessionMode"] = value.sessionMode;
+  object["idleTimeout"] = value.idleTimeout;
+  object["adaptiveCooldown"] = value.adaptiveCooldown;
+  object["maxMessagesPerHour"] = value.maxMessagesPerHour;
+  object["effectiveCooldown"] = value.effectiveCooldown;
+  object["batchWindow"] = value.batchWindow;
+  object["powerMode"] = value.powerMode;
+  object["c2dLatency"] = value.c2dLatency;
+  object["encoding"] = value.encoding;
+  object["inflightWindow"] = value.inflightWindow;
+  object["detectionCount"] = value.detectionCount;
+  encodeValue(value.interArrival, object.createNestedObject("interArrival"));
+  encodeValue(value.system, object.createNestedObject("system"));
+}
+
+inline void encodeValue(const TwinDesiredMessage& value, JsonObject object) {
+  if (value.hasDetectionEnabled) {
+    object["detectionEnabled"] = value.detectionEnabled;
+  }
+  if (value.hasCooldown) {
+    object["cooldown"] = value.cooldown;
+  }
+  if (value.hasSessionMode) {
+    object["sessionMode"] = value.sessionMode;
+  }
+  if (value.hasIdleTimeout) {
+    object["idleTimeout"] = value.idleTimeout;
+  }
+  if (value.hasAdaptiveCooldown) {
+    object["adaptiveCooldown"] = value.adaptiveCooldown;
+  }
+  if (value.hasMaxMessagesPerHour) {
+    object["maxMessagesPerHour"] = value.maxMessagesPerHour;
+  }
+  if (value.hasBatchWindow) {
+    object["batchWindow"] = value.batchWindow;
+  }
+  if (value.hasMinPulse) {
+    object["minPulse"] = value.minPulse;
+  }
+  if (value.hasMergeWindow) {
+    object["mergeWindow"] = value.mergeWindow;
+  }
+  if (value.hasRiseHold) {
+    object["riseHold"] = value.riseHold;
+  }
+  if (value.hasFallHold) {
+    object["fallHold"] = value.fallHold;
+  }
+  if (value.hasPowerMode) {
+    object["powerMode"] = value.powerMode;
+  }
+  if (value.hasC2dLatency) {
+    object["c2dLatency"] = value.c2dLatency;
+  }
+  if (value.hasEncoding) {
+    object["encoding"] = value.encoding;
+  }
+  if (value.hasInflightWindow) {
+    object["inflightWindow"] = value.inflightWindow;
+  }
+}
+
+inline void encodeValue(const C2dCommandMessage& value, JsonObject object) {
+  object["command"] = value.command;
+  if (value.hasValue) {
+    object["value"] = value.value;
+  }
+}
+
+// false si le document est trop petit
+inline bool encodeMessage(const MotionMessage& message, JsonDocument& doc) {
+  encodeValue(message, doc.to<JsonObject>());
+  return !doc.overflowed();
+}
+
+// false si le document est trop petit
+inline bool encodeMessage(const MotionBatchMessage& message, JsonDocument& doc) {
+  encodeValue(message, doc.to<JsonObject>());
+  return !doc.overflowed();
+}
+
+// false si le document est trop petit
+inline bool encodeMessage(const SessionMessage& message, JsonDocument& doc) {
+  encodeValue(message, doc.to<JsonObject>());
+  return !doc.overflowed();
+}
+
+// false si le document est trop petit
+inline bool encodeMessage(const StatusMessage& message, JsonDocument& doc) {
+  encodeValue(message, doc.to<JsonObject>());
+  return !doc.overflowed();
+}
+
+// false si le document est trop petit
+inline bool encodeMessage(const TwinReportedMessage& message, JsonDocument& doc) {
+  encodeValue(message, doc.to<JsonObject>());
+  return !doc.overflowed();
+}
+
+// false si le document est trop petit
+inline bool encodeMessage(const TwinDesiredMessage& message, JsonDocument& doc) {
+  encodeValue(message, doc.to<JsonObject>());
+  return !doc.overflowed();
+}
+
+// false si le document est trop petit
+inline bool encodeMessage(const C2dCommandMessage& message, JsonDocument& doc) {
+  encodeValue(message, doc.to<JsonObject>());
+  return !doc.overflowed();
+}
+
+// === FILTRES DE DÉSÉRIALISATION ===
+// À passer à DeserializationOption::Filter : seuls les champs du schéma
+// sont gardés ($version, métadonnées et champs inconnus n'occupent rien).
+
+constexpr size_t TWIN_DESIRED_MESSAGE_FILTER_SIZE = JSON_OBJECT_SIZE(15);
+inline void buildTwinDesiredFilter(JsonObject filter) {
+  filter["detectionEnabled"] = true;
+  filter["cooldown"] = true;
+  filter["sessionMode"] = true;
+  filter["idleTimeout"] = true;
+  filter["adaptiveCooldown"] = true;
+  filter["maxMessagesPerHour"] = true;
+  filter["batchWindow"] = true;
+  filter["minPulse"] = true;
+  filter["mergeWindow"] = true;
+  filter["riseHold"] = true;
+  filter["fallHold"] = true;
+  filter["powerMode"] = true;
+  filter["c2dLatency"] = true;
+  filter["encoding"] = true;
+  filter["inflightWindow"] = true;
+}
+
+constexpr size_t C2D_COMMAND_MESSAGE_FILTER_SIZE = JSON_OBJECT_SIZE(2);
+inline void buildC2dCommandFilter(JsonObject filter) {
+  filter["command"] = true;
+  filter["value"] = true;
+}
+
+// === DÉCODAGE ===
+
+template <typename T>
+inline bool decodeValue(JsonVariantConst variant, T& value) {
+  if (!variant.is<T>()) {
+    return false;
+  }
+  value = variant.as<T>();
+  return true;
+}
+
+// Champ facultatif : absent, ou présent et valide
+template <typename T>
+inline bool decodeOptional(JsonVariantConst variant, T& value, bool& present) {
+  present = !variant.isNull();
+  return !present || decodeValue(variant, value);
+}
+
+template <typename T, size_t N>
+inline bool decodeList(JsonVariantConst variant, T (&items)[N], size_t& count) {
+  JsonArrayConst array = variant.as<JsonArrayConst>();
+  if (!variant.is<JsonArrayConst>() || array.size() > N) {
+    return false;
+  }
+  count = 0;
+  for (JsonVariantConst item : array) {
+    if (!decodeValue(item, items[count++])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, BatchDetection& value) {
+  JsonArrayConst array = variant.as<JsonArrayConst>();
+  return variant.is<JsonArrayConst>() && array.size() == 2 &&
+         decodeValue(array[0], value.ts) &&
+         decodeValue(array[1], value.sensor);
+}
+
+inline bool decodeValue(JsonVariantConst variant, LaneCounts& value) {
+  JsonArrayConst array = variant.as<JsonArrayConst>();
+  return variant.is<JsonArrayConst>() && array.size() == 2 &&
+         decodeValue(array[0], value.pending) &&
+         decodeValue(array[1], value.dropped);
+}
+
+inline bool decodeValue(JsonVariantConst variant, MotionMessage& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (object["event"] != "motion") {
+    return false;
+  }
+  if (!decodeValue(object["seq"], value.seq)) {
+    return false;
+  }
+  if (!decodeValue(object["ts"], value.ts)) {
+    return false;
+  }
+  if (!decodeValue(object["sensor"], value.sensor)) {
+    return false;
+  }
+  if (!decodeOptional(object["time"], value.time, value.hasTime)) {
+    return false;
+  }
+  if (!decodeOptional(object["wakeToPublishMs"], value.wakeToPublishMs, value.hasWakeToPublishMs)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, MotionBatchMessage& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (object["event"] != "motion") {
+    return false;
+  }
+  if (!decodeValue(object["seq"], value.seq)) {
+    return false;
+  }
+  if (!decodeValue(object["ts"], value.ts)) {
+    return false;
+  }
+  if (!decodeList(object["detections"], value.detections, value.detectionsCount)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, SessionMessage& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (object["event"] != "session") {
+    return false;
+  }
+  if (!decodeValue(object["seq"], value.seq)) {
+    return false;
+  }
+  if (!decodeOptional(object["start"], value.start, value.hasStart)) {
+    return false;
+  }
+  if (!decodeValue(object["startMs"], value.startMs)) {
+    return false;
+  }
+  if (!decodeValue(object["dwell"], value.dwell)) {
+    return false;
+  }
+  if (!decodeValue(object["detections"], value.detections)) {
+    return false;
+  }
+  if (!decodeValue(object["retriggers"], value.retriggers)) {
+    return false;
+  }
+  if (!decodeValue(object["sensors"], value.sensors)) {
+    return false;
+  }
+  if (!decodeOptional(object["partial"], value.partial, value.hasPartial)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, StatusSystemLanes& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeValue(object["twin"], value.twin)) {
+    return false;
+  }
+  if (!decodeValue(object["session"], value.session)) {
+    return false;
+  }
+  if (!decodeValue(object["health"], value.health)) {
+    return false;
+  }
+  if (!decodeValue(object["motion"], value.motion)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, StatusSystemOutbox& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeValue(object["segments"], value.segments)) {
+    return false;
+  }
+  if (!decodeValue(object["erases"], value.erases)) {
+    return false;
+  }
+  if (!decodeValue(object["corrupt"], value.corrupt)) {
+    return false;
+  }
+  if (!decodeValue(object["writeAmp"], value.writeAmp)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, StatusSystem& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeValue(object["rssi"], value.rssi)) {
+    return false;
+  }
+  if (!decodeOptional(object["rssiMin"], value.rssiMin, value.hasRssiMin)) {
+    return false;
+  }
+  if (!decodeOptional(object["rssiMax"], value.rssiMax, value.hasRssiMax)) {
+    return false;
+  }
+  if (!decodeOptional(object["rssiAvg"], value.rssiAvg, value.hasRssiAvg)) {
+    return false;
+  }
+  if (!decodeValue(object["freeHeap"], value.freeHeap)) {
+    return false;
+  }
+  if (!decodeValue(object["minFreeHeap"], value.minFreeHeap)) {
+    return false;
+  }
+  if (!decodeValue(object["cpuFreq"], value.cpuFreq)) {
+    return false;
+  }
+  if (!decodeValue(object["buffered"], value.buffered)) {
+    return false;
+  }
+  if (!decodeValue(object["bufferDropped"], value.bufferDropped)) {
+    return false;
+  }
+  if (!decodeValue(object["wifiReconnects"], value.wifiReconnects)) {
+    return false;
+  }
+  if (!decodeValue(object["mqttReconnects"], value.mqttReconnects)) {
+    return false;
+  }
+  if (!decodeValue(object["failedPublishes"], value.failedPublishes)) {
+    return false;
+  }
+  if (!decodeValue(object["unreadableRecords"], value.unreadableRecords)) {
+    return false;
+  }
+  if (!decodeValue(object["pirEdgesDropped"], value.pirEdgesDropped)) {
+    return false;
+  }
+  if (!decodeValue(object["seqNvsWrites"], value.seqNvsWrites)) {
+    return false;
+  }
+  if (!decodeOptional(object["avgPublishCycles"], value.avgPublishCycles, value.hasAvgPublishCycles)) {
+    return false;
+  }
+  if (!decodeOptional(object["maxPublishCycles"], value.maxPublishCycles, value.hasMaxPublishCycles)) {
+    return false;
+  }
+  if (!decodeOptional(object["tlsWritesPerPublish"], value.tlsWritesPerPublish, value.hasTlsWritesPerPublish)) {
+    return false;
+  }
+  if (!decodeValue(object["wakeupsPerSec"], value.wakeupsPerSec)) {
+    return false;
+  }
+  if (!decodeValue(object["maxWakeLatencyUs"], value.maxWakeLatencyUs)) {
+    return false;
+  }
+  if (!decodeValue(object["avgWakeLatencyUs"], value.avgWakeLatencyUs)) {
+    return false;
+  }
+  if (!decodeOptional(object["avgDetectionPublishUs"], value.avgDetectionPublishUs, value.hasAvgDetectionPublishUs)) {
+    return false;
+  }
+  if (!decodeOptional(object["maxDetectionPublishUs"], value.maxDetectionPublishUs, value.hasMaxDetectionPublishUs)) {
+    return false;
+  }
+  if (!decodeOptional(object["drainRate"], value.drainRate, value.hasDrainRate)) {
+    return false;
+  }
+  if (!decodeOptional(object["maxPirGapUs"], value.maxPirGapUs, value.hasMaxPirGapUs)) {
+    return false;
+  }
+  if (!decodeOptional(object["maxConnectGapUs"], value.maxConnectGapUs, value.hasMaxConnectGapUs)) {
+    return false;
+  }
+  if (!decodeOptional(object["listenInterval"], value.listenInterval, value.hasListenInterval)) {
+    return false;
+  }
+  if (!decodeOptional(object["sleepWakes"], value.sleepWakes, value.hasSleepWakes)) {
+    return false;
+  }
+  if (!decodeOptional(object["wakeToPublishMs"], value.wakeToPublishMs, value.hasWakeToPublishMs)) {
+    return false;
+  }
+  if (!decodeOptional(object["wakeEventsDropped"], value.wakeEventsDropped, value.hasWakeEventsDropped)) {
+    return false;
+  }
+  if (!decodeOptional(object["inflight"], value.inflight, value.hasInflight)) {
+    return false;
+  }
+  if (!decodeOptional(object["avgAckMs"], value.avgAckMs, value.hasAvgAckMs)) {
+    return false;
+  }
+  if (!decodeValue(object["lanes"], value.lanes)) {
+    return false;
+  }
+  if (!decodeOptional(object["outbox"], value.outbox, value.hasOutbox)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, StatusMessage& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (object["event"] != "status") {
+    return false;
+  }
+  if (!decodeOptional(object["seq"], value.seq, value.hasSeq)) {
+    return false;
+  }
+  if (!decodeValue(object["firmware"], value.firmware)) {
+    return false;
+  }
+  if (!decodeValue(object["uptime"], value.uptime)) {
+    return false;
+  }
+  if (!decodeValue(object["detectionEnabled"], value.detectionEnabled)) {
+    return false;
+  }
+  if (!decodeValue(object["cooldown"], value.cooldown)) {
+    return false;
+  }
+  if (!decodeValue(object["detectionCount"], value.detectionCount)) {
+    return false;
+  }
+  if (!decodeValue(object["sessionCount"], value.sessionCount)) {
+    return false;
+  }
+  if (!decodeValue(object["occupied"], value.occupied)) {
+    return false;
+  }
+  if (!decodeValue(object["powerMode"], value.powerMode)) {
+    return false;
+  }
+  if (!decodeValue(object["system"], value.system)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, TwinReportedInterArrival& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeValue(object["ewma"], value.ewma)) {
+    return false;
+  }
+  if (!decodeValue(object["p50"], value.p50)) {
+    return false;
+  }
+  if (!decodeValue(object["p90"], value.p90)) {
+    return false;
+  }
+  if (!decodeValue(object["samples"], value.samples)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, TwinReportedSystem& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeValue(object["rssi"], value.rssi)) {
+    return false;
+  }
+  if (!decodeValue(object["freeHeap"], value.freeHeap)) {
+    return false;
+  }
+  if (!decodeValue(object["cpuFreq"], value.cpuFreq)) {
+    return false;
+  }
+  if (!decodeValue(object["buffered"], value.buffered)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, TwinReportedMessage& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeValue(object["firmware"], value.firmware)) {
+    return false;
+  }
+  if (!decodeValue(object["uptime"], value.uptime)) {
+    return false;
+  }
+  if (!decodeValue(object["detectionEnabled"], value.detectionEnabled)) {
+    return false;
+  }
+  if (!decodeValue(object["cooldown"], value.cooldown)) {
+    return false;
+  }
+  if (!decodeValue(object["minPulse"], value.minPulse)) {
+    return false;
+  }
+  if (!decodeValue(object["mergeWindow"], value.mergeWindow)) {
+    return false;
+  }
+  if (!decodeValue(object["riseHold"], value.riseHold)) {
+    return false;
+  }
+  if (!decodeValue(object["fallHold"], value.fallHold)) {
+    return false;
+  }
+  if (!decodeValue(object["sessionMode"], value.sessionMode)) {
+    return false;
+  }
+  if (!decodeValue(object["idleTimeout"], value.idleTimeout)) {
+    return false;
+  }
+  if (!decodeValue(object["adaptiveCooldown"], value.adaptiveCooldown)) {
+    return false;
+  }
+  if (!decodeValue(object["maxMessagesPerHour"], value.maxMessagesPerHour)) {
+    return false;
+  }
+  if (!decodeValue(object["effectiveCooldown"], value.effectiveCooldown)) {
+    return false;
+  }
+  if (!decodeValue(object["batchWindow"], value.batchWindow)) {
+    return false;
+  }
+  if (!decodeValue(object["powerMode"], value.powerMode)) {
+    return false;
+  }
+  if (!decodeValue(object["c2dLatency"], value.c2dLatency)) {
+    return false;
+  }
+  if (!decodeValue(object["encoding"], value.encoding)) {
+    return false;
+  }
+  if (!decodeValue(object["inflightWindow"], value.inflightWindow)) {
+    return false;
+  }
+  if (!decodeValue(object["detectionCount"], value.detectionCount)) {
+    return false;
+  }
+  if (!decodeValue(object["interArrival"], value.interArrival)) {
+    return false;
+  }
+  if (!decodeValue(object["system"], value.system)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, TwinDesiredMessage& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeOptional(object["detectionEnabled"], value.detectionEnabled, value.hasDetectionEnabled)) {
+    return false;
+  }
+  if (!decodeOptional(object["cooldown"], value.cooldown, value.hasCooldown)) {
+    return false;
+  }
+  if (!decodeOptional(object["sessionMode"], value.sessionMode, value.hasSessionMode)) {
+    return false;
+  }
+  if (!decodeOptional(object["idleTimeout"], value.idleTimeout, value.hasIdleTimeout)) {
+    return false;
+  }
+  if (!decodeOptional(object["adaptiveCooldown"], value.adaptiveCooldown, value.hasAdaptiveCooldown)) {
+    return false;
+  }
+  if (!decodeOptional(object["maxMessagesPerHour"], value.maxMessagesPerHour, value.hasMaxMessagesPerHour)) {
+    return false;
+  }
+  if (!decodeOptional(object["batchWindow"], value.batchWindow, value.hasBatchWindow)) {
+    return false;
+  }
+  if (!decodeOptional(object["minPulse"], value.minPulse, value.hasMinPulse)) {
+    return false;
+  }
+  if (!decodeOptional(object["mergeWindow"], value.mergeWindow, value.hasMergeWindow)) {
+    return false;
+  }
+  if (!decodeOptional(object["riseHold"], value.riseHold, value.hasRiseHold)) {
+    return false;
+  }
+  if (!decodeOptional(object["fallHold"], value.fallHold, value.hasFallHold)) {
+    return false;
+  }
+  if (!decodeOptional(object["powerMode"], value.powerMode, value.hasPowerMode)) {
+    return false;
+  }
+  if (!decodeOptional(object["c2dLatency"], value.c2dLatency, value.hasC2dLatency)) {
+    return false;
+  }
+  if (!decodeOptional(object["encoding"], value.encoding, value.hasEncoding)) {
+    return false;
+  }
+  if (!decodeOptional(object["inflightWindow"], value.inflightWindow, value.hasInflightWindow)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeValue(JsonVariantConst variant, C2dCommandMessage& value) {
+  if (!variant.is<JsonObjectConst>()) {
+    return false;
+  }
+  JsonObjectConst object = variant.as<JsonObjectConst>();
+  if (!decodeValue(object["command"], value.command)) {
+    return false;
+  }
+  if (!decodeOptional(object["value"], value.value, value.hasValue)) {
+    return false;
+  }
+  return true;
+}
+
+inline bool decodeMessage(JsonObjectConst object, MotionMessage& message) {
+  message = MotionMessage();
+  return decodeValue(object, message);
+}
+
+inline bool decodeMessage(JsonObjectConst object, MotionBatchMessage& message) {
+  message = MotionBatchMessage();
+  return decodeValue(object, message);
+}
+
+inline bool decodeMessage(JsonObjectConst object, SessionMessage& message) {
+  message = SessionMessage();
+  return decodeValue(object, message);
+}
+
+inline bool decodeMessage(JsonObjectConst object, StatusMessage& message) {
+  message = StatusMessage();
+  return decodeValue(object, message);
+}
+
+inline bool decodeMessage(JsonObjectConst object, TwinReportedMessage& message) {
+  message = TwinReportedMessage();
+  return decodeValue(object, message);
+}
+
+inline bool decodeMessage(JsonObjectConst object, TwinDesiredMessage& message) {
+  message = TwinDesiredMessage();
+  return decodeValue(object, message);
+}
+
+inline bool decodeMessage(JsonObjectConst object, C2dCommandMessage& message) {
+  message = C2dCommandMessage();
+  return decodeValue(object, message);
+}
+
+// === COMPARAISON ===
+// Égalité champ à champ, pour vérifier un aller-retour encodage → décodage :
+// un champ facultatif absent n'est pas comparé, une chaîne l'est par contenu.
+
+template <typename T>
+inline bool sameValue(const T& a, const T& b) {
+  return a == b;
+}
+
+inline bool sameValue(const char* a, const char* b) {
+  return a == b || (a != nullptr && b != nullptr && strcmp(a, b) == 0);
+}
+
+template <typename T, size_t N>
+inline bool sameList(const T (&a)[N], size_t aCount, const T (&b)[N], size_t bCount) {
+  if (aCount != bCount) {
+    return false;
+  }
+  for (size_t i = 0; i < aCount; i++) {
+    if (!sameValue(a[i], b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool operator==(const BatchDetection& a, const BatchDetection& b) {
+  return sameValue(a.ts, b.ts) &&
+         sameValue(a.sensor, b.sensor);
+}
+
+inline bool operator!=(const BatchDetection& a, const BatchDetection& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const LaneCounts& a, const LaneCounts& b) {
+  return sameValue(a.pending, b.pending) &&
+         sameValue(a.dropped, b.dropped);
+}
+
+inline bool operator!=(const LaneCounts& a, const LaneCounts& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const MotionMessage& a, const MotionMessage& b) {
+  return sameValue(a.seq, b.seq) &&
+         sameValue(a.ts, b.ts) &&
+         sameValue(a.sensor, b.sensor) &&
+         a.hasTime == b.hasTime &&
+         (!a.hasTime || sameValue(a.time, b.time)) &&
+         a.hasWakeToPublishMs == b.hasWakeToPublishMs &&
+         (!a.hasWakeToPublishMs || sameValue(a.wakeToPublishMs, b.wakeToPublishMs));
+}
+
+inline bool operator!=(const MotionMessage& a, const MotionMessage& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const MotionBatchMessage& a, const MotionBatchMessage& b) {
+  return sameValue(a.seq, b.seq) &&
+         sameValue(a.ts, b.ts) &&
+         sameList(a.detections, a.detectionsCount, b.detections, b.detectionsCount);
+}
+
+inline bool operator!=(const MotionBatchMessage& a, const MotionBatchMessage& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const SessionMessage& a, const SessionMessage& b) {
+  return sameValue(a.seq, b.seq) &&
+         a.hasStart == b.hasStart &&
+         (!a.hasStart || sameValue(a.start, b.start)) &&
+         sameValue(a.startMs, b.startMs) &&
+         sameValue(a.dwell, b.dwell) &&
+         sameValue(a.detections, b.detections) &&
+         sameValue(a.retriggers, b.retriggers) &&
+         sameValue(a.sensors, b.sensors) &&
+         a.hasPartial == b.hasPartial &&
+         (!a.hasPartial || sameValue(a.partial, b.partial));
+}
+
+inline bool operator!=(const SessionMessage& a, const SessionMessage& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const StatusSystemLanes& a, const StatusSystemLanes& b) {
+  return sameValue(a.twin, b.twin) &&
+         sameValue(a.session, b.session) &&
+         sameValue(a.health, b.health) &&
+         sameValue(a.motion, b.motion);
+}
+
+inline bool operator!=(const StatusSystemLanes& a, const StatusSystemLanes& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const StatusSystemOutbox& a, const StatusSystemOutbox& b) {
+  return sameValue(a.segments, b.segments) &&
+         sameValue(a.erases, b.erases) &&
+         sameValue(a.corrupt, b.corrupt) &&
+         sameValue(a.writeAmp, b.writeAmp);
+}
+
+inline bool operator!=(const StatusSystemOutbox& a, const StatusSystemOutbox& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const StatusSystem& a, const StatusSystem& b) {
+  return sameValue(a.rssi, b.rssi) &&
+         a.hasRssiMin == b.hasRssiMin &&
+         (!a.hasRssiMin || sameValue(a.rssiMin, b.rssiMin)) &&
+         a.hasRssiMax == b.hasRssiMax &&
+         (!a.hasRssiMax || sameValue(a.rssiMax, b.rssiMax)) &&
+         a.hasRssiAvg == b.hasRssiAvg &&
+         (!a.hasRssiAvg || sameValue(a.rssiAvg, b.rssiAvg)) &&
+         sameValue(a.freeHeap, b.freeHeap) &&
+         sameValue(a.minFreeHeap, b.minFreeHeap) &&
+         sameValue(a.cpuFreq, b.cpuFreq) &&
+         sameValue(a.buffered, b.buffered) &&
+         sameValue(a.bufferDropped, b.bufferDropped) &&
+         sameValue(a.wifiReconnects, b.wifiReconnects) &&
+         sameValue(a.mqttReconnects, b.mqttReconnects) &&
+         sameValue(a.failedPublishes, b.failedPublishes) &&
+         sameValue(a.unreadableRecords, b.unreadableRecords) &&
+         sameValue(a.pirEdgesDropped, b.pirEdgesDropped) &&
+         sameValue(a.seqNvsWrites, b.seqNvsWrites) &&
+         a.hasAvgPublishCycles == b.hasAvgPublishCycles &&
+         (!a.hasAvgPublishCycles || sameValue(a.avgPublishCycles, b.avgPublishCycles)) &&
+         a.hasMaxPublishCycles == b.hasMaxPublishCycles &&
+         (!a.hasMaxPublishCycles || sameValue(a.maxPublishCycles, b.maxPublishCycles)) &&
+         a.hasTlsWritesPerPublish == b.hasTlsWritesPerPublish &&
+         (!a.hasTlsWritesPerPublish || sameValue(a.tlsWritesPerPublish, b.tlsWritesPerPublish)) &&
+         sameValue(a.wakeupsPerSec, b.wakeupsPerSec) &&
+         sameValue(a.maxWakeLatencyUs, b.maxWakeLatencyUs) &&
+         sameValue(a.avgWakeLatencyUs, b.avgWakeLatencyUs) &&
+         a.hasAvgDetectionPublishUs == b.hasAvgDetectionPublishUs &&
+         (!a.hasAvgDetectionPublishUs || sameValue(a.avgDetectionPublishUs, b.avgDetectionPublishUs)) &&
+         a.hasMaxDetectionPublishUs == b.hasMaxDetectionPublishUs &&
+         (!a.hasMaxDetectionPublishUs || sameValue(a.maxDetectionPublishUs, b.maxDetectionPublishUs)) &&
+         a.hasDrainRate == b.hasDrainRate &&
+         (!a.hasDrainRate || sameValue(a.drainRate, b.drainRate)) &&
+         a.hasMaxPirGapUs == b.hasMaxPirGapUs &&
+         (!a.hasMaxPirGapUs || sameValue(a.maxPirGapUs, b.maxPirGapUs)) &&
+         a.hasMaxConnectGapUs == b.hasMaxConnectGapUs &&
+         (!a.hasMaxConnectGapUs || sameValue(a.maxConnectGapUs, b.maxConnectGapUs)) &&
+         a.hasListenInterval == b.hasListenInterval &&
+         (!a.hasListenInterval || sameValue(a.listenInterval, b.listenInterval)) &&
+         a.hasSleepWakes == b.hasSleepWakes &&
+         (!a.hasSleepWakes || sameValue(a.sleepWakes, b.sleepWakes)) &&
+         a.hasWakeToPublishMs == b.hasWakeToPublishMs &&
+         (!a.hasWakeToPublishMs || sameValue(a.wakeToPublishMs, b.wakeToPublishMs)) &&
+         a.hasWakeEventsDropped == b.hasWakeEventsDropped &&
+         (!a.hasWakeEventsDropped || sameValue(a.wakeEventsDropped, b.wakeEventsDropped)) &&
+         a.hasInflight == b.hasInflight &&
+         (!a.hasInflight || sameValue(a.inflight, b.inflight)) &&
+         a.hasAvgAckMs == b.hasAvgAckMs &&
+         (!a.hasAvgAckMs || sameValue(a.avgAckMs, b.avgAckMs)) &&
+         sameValue(a.lanes, b.lanes) &&
+         a.hasOutbox == b.hasOutbox &&
+         (!a.hasOutbox || sameValue(a.outbox, b.outbox));
+}
+
+inline bool operator!=(const StatusSystem& a, const StatusSystem& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const StatusMessage& a, const StatusMessage& b) {
+  return a.hasSeq == b.hasSeq &&
+         (!a.hasSeq || sameValue(a.seq, b.seq)) &&
+         sameValue(a.firmware, b.firmware) &&
+         sameValue(a.uptime, b.uptime) &&
+         sameValue(a.detectionEnabled, b.detectionEnabled) &&
+         sameValue(a.cooldown, b.cooldown) &&
+         sameValue(a.detectionCount, b.detectionCount) &&
+         sameValue(a.sessionCount, b.sessionCount) &&
+         sameValue(a.occupied, b.occupied) &&
+         sameValue(a.powerMode, b.powerMode) &&
+         sameValue(a.system, b.system);
+}
+
+inline bool operator!=(const StatusMessage& a, const StatusMessage& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const TwinReportedInterArrival& a, const TwinReportedInterArrival& b) {
+  return sameValue(a.ewma, b.ewma) &&
+         sameValue(a.p50, b.p50) &&
+         sameValue(a.p90, b.p90) &&
+         sameValue(a.samples, b.samples);
+}
+
+inline bool operator!=(const TwinReportedInterArrival& a, const TwinReportedInterArrival& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const TwinReportedSystem& a, const TwinReportedSystem& b) {
+  return sameValue(a.rssi, b.rssi) &&
+         sameValue(a.freeHeap, b.freeHeap) &&
+         sameValue(a.cpuFreq, b.cpuFreq) &&
+         sameValue(a.buffered, b.buffered);
+}
+
+inline bool operator!=(const TwinReportedSystem& a, const TwinReportedSystem& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const TwinReportedMessage& a, const TwinReportedMessage& b) {
+  return sameValue(a.firmware, b.firmware) &&
+         sameValue(a.uptime, b.uptime) &&
+         sameValue(a.detectionEnabled, b.detectionEnabled) &&
+         sameValue(a.cooldown, b.cooldown) &&
+         sameValue(a.minPulse, b.minPulse) &&
+         sameValue(a.mergeWindow, b.mergeWindow) &&
+         sameValue(a.riseHold, b.riseHold) &&
+         sameValue(a.fallHold, b.fallHold) &&
+         sameValue(a.sessionMode, b.sessionMode) &&
+         sameValue(a.idleTimeout, b.idleTimeout) &&
+         sameValue(a.adaptiveCooldown, b.adaptiveCooldown) &&
+         sameValue(a.maxMessagesPerHour, b.maxMessagesPerHour) &&
+         sameValue(a.effectiveCooldown, b.effectiveCooldown) &&
+         sameValue(a.batchWindow, b.batchWindow) &&
+         sameValue(a.powerMode, b.powerMode) &&
+         sameValue(a.c2dLatency, b.c2dLatency) &&
+         sameValue(a.encoding, b.encoding) &&
+         sameValue(a.inflightWindow, b.inflightWindow) &&
+         sameValue(a.detectionCount, b.detectionCount) &&
+         sameValue(a.interArrival, b.interArrival) &&
+         sameValue(a.system, b.system);
+}
+
+inline bool operator!=(const TwinReportedMessage& a, const TwinReportedMessage& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const TwinDesiredMessage& a, const TwinDesiredMessage& b) {
+  return a.hasDetectionEnabled == b.hasDetectionEnabled &&
+         (!a.hasDetectionEnabled || sameValue(a.detectionEnabled, b.detectionEnabled)) &&
+         a.hasCooldown == b.hasCooldown &&
+         (!a.hasCooldown || sameValue(a.cooldown, b.cooldown)) &&
+         a.hasSessionMode == b.hasSessionMode &&
+         (!a.hasSessionMode || sameValue(a.sessionMode, b.sessionMode)) &&
+         a.hasIdleTimeout == b.hasIdleTimeout &&
+         (!a.hasIdleTimeout || sameValue(a.idleTimeout, b.idleTimeout)) &&
+         a.hasAdaptiveCooldown == b.hasAdaptiveCooldown &&
+         (!a.hasAdaptiveCooldown || sameValue(a.adaptiveCooldown, b.adaptiveCooldown)) &&
+         a.hasMaxMessagesPerHour == b.hasMaxMessagesPerHour &&
+         (!a.hasMaxMessagesPerHour || sameValue(a.maxMessagesPerHour, b.maxMessagesPerHour)) &&
+         a.hasBatchWindow == b.hasBatchWindow &&
+         (!a.hasBatchWindow || sameValue(a.batchWindow, b.batchWindow)) &&
+         a.hasMinPulse == b.hasMinPulse &&
+         (!a.hasMinPulse || sameValue(a.minPulse, b.minPulse)) &&
+         a.hasMergeWindow == b.hasMergeWindow &&
+         (!a.hasMergeWindow || sameValue(a.mergeWindow, b.mergeWindow)) &&
+         a.hasRiseHold == b.hasRiseHold &&
+         (!a.hasRiseHold || sameValue(a.riseHold, b.riseHold)) &&
+         a.hasFallHold == b.hasFallHold &&
+         (!a.hasFallHold || sameValue(a.fallHold, b.fallHold)) &&
+         a.hasPowerMode == b.hasPowerMode &&
+         (!a.hasPowerMode || sameValue(a.powerMode, b.powerMode)) &&
+         a.hasC2dLatency == b.hasC2dLatency &&
+         (!a.hasC2dLatency || sameValue(a.c2dLatency, b.c2dLatency)) &&
+         a.hasEncoding == b.hasEncoding &&
+         (!a.hasEncoding || sameValue(a.encoding, b.encoding)) &&
+         a.hasInflightWindow == b.hasInflightWindow &&
+         (!a.hasInflightWindow || sameValue(a.inflightWindow, b.inflightWindow));
+}
+
+inline bool operator!=(const TwinDesiredMessage& a, const TwinDesiredMessage& b) {
+  return !(a == b);
+}
+
+inline bool operator==(const C2dCommandMessage& a, const C2dCommandMessage& b) {
+  return sameValue(a.command, b.command) &&
+         a.hasValue == b.hasValue &&
+         (!a.hasValue || sameValue(a.value, b.value));
+}
+
+inline bool operator!=(const C2dCommandMessage& a, const C2dCommandMessage& b) {
+  return !(a == b);
+}
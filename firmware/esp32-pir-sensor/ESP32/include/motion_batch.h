@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// === REGROUPEMENT DES DÉTECTIONS ===
+// Accumule les détections pendant une fenêtre de temps ; le lot est
+// publié en un seul message quand la fenêtre expire ou quand il est plein.
+// La capacité est choisie par l'appelant pour que le message rendu tienne
+// dans MQTT_MAX_PACKET_SIZE.
+
+struct MotionBatchEntry {
+  uint32_t timestampMs;  // ms depuis le boot
+  uint8_t sensor;
+};
+
+template <size_t Capacity>
+class MotionBatch {
+  static_assert(Capacity >= 1, "Capacity doit être >= 1");
+
+ public:
+  // Renvoie false si le lot est déjà plein
+  bool add(const MotionBatchEntry& entry) {
+    if (size_ >= Capacity) {
+      return false;
+    }
+    if (size_ == 0) {
+      openedMs_ = entry.timestampMs;
+    }
+    entries_[size_++] = entry;
+    return true;
+  }
+
+  bool full() const { return size_ >= Capacity; }
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  bool expired(uint32_t nowMs, uint32_t windowMs) const {
+    return size_ > 0 && (uint32_t)(nowMs - openedMs_) >= windowMs;
+  }
+
+  // Instant d'expiration de la fenêtre ouverte
+  uint32_t deadlineMs(uint32_t windowMs) const { return openedMs_ + windowMs; }
+
+  const MotionBatchEntry& operator[](size_t i) const { return entries_[i]; }
+
+  void clear() { size_ = 0; }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  MotionBatchEntry entries_[Capacity];
+  size_t size_ = 0;
+  uint32_t openedMs_ = 0;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+
+// === MOTEUR DE SESSIONS D'OCCUPATION ===
+// Regroupe les événements PIR d'une pièce en sessions : une session
+// s'ouvre au premier mouvement, compte les redéclenchements et se ferme
+// quand plus aucun capteur n'a vu de mouvement pendant idleTimeoutUs.
+// Une session plus longue que maxDurationUs est découpée (partial = true)
+// pour ne pas rester silencieux pendant des heures, tant qu'un capteur
+// voit encore du mouvement.
+
+struct OccupancySession {
+  uint64_t startUs = 0;      // Premier mouvement (µs depuis le boot)
+  uint64_t endUs = 0;        // Dernière activité
+  uint32_t detections = 0;   // Débuts de mouvement validés
+  uint32_t retriggers = 0;   // Activité pendant la session (hors premier mouvement)
+  uint32_t sensorMask = 0;   // Capteurs ayant participé
+  bool partial = false;      // Session découpée, encore en cours
+
+  uint32_t dwellMs() const { return (uint32_t)((endUs - startUs) / 1000); }
+};
+
+class OccupancyEngine {
+ public:
+  // Début de mouvement validé par le pipeline
+  void onMotionStart(uint8_t sensor, uint64_t nowUs) {
+    uint32_t bit = 1UL << sensor;
+    if (!open_) {
+      open_ = true;
+      current_ = OccupancySession();
+      current_.startUs = nowUs;
+    } else {
+      current_.retriggers++;
+    }
+    current_.detections++;
+    current_.sensorMask |= bit;
+    activeMask_ |= bit;
+    touch(nowUs);
+  }
+
+  // Fin de mouvement d'un capteur
+  void onMotionEnd(uint8_t sensor, uint64_t nowUs) {
+    activeMask_ &= ~(1UL << sensor);
+    if (open_) {
+      touch(nowUs);
+    }
+  }
+
+  // Tous les capteurs repassent au repos (détection désactivée)
+  void onAllMotionEnd(uint64_t nowUs) {
+    activeMask_ = 0;
+    if (open_) {
+      touch(nowUs);
+    }
+  }
+
+  // Présence sans nouveau mouvement (redéclenchement fusionné, cooldown)
+  void onActivity(uint8_t sensor, uint64_t nowUs) {
+    if (!open_) {
+      return;
+    }
+    current_.retriggers++;
+    current_.sensorMask |= 1UL << sensor;
+    touch(nowUs);
+  }
+
+  // Renvoie true quand une session (complète ou découpée) est à publier
+  bool poll(uint64_t nowUs, uint64_t idleTimeoutUs, uint64_t maxDurationUs, OccupancySession& out) {
+    if (!open_) {
+      return false;
+    }
+
+    if (activeMask_ == 0 && nowUs - current_.endUs >= idleTimeoutUs) {
+      out = current_;
+      out.partial = false;
+      open_ = false;
+      return true;
+    }
+
+    // Découpage seulement pendant un mouvement : au repos, la session se
+    // ferme d'elle-même après idleTimeoutUs et la suite serait vide
+    if (activeMask_ != 0 && maxDurationUs > 0 && nowUs - current_.startUs >= maxDurationUs) {
+      out = current_;
+      out.endUs = nowUs;
+      out.partial = true;
+      current_ = OccupancySession();
+      current_.startUs = nowUs;
+      current_.endUs = nowUs;
+      current_.sensorMask = activeMask_;
+      return true;
+    }
+
+    return false;
+  }
+
+  // Échéance de fermeture de la session ouverte (UINT64_MAX si aucune)
+  uint64_t nextDeadlineUs(uint64_t idleTimeoutUs, uint64_t maxDurationUs) const {
+    if (!open_) {
+      return UINT64_MAX;
+    }
+    if (activeMask_ == 0) {
+      return current_.endUs + idleTimeoutUs;
+    }
+    return maxDurationUs > 0 ? current_.startUs + maxDurationUs : UINT64_MAX;
+  }
+
+  void reset() {
+    open_ = false;
+    activeMask_ = 0;
+  }
+
+  bool isOpen() const { return open_; }
+  const OccupancySession& current() const { return current_; }
+
+ private:
+  void touch(uint64_t nowUs) {
+    if (nowUs > current_.endUs) {
+      current_.endUs = nowUs;
+    }
+  }
+
+  OccupancySession current_;
+  uint32_t activeMask_ = 0;
+  bool open_ = false;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "detection_pipeline.h"
+#include "pir_edge_queue.h"
+
+// === DÉTECTEUR MULTI-PIR ===
+// Indépendant du matériel : reçoit des instantanés horodatés du registre
+// d'entrées GPIO (PirEdge), en extrait les transitions de chaque capteur
+// et les fait passer dans un DetectionPipeline. Seuls les bits qui ont
+// changé sont parcourus : le coût d'un front ne dépend pas du nombre
+// de capteurs.
+
+// Masque des bits GPIO correspondant à une table de broches
+template <size_t N>
+constexpr uint32_t pirPinMask(const uint8_t (&pins)[N], size_t i = 0) {
+  return i < N ? ((1UL << pins[i]) | pirPinMask(pins, i + 1)) : 0;
+}
+
+template <size_t N>
+constexpr bool pirPinsValid(const uint8_t (&pins)[N], size_t i = 0) {
+  return i < N ? (pins[i] < 32 && pirPinsValid(pins, i + 1)) : true;
+}
+
+template <size_t SensorCount, class Params, template <size_t> class... Stages>
+class PirBank {
+ public:
+  template <size_t N>
+  explicit PirBank(const uint8_t (&pins)[N]) {
+    static_assert(N == SensorCount, "Table de broches incohérente");
+    for (size_t i = 0; i < 32; i++) {
+      sensorOfBit_[i] = 0xFF;
+    }
+    for (size_t i = 0; i < SensorCount; i++) {
+      sensorOfBit_[pins[i]] = (uint8_t)i;
+      pinMask_ |= 1UL << pins[i];
+    }
+  }
+
+  // Applique un instantané du registre GPIO.
+  // sink(sensorIndex, event, timestampUs, cooldownRemainingUs) est appelé
+  // pour chaque événement produit.
+  template <typename Sink>
+  void process(const PirEdge& edge, Sink&& sink) {
+    uint32_t changed = (edge.levels ^ lastLevels_) & pinMask_;
+
+    while (changed) {
+      uint32_t bit = (uint32_t)__builtin_ctz(changed);
+      changed &= changed - 1;
+
+      PirSignal signal;
+      signal.sensor = sensorOfBit_[bit];
+      signal.level = (edge.levels >> bit) & 1U;
+      signal.timestampUs = edge.timestampUs;
+      pipeline_.process(signal, sink);
+    }
+
+    lastLevels_ = (lastLevels_ & ~pinMask_) | (edge.levels & pinMask_);
+  }
+
+  // Libère les événements différés par le pipeline
+  template <typename Sink>
+  void poll(uint64_t nowUs, Sink&& sink) {
+    pipeline_.poll(nowUs, sink);
+  }
+
+  // Met à jour les niveaux sans produire d'événement (détection désactivée)
+  void resync(const PirEdge& edge) {
+    lastLevels_ = (lastLevels_ & ~pinMask_) | (edge.levels & pinMask_);
+  }
+
+  void clearMotion() { pipeline_.clearMotion(); }
+
+  bool anyMotion() const { return pipeline_.anyMotion(); }
+  bool motionInProgress(size_t i) const { return (pipeline_.motionMask() >> i) & 1U; }
+  uint32_t motionMask() const { return pipeline_.motionMask(); }
+  uint32_t pinMask() const { return pinMask_; }
+  uint64_t nextDeadlineUs() const { return pipeline_.nextDeadlineUs(); }
+
+  Params& params() { return pipeline_.params(); }
+
+ private:
+  DetectionPipeline<SensorCount, Params, Stages...> pipeline_;
+  uint8_t sensorOfBit_[32];
+  uint32_t pinMask_ = 0;
+  uint32_t lastLevels_ = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// === FILE DE FRONTS PIR (ISR → LOOP) ===
+// File circulaire lock-free mono-producteur / mono-consommateur.
+// Le producteur est l'ISR GPIO, le consommateur est loop().
+// Aucune dépendance Arduino : compilable et testable sur Linux.
+
+struct PirEdge {
+  uint64_t timestampUs;  // Horodatage du front (µs depuis le boot)
+  uint32_t levels;       // Instantané du registre d'entrées GPIO0-31
+};
+
+template <size_t Capacity>
+class PirEdgeQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity doit être une puissance de 2");
+
+ public:
+  // Appelé uniquement depuis l'ISR (producteur). Toujours mis en ligne :
+  // une copie hors ligne finirait en flash, hors de l'IRAM de l'ISR.
+  __attribute__((always_inline)) bool push(const PirEdge& edge) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= Capacity) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head & (Capacity - 1)] = edge;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Appelé uniquement depuis loop() (consommateur)
+  bool pop(PirEdge& edge) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (tail == head) {
+      return false;
+    }
+    edge = slots_[tail & (Capacity - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  // Fronts perdus parce que la file était pleine
+  uint32_t dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  PirEdge slots_[Capacity];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// === FILE D'ÉVÉNEMENTS CONSERVÉE EN MÉMOIRE RTC ===
+// Détections en attente de publication qui doivent survivre au deep sleep.
+// Agrégat sans constructeur ni initialiseur de membre : placée en
+// RTC_DATA_ATTR, elle n'est remise à zéro qu'au démarrage à froid et
+// n'est pas réinitialisée par le code C++ à chaque réveil.
+// Quand la file est pleine, l'événement le plus ancien est écrasé.
+
+struct RtcMotionEvent {
+  uint64_t seq;     // Numéro de séquence du message
+  uint32_t epoch;   // Heure Unix de la détection (0 si l'heure n'est pas connue)
+  uint8_t sensor;
+};
+
+template <size_t Capacity>
+struct RtcEventQueue {
+  static_assert(Capacity >= 1 && Capacity <= 255, "Capacity doit être entre 1 et 255");
+
+  RtcMotionEvent events[Capacity];
+  uint8_t head;      // Plus ancien événement
+  uint8_t count;
+  uint32_t dropped;  // Événements écrasés faute de place
+
+  void reset() {
+    head = 0;
+    count = 0;
+    dropped = 0;
+  }
+
+  void push(const RtcMotionEvent& event) {
+    if (count >= Capacity) {
+      head = (uint8_t)((head + 1) % Capacity);
+      count--;
+      dropped++;
+    }
+    events[(head + count) % Capacity] = event;
+    count++;
+  }
+
+  const RtcMotionEvent& front() const { return events[head]; }
+  const RtcMotionEvent& at(size_t index) const { return events[(head + index) % Capacity]; }
+
+  void pop() {
+    if (count == 0) {
+      return;
+    }
+    head = (uint8_t)((head + 1) % Capacity);
+    count--;
+  }
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+};
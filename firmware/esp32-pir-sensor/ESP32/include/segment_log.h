@@ -0,0 +1,582 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// === JOURNAL PERSISTANT EN FLASH (OUTBOX) ===
+// Journal en ajout seul sur une partition flash découpée en segments d'un
+// secteur (4 Ko), utilisés en anneau. Chaque segment commence par un
+// en-tête numéroté ; chaque enregistrement porte sa longueur, son type
+// et un CRC32. Les ajouts sont regroupés en RAM puis écrits par flush()
+// (une écriture flash par lot). La lecture est FIFO : commit() marque le
+// dernier enregistrement consommé en passant un octet de 0xFF à 0x00
+// (la flash NOR n'efface pas pour passer des bits à 0), au montage tout
+// ce qui précède la dernière marque est considéré comme envoyé.
+// Un enregistrement consommé mais pas encore marqué est renvoyé après un
+// redémarrage (au moins une fois). Journal plein : le segment le plus
+// ancien est effacé et ses enregistrements non envoyés sont perdus.
+//
+// La marque de consommation réécrit un octet en place : la partition ne
+// doit pas être chiffrée (flash encryption chiffre par blocs de 16 octets,
+// un octet ne peut plus y passer seul de 0xFF à 0x00).
+//
+// Chaque segment porte l'identifiant de format du journal (`layout`) : au
+// montage, les segments d'un autre format (zone déplacée) sont effacés au
+// lieu d'être relus comme des enregistrements de ce journal.
+//
+// Flash doit fournir :
+//   size_t size() const;
+//   bool read(size_t offset, void* dst, size_t length);
+//   bool write(size_t offset, const void* src, size_t length);
+//   bool eraseSector(size_t offset);
+
+const size_t SEGMENT_LOG_SECTOR_SIZE = 4096;
+
+// CRC-32 (polynôme 0xEDB88320), table de 16 entrées
+inline uint32_t segmentLogCrc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = (crc >> 4) ^ table[(crc ^ data[i]) & 0x0F];
+    crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0x0F];
+  }
+  return ~crc;
+}
+
+struct LogRecordInfo {
+  uint16_t length;
+  uint8_t type;
+};
+
+// Emplacement d'un enregistrement lu, à marquer plus tard (commitThrough)
+struct LogPosition {
+  uint32_t segmentSeq;   // Numéro du segment au moment de la lecture
+  uint32_t address;
+};
+
+// Position de lecture complète, pour relire ce qui a été consommé depuis (rewind)
+struct LogReadMark {
+  LogPosition position;
+  uint32_t consumed;     // Compteur de consume() au moment de la marque
+  size_t lastConsumedAddr;
+  bool uncommitted;
+};
+
+template <class Flash, size_t StagingSize>
+class SegmentLog {
+  struct SegmentHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t seqCheck;   // ~seq : en-tête à moitié écrit = segment invalide
+    uint32_t layout;     // Format du journal
+  };
+
+  struct RecordHeader {
+    uint16_t length;     // 0xFFFF : zone effacée, fin du segment
+    uint8_t type;
+    uint8_t state;       // RECORD_LIVE, puis RECORD_CONSUMED une fois envoyé
+    uint32_t crc;        // length + type + payload
+  };
+
+  static const uint32_t SEGMENT_MAGIC = 0x3158424F;  // "OBX1"
+  static const uint8_t RECORD_LIVE = 0xFF;
+  static const uint8_t RECORD_CONSUMED = 0x00;
+  static const size_t SEGMENT_HEADER_SIZE = sizeof(SegmentHeader);
+  static const size_t RECORD_HEADER_SIZE = sizeof(RecordHeader);
+
+  static_assert(sizeof(SegmentHeader) == 16, "En-tête de segment sur 16 octets");
+  static_assert(sizeof(RecordHeader) == 8, "En-tête d'enregistrement sur 8 octets");
+  static_assert(StagingSize >= 64 && StagingSize % 4 == 0, "StagingSize doit être un multiple de 4 >= 64");
+  static_assert(StagingSize <= SEGMENT_LOG_SECTOR_SIZE - sizeof(SegmentHeader), "StagingSize dépasse un segment");
+
+ public:
+  explicit SegmentLog(Flash& flash, uint32_t layout = 0) : flash_(flash), layout_(layout) {}
+
+  // Retrouve les positions d'écriture et de lecture ; formate une partition vierge
+  bool mount() {
+    mounted_ = false;
+    segments_ = flash_.size() / SEGMENT_LOG_SECTOR_SIZE;
+    if (segments_ < 2) {
+      return false;
+    }
+
+    bool found = false;
+    uint32_t minSeq = 0;
+    for (size_t i = 0; i < segments_; i++) {
+      uint32_t seq;
+      uint32_t layout;
+      if (!readSegmentHeader(i, seq, &layout)) {
+        continue;
+      }
+      if (layout != layout_) {
+        // Autre format : rien de ce segment ne peut être relu
+        if (!flash_.eraseSector(address(i, 0))) {
+          return false;
+        }
+        erases_++;
+        foreign_++;
+        continue;
+      }
+      if (!found || (int32_t)(seq - minSeq) < 0) {
+        minSeq = seq;
+        tail_ = i;
+      }
+      if (!found || (int32_t)(seq - headSeq_) > 0) {
+        headSeq_ = seq;
+        head_ = i;
+      }
+      found = true;
+    }
+    if (!found) {
+      return format();
+    }
+
+    pending_ = 0;
+    hasLastRecord_ = false;
+    readSeg_ = tail_;
+    readOff_ = SEGMENT_HEADER_SIZE;
+    for (size_t seg = tail_;; seg = next(seg)) {
+      uint32_t seq;
+      size_t end = SEGMENT_LOG_SECTOR_SIZE;
+      if (readSegmentHeader(seg, seq)) {
+        bool clean = scanSegment(seg, end);
+        if (seg == head_) {
+          // Fin corrompue : on écrira dans le segment suivant
+          writeOff_ = clean ? end : SEGMENT_LOG_SECTOR_SIZE;
+        }
+      }
+      if (seg == head_) {
+        break;
+      }
+    }
+
+    stagedBytes_ = 0;
+    stagedCount_ = 0;
+    uncommitted_ = false;
+    mounted_ = true;
+    return true;
+  }
+
+  // Ajoute un enregistrement au lot en RAM (écrit en flash au prochain flush)
+  bool append(uint8_t type, const uint8_t* payload, size_t length) {
+    if (!mounted_ || length > maxPayload()) {
+      tooLarge_++;
+      return false;
+    }
+    size_t size = recordSize(length);
+    if (stagedBytes_ + size > StagingSize && !flush()) {
+      return false;
+    }
+
+    RecordHeader header;
+    header.length = (uint16_t)length;
+    header.type = type;
+    header.state = RECORD_LIVE;
+    header.crc = recordCrc(header, payload);
+
+    uint8_t* dst = staging_ + stagedBytes_;
+    memcpy(dst, &header, RECORD_HEADER_SIZE);
+    memcpy(dst + RECORD_HEADER_SIZE, payload, length);
+    memset(dst + RECORD_HEADER_SIZE + length, 0xFF, size - RECORD_HEADER_SIZE - length);
+    stagedBytes_ += size;
+    stagedCount_++;
+    payloadBytes_ += length;
+    return true;
+  }
+
+  // Écrit le lot en RAM : une écriture flash par segment touché
+  bool flush() {
+    size_t pos = 0;
+    while (pos < stagedBytes_) {
+      if (writeOff_ + stagedRecordSize(pos) > SEGMENT_LOG_SECTOR_SIZE && !advanceHead()) {
+        break;
+      }
+
+      size_t runStart = pos;
+      size_t runRecords = 0;
+      size_t lastOffset = writeOff_;
+      while (pos < stagedBytes_) {
+        size_t size = stagedRecordSize(pos);
+        if (writeOff_ + (pos - runStart) + size > SEGMENT_LOG_SECTOR_SIZE) {
+          break;
+        }
+        lastOffset = writeOff_ + (pos - runStart);
+        pos += size;
+        runRecords++;
+      }
+
+      size_t runBytes = pos - runStart;
+      if (!flash_.write(address(head_, writeOff_), staging_ + runStart, runBytes)) {
+        pos = runStart;
+        break;
+      }
+      flashBytes_ += runBytes;
+      writeOff_ += runBytes;
+      pending_ += runRecords;
+      stagedCount_ -= runRecords;
+      lastRecordAddr_ = address(head_, lastOffset);
+      hasLastRecord_ = true;
+    }
+
+    if (pos > 0) {
+      memmove(staging_, staging_ + pos, stagedBytes_ - pos);
+      stagedBytes_ -= pos;
+    }
+    return stagedBytes_ == 0;
+  }
+
+  // Plus ancien enregistrement écrit en flash et non consommé.
+  // payload doit pouvoir contenir maxPayload() octets.
+  bool peek(LogRecordInfo& info, uint8_t* payload) {
+    if (!mounted_) {
+      return false;
+    }
+    for (;;) {
+      if (readSeg_ == head_ && readOff_ >= writeOff_) {
+        pending_ = 0;
+        return false;
+      }
+
+      RecordHeader header;
+      header.length = 0xFFFF;
+      bool readable = readOff_ + RECORD_HEADER_SIZE <= SEGMENT_LOG_SECTOR_SIZE &&
+                      flash_.read(address(readSeg_, readOff_), &header, RECORD_HEADER_SIZE) &&
+                      header.length <= maxPayload() &&
+                      readOff_ + recordSize(header.length) <= SEGMENT_LOG_SECTOR_SIZE &&
+                      flash_.read(address(readSeg_, readOff_) + RECORD_HEADER_SIZE, payload, header.length);
+      if (readable) {
+        if (recordCrc(header, payload) == header.crc) {
+          info.length = header.length;
+          info.type = header.type;
+          peekSize_ = recordSize(header.length);
+          return true;
+        }
+        // Payload abîmé mais longueur plausible : seul cet enregistrement est
+        // ignoré. Il n'a pas été compté dans pending_ au montage.
+        corrupt_++;
+        readOff_ += recordSize(header.length);
+        continue;
+      }
+      if (header.length != 0xFFFF) {
+        corrupt_++;
+      }
+      // Fin (ou reste illisible) du segment : passer au suivant
+      if (readSeg_ == head_) {
+        pending_ = 0;
+        return false;
+      }
+      readSeg_ = next(readSeg_);
+      readOff_ = SEGMENT_HEADER_SIZE;
+    }
+  }
+
+  // Avance après l'enregistrement renvoyé par peek() (en RAM jusqu'au commit)
+  void consume() {
+    if (peekSize_ == 0) {
+      return;
+    }
+    lastConsumedAddr_ = address(readSeg_, readOff_);
+    consumed_++;
+    readOff_ += peekSize_;
+    peekSize_ = 0;
+    if (pending_ > 0) {
+      pending_--;
+    }
+    uncommitted_ = true;
+  }
+
+  // Rend la position de lecture persistante
+  bool commit() {
+    if (!uncommitted_) {
+      return true;
+    }
+    if (!markConsumed(lastConsumedAddr_)) {
+      return false;
+    }
+    uncommitted_ = false;
+    return true;
+  }
+
+  // Emplacement de l'enregistrement renvoyé par peek(), avant consume()
+  LogPosition position() const {
+    LogPosition pos;
+    pos.segmentSeq = headSeq_ - (uint32_t)((head_ + segments_ - readSeg_) % segments_);
+    pos.address = (uint32_t)address(readSeg_, readOff_);
+    return pos;
+  }
+
+  // Marque consommé l'enregistrement à `pos` et tout ce qui le précède,
+  // quand l'envoi n'est confirmé qu'après d'autres lectures (PUBACK).
+  // Sans effet si son segment a été recyclé entre-temps (journal plein).
+  bool commitThrough(const LogPosition& pos) {
+    if (!mounted_ || !holds(pos)) {
+      return true;
+    }
+    if (!markConsumed(pos.address)) {
+      return false;
+    }
+    if (pos.address == lastConsumedAddr_) {
+      uncommitted_ = false;
+    }
+    return true;
+  }
+
+  // Position de lecture courante, à reprendre par rewind()
+  LogReadMark readMark() const {
+    LogReadMark mark;
+    mark.position = position();
+    mark.consumed = consumed_;
+    mark.lastConsumedAddr = lastConsumedAddr_;
+    mark.uncommitted = uncommitted_;
+    return mark;
+  }
+
+  // Revient à `mark` : ce qui a été consommé depuis sera relu (envoi
+  // regroupé qui a échoué). À appeler avant tout commit() postérieur à la
+  // marque. false, sans effet, si son segment a été recyclé entre-temps.
+  bool rewind(const LogReadMark& mark) {
+    if (!mounted_ || !holds(mark.position)) {
+      return false;
+    }
+    readSeg_ = mark.position.address / SEGMENT_LOG_SECTOR_SIZE;
+    readOff_ = mark.position.address % SEGMENT_LOG_SECTOR_SIZE;
+    pending_ += consumed_ - mark.consumed;
+    consumed_ = mark.consumed;
+    lastConsumedAddr_ = mark.lastConsumedAddr;
+    uncommitted_ = mark.uncommitted;
+    peekSize_ = 0;
+    return true;
+  }
+
+  // Abandonne tout ce qui est en attente (lot en RAM compris)
+  void discardAll() {
+    stagedBytes_ = 0;
+    stagedCount_ = 0;
+    readSeg_ = head_;
+    readOff_ = writeOff_;
+    peekSize_ = 0;
+    uncommitted_ = false;
+    if (pending_ > 0 && hasLastRecord_) {
+      markConsumed(lastRecordAddr_);
+    }
+    pending_ = 0;
+  }
+
+  bool mounted() const { return mounted_; }
+  // Abandon du journal (l'appelant repasse en RAM) ; rien n'est effacé
+  void unmount() {
+    mounted_ = false;
+    stagedBytes_ = 0;
+    stagedCount_ = 0;
+  }
+  size_t pending() const { return pending_ + stagedCount_; }
+  size_t stagedBytes() const { return stagedBytes_; }
+  size_t segmentCount() const { return segments_; }
+  uint32_t dropped() const { return dropped_; }
+  uint32_t corrupt() const { return corrupt_; }
+  uint32_t tooLarge() const { return tooLarge_; }
+  uint32_t erases() const { return erases_; }
+  uint32_t foreignSegments() const { return foreign_; }  // Effacés au montage (autre format)
+  uint64_t payloadBytes() const { return payloadBytes_; }
+  uint64_t flashBytes() const { return flashBytes_; }
+
+  // Octets écrits en flash (en-têtes, alignement, marques) par octet de payload
+  float writeAmplification() const {
+    return payloadBytes_ > 0 ? (float)flashBytes_ / (float)payloadBytes_ : 0.0f;
+  }
+
+  static constexpr size_t maxPayload() { return StagingSize - sizeof(RecordHeader); }
+
+ private:
+  static size_t recordSize(size_t length) { return (RECORD_HEADER_SIZE + length + 3) & ~(size_t)3; }
+  static size_t address(size_t seg, size_t offset) { return seg * SEGMENT_LOG_SECTOR_SIZE + offset; }
+  size_t next(size_t seg) const { return seg + 1 == segments_ ? 0 : seg + 1; }
+
+  static uint32_t recordCrc(const RecordHeader& header, const uint8_t* payload) {
+    uint32_t crc = segmentLogCrc32((const uint8_t*)&header.length, sizeof(header.length));
+    crc = segmentLogCrc32(&header.type, 1, crc);
+    return segmentLogCrc32(payload, header.length, crc);
+  }
+
+  // `pos` désigne toujours un segment vivant (pas recyclé depuis la lecture)
+  bool holds(const LogPosition& pos) const {
+    size_t seg = pos.address / SEGMENT_LOG_SECTOR_SIZE;
+    return seg < segments_ &&
+           (seg + segments_ - tail_) % segments_ <= (head_ + segments_ - tail_) % segments_ &&
+           headSeq_ - (uint32_t)((head_ + segments_ - seg) % segments_) == pos.segmentSeq;
+  }
+
+  size_t stagedRecordSize(size_t pos) const {
+    RecordHeader header;
+    memcpy(&header, staging_ + pos, RECORD_HEADER_SIZE);
+    return recordSize(header.length);
+  }
+
+  bool readSegmentHeader(size_t seg, uint32_t& seq, uint32_t* layout = NULL) {
+    SegmentHeader header;
+    if (!flash_.read(address(seg, 0), &header, SEGMENT_HEADER_SIZE)) {
+      return false;
+    }
+    seq = header.seq;
+    if (layout != NULL) {
+      *layout = header.layout;
+    } else if (header.layout != layout_) {
+      return false;
+    }
+    return header.magic == SEGMENT_MAGIC && header.seqCheck == ~header.seq;
+  }
+
+  bool startSegment(size_t seg, uint32_t seq) {
+    if (!flash_.eraseSector(address(seg, 0))) {
+      return false;
+    }
+    erases_++;
+    SegmentHeader header;
+    header.magic = SEGMENT_MAGIC;
+    header.seq = seq;
+    header.seqCheck = ~seq;
+    header.layout = layout_;
+    if (!flash_.write(address(seg, 0), &header, SEGMENT_HEADER_SIZE)) {
+      return false;
+    }
+    flashBytes_ += SEGMENT_HEADER_SIZE;
+    return true;
+  }
+
+  bool format() {
+    if (!startSegment(0, 1)) {
+      return false;
+    }
+    head_ = tail_ = readSeg_ = 0;
+    headSeq_ = 1;
+    writeOff_ = readOff_ = SEGMENT_HEADER_SIZE;
+    pending_ = 0;
+    hasLastRecord_ = false;
+    stagedBytes_ = 0;
+    stagedCount_ = 0;
+    uncommitted_ = false;
+    mounted_ = true;
+    return true;
+  }
+
+  // Parcourt les enregistrements valides d'un segment au montage.
+  // Renvoie false si le segment se termine par une zone corrompue.
+  bool scanSegment(size_t seg, size_t& end) {
+    size_t off = SEGMENT_HEADER_SIZE;
+    bool clean = true;
+    while (off + RECORD_HEADER_SIZE <= SEGMENT_LOG_SECTOR_SIZE) {
+      RecordHeader header;
+      if (!flash_.read(address(seg, off), &header, RECORD_HEADER_SIZE)) {
+        clean = false;
+        break;
+      }
+      if (header.length == 0xFFFF) {
+        break;
+      }
+      size_t size = recordSize(header.length);
+      if (header.length > maxPayload() || off + size > SEGMENT_LOG_SECTOR_SIZE ||
+          !flash_.read(address(seg, off) + RECORD_HEADER_SIZE, staging_, header.length)) {
+        clean = false;
+        break;
+      }
+      if (recordCrc(header, staging_) != header.crc) {
+        off += size;  // Compté par peek() à la lecture
+        continue;
+      }
+
+      lastRecordAddr_ = address(seg, off);
+      hasLastRecord_ = true;
+      off += size;
+      if (header.state == RECORD_CONSUMED) {
+        pending_ = 0;
+        readSeg_ = seg;
+        readOff_ = off;
+      } else {
+        pending_++;
+      }
+    }
+    end = off;
+    return clean;
+  }
+
+  // Nombre d'enregistrements lisibles d'un segment à partir de offset
+  size_t countRecords(size_t seg, size_t offset) {
+    size_t count = 0;
+    while (offset + RECORD_HEADER_SIZE <= SEGMENT_LOG_SECTOR_SIZE) {
+      RecordHeader header;
+      if (!flash_.read(address(seg, offset), &header, RECORD_HEADER_SIZE) || header.length == 0xFFFF ||
+          header.length > maxPayload()) {
+        break;
+      }
+      offset += recordSize(header.length);
+      count++;
+    }
+    return count;
+  }
+
+  // Ouvre le segment suivant ; journal plein : le plus ancien est sacrifié
+  bool advanceHead() {
+    size_t seg = next(head_);
+    if (seg == tail_) {
+      if (readSeg_ == tail_) {
+        size_t lost = countRecords(tail_, readOff_);
+        dropped_ += lost;
+        pending_ = pending_ > lost ? pending_ - lost : 0;
+        readSeg_ = next(tail_);
+        readOff_ = SEGMENT_HEADER_SIZE;
+        peekSize_ = 0;
+      }
+      tail_ = next(tail_);
+    }
+    if (!startSegment(seg, headSeq_ + 1)) {
+      return false;
+    }
+    headSeq_++;
+    head_ = seg;
+    writeOff_ = SEGMENT_HEADER_SIZE;
+    return true;
+  }
+
+  bool markConsumed(size_t recordAddr) {
+    uint8_t consumed = RECORD_CONSUMED;
+    if (!flash_.write(recordAddr + offsetof(RecordHeader, state), &consumed, 1)) {
+      return false;
+    }
+    flashBytes_ += 1;
+    return true;
+  }
+
+  Flash& flash_;
+  const uint32_t layout_;
+  bool mounted_ = false;
+  size_t segments_ = 0;
+  size_t head_ = 0;             // Segment en cours d'écriture
+  size_t tail_ = 0;             // Plus ancien segment valide
+  uint32_t headSeq_ = 0;
+  size_t writeOff_ = 0;
+  size_t readSeg_ = 0;
+  size_t readOff_ = 0;
+  size_t peekSize_ = 0;
+  size_t pending_ = 0;          // Enregistrements en flash non consommés
+  size_t lastConsumedAddr_ = 0;
+  uint32_t consumed_ = 0;       // Enregistrements consommés depuis le montage
+  size_t lastRecordAddr_ = 0;
+  bool hasLastRecord_ = false;
+  bool uncommitted_ = false;
+
+  uint8_t staging_[StagingSize];
+  size_t stagedBytes_ = 0;
+  size_t stagedCount_ = 0;
+
+  uint32_t dropped_ = 0;
+  uint32_t corrupt_ = 0;
+  uint32_t tooLarge_ = 0;
+  uint32_t erases_ = 0;
+  uint32_t foreign_ = 0;
+  uint64_t payloadBytes_ = 0;
+  uint64_t flashBytes_ = 0;
+};
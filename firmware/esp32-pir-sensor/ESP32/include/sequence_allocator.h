@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+// === NUMÉROS DE SÉQUENCE PERSISTANTS ===
+// Numéro 64 bits croissant, propre à l'appareil, porté par chaque message
+// pour que le backend dédoublonne et détecte les pertes. Pour ne pas écrire
+// en flash à chaque message, on réserve des blocs : le stockage garde la fin
+// du bloc réservé, et les numéros du bloc sont distribués depuis la RAM.
+// Après un redémarrage non prévu, la numérotation reprend à la fin du bloc
+// (les numéros restants du bloc précédent ne sont jamais utilisés).
+//
+// Store fournit : bool load(uint64_t& value) et bool save(uint64_t value).
+
+template <class Store>
+class SequenceAllocator {
+ public:
+  SequenceAllocator(Store& store, uint32_t blockSize) : store_(store), blockSize_(blockSize) {}
+
+  // Démarrage à froid : reprend après le dernier bloc réservé
+  bool begin() {
+    uint64_t end = 0;
+    store_.load(end);
+    next_ = end;
+    end_ = end;
+    return reserve();
+  }
+
+  // Réveil de deep sleep : état conservé en RAM RTC, pas d'accès au stockage
+  void resume(uint64_t next, uint64_t end) {
+    next_ = next;
+    end_ = end;
+  }
+
+  uint64_t next() {
+    if (next_ >= end_) {
+      reserve();
+    }
+    return next_++;
+  }
+
+  // Rend le dernier numéro distribué (message finalement non envoyé ni gardé)
+  bool release(uint64_t seq) {
+    if (seq + 1 != next_) {
+      return false;
+    }
+    next_--;
+    return true;
+  }
+
+  // Redémarrage prévu : enregistre la position exacte, sans trou au prochain boot
+  bool persist() {
+    if (!store_.save(next_)) {
+      return false;
+    }
+    writes_++;
+    end_ = next_;
+    return true;
+  }
+
+  uint64_t peek() const { return next_; }
+  uint64_t reservedEnd() const { return end_; }
+  uint32_t writes() const { return writes_; }
+  uint32_t failedWrites() const { return failedWrites_; }
+
+ private:
+  // En cas d'échec, le bloc est distribué quand même : mieux vaut un doublon
+  // possible après un redémarrage qu'un appareil qui n'envoie plus rien
+  bool reserve() {
+    end_ = next_ + blockSize_;
+    if (!store_.save(end_)) {
+      failedWrites_++;
+      return false;
+    }
+    writes_++;
+    return true;
+  }
+
+  Store& store_;
+  uint32_t blockSize_;
+  uint64_t next_ = 0;
+  uint64_t end_ = 0;
+  uint32_t writes_ = 0;
+  uint32_t failedWrites_ = 0;
+};
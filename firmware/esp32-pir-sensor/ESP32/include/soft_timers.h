@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// === TIMERS LOGICIELS ===
+// Table fixe de timers périodiques en millisecondes. run() déclenche ceux
+// qui sont arrivés à échéance, msUntilNext() donne le temps d'attente
+// jusqu'au prochain : la boucle principale peut dormir jusque-là.
+
+typedef void (*SoftTimerCallback)();
+
+template <size_t Capacity>
+class SoftTimers {
+ public:
+  // Renvoie l'identifiant du timer, ou -1 si la table est pleine
+  int add(uint32_t periodMs, SoftTimerCallback callback, uint32_t nowMs) {
+    if (count_ >= Capacity) {
+      return -1;
+    }
+    Timer& t = timers_[count_];
+    t.periodMs = periodMs;
+    t.nextMs = nowMs + periodMs;
+    t.callback = callback;
+    t.enabled = true;
+    return (int)count_++;
+  }
+
+  void setEnabled(int id, bool enabled, uint32_t nowMs) {
+    if (id < 0 || (size_t)id >= count_) {
+      return;
+    }
+    Timer& t = timers_[id];
+    if (enabled && !t.enabled) {
+      t.nextMs = nowMs + t.periodMs;
+    }
+    t.enabled = enabled;
+  }
+
+  // Déclenche les timers échus
+  void run(uint32_t nowMs) {
+    for (size_t i = 0; i < count_; i++) {
+      Timer& t = timers_[i];
+      if (t.enabled && (int32_t)(nowMs - t.nextMs) >= 0) {
+        t.nextMs = nowMs + t.periodMs;
+        t.callback();
+      }
+    }
+  }
+
+  // Millisecondes avant la prochaine échéance (maxMs si aucune avant)
+  uint32_t msUntilNext(uint32_t nowMs, uint32_t maxMs) const {
+    uint32_t wait = maxMs;
+    for (size_t i = 0; i < count_; i++) {
+      const Timer& t = timers_[i];
+      if (!t.enabled) {
+        continue;
+      }
+      int32_t remaining = (int32_t)(t.nextMs - nowMs);
+      if (remaining <= 0) {
+        return 0;
+      }
+      if ((uint32_t)remaining < wait) {
+        wait = (uint32_t)remaining;
+      }
+    }
+    return wait;
+  }
+
+ private:
+  struct Timer {
+    uint32_t periodMs;
+    uint32_t nextMs;
+    SoftTimerCallback callback;
+    bool enabled;
+  };
+
+  Timer timers_[Capacity];
+  size_t count_ = 0;
+};
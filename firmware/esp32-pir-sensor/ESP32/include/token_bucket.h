@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+// === SEAU À JETONS ===
+// Limite un débit moyen (jetons par seconde) en tolérant une rafale de
+// `burst` jetons. Les jetons sont comptés en millionièmes pour un
+// remplissage exact à la microseconde, sans virgule flottante.
+
+class TokenBucket {
+ public:
+  TokenBucket(uint32_t ratePerSec, uint32_t burst)
+      : rate_(ratePerSec), capacity_((uint64_t)burst * UNIT), credit_((uint64_t)burst * UNIT) {}
+
+  // Consomme un jeton s'il y en a un
+  bool tryTake(uint64_t nowUs) {
+    refill(nowUs);
+    if (credit_ < UNIT) {
+      return false;
+    }
+    credit_ -= UNIT;
+    return true;
+  }
+
+  // Microsecondes avant le prochain jeton disponible (0 si disponible)
+  uint64_t usUntilToken(uint64_t nowUs) {
+    refill(nowUs);
+    if (credit_ >= UNIT || rate_ == 0) {
+      return 0;
+    }
+    return (UNIT - credit_ + rate_ - 1) / rate_;
+  }
+
+  uint32_t tokens(uint64_t nowUs) {
+    refill(nowUs);
+    return (uint32_t)(credit_ / UNIT);
+  }
+
+ private:
+  static const uint64_t UNIT = 1000000;
+
+  void refill(uint64_t nowUs) {
+    if (started_ && nowUs > lastUs_) {
+      credit_ += (nowUs - lastUs_) * rate_;
+      if (credit_ > capacity_) {
+        credit_ = capacity_;
+      }
+    }
+    started_ = true;
+    lastUs_ = nowUs;
+  }
+
+  uint32_t rate_;
+  uint64_t capacity_;
+  uint64_t credit_;
+  uint64_t lastUs_ = 0;
+  bool started_ = false;
+};
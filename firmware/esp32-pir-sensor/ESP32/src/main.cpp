@@ -4,6 +4,9 @@
 #include <time.h>
 #include <vector>
 #include <ctype.h>
+#include <string.h>
+#include <type_traits>
+#include <atomic>
 
 #include "secrets.h"
 #include <PubSubClient.h>
@@ -11,8 +14,37 @@
 #include "mbedtls/base64.h"
 #include "mbedtls/md.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_wifi.h"
+#include "esp_pm.h"
+#include "esp_partition.h"
+#include "driver/gpio.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
 #include <esp_system.h>
 #include <Preferences.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "esp_vfs_eventfd.h"
+
+#include "adaptive_cooldown.h"
+#include "message_ring.h"
+#include "event_record.h"
+#include "health_sampler.h"
+#include "inflight_window.h"
+#include "json_delta.h"
+#include "message_schema.h"
+#include "motion_batch.h"
+#include "occupancy_session.h"
+#include "pir_detector.h"
+#include "rtc_event_queue.h"
+#include "segment_log.h"
+#include "token_bucket.h"
+#include "sequence_allocator.h"
+#include "soft_timers.h"
 
 // === MODE DEBUG ===
 #define DEBUG_MODE true  // Mettre à false pour production
@@ -53,19 +85,114 @@ const char* azure_root_ca = \
 "-----END CERTIFICATE-----\n";
 
 // === CONFIGURATION HARDWARE ===
-const int PIR_PIN = 13;
+// Une entrée par capteur PIR (GPIO0-31, lus en un seul accès registre)
+// En DRAM : la table est lue par l'ISR, qui ne doit pas dépendre du cache flash
+DRAM_ATTR constexpr uint8_t PIR_PINS[] = {13};
+constexpr size_t PIR_COUNT = sizeof(PIR_PINS) / sizeof(PIR_PINS[0]);
+constexpr uint32_t PIR_PIN_MASK = pirPinMask(PIR_PINS);
+static_assert(pirPinsValid(PIR_PINS), "Les PIR doivent être sur GPIO0-31");
 const int LED_PIN = 2;
 const unsigned long DEBOUNCE_DELAY = 500;
+const size_t PIR_EDGE_QUEUE_SIZE = 64;
+const unsigned long SESSION_MAX_DURATION = 3600000;  // Session découpée au-delà (ms)
+const unsigned long ADAPTIVE_MAX_COOLDOWN = 600000;  // Plafond du cooldown adaptatif (ms)
+const unsigned long ADAPTIVE_REFRESH_INTERVAL = 60000;  // Relâchement du cooldown sans détection (ms)
+
+// Lot de détections : en-tête commun (~60 octets) + ~15 octets par détection
+const size_t MOTION_BATCH_CAPACITY = (MQTT_MAX_PACKET_SIZE - 256) / 24 > 0 ? (MQTT_MAX_PACKET_SIZE - 256) / 24 : 1;
+static_assert(MOTION_BATCH_CAPACITY <= MOTION_BATCH_MESSAGE_DETECTIONS_MAX,
+              "Lot plus grand que la liste \"detections\" de messages.schema.json");
+
+// Document d'un enregistrement de l'outbox (détection, lot ou session)
+constexpr size_t RECORD_DOC_SIZE =
+    MOTION_BATCH_MESSAGE_DOC_SIZE > SESSION_MESSAGE_DOC_SIZE ? MOTION_BATCH_MESSAGE_DOC_SIZE : SESSION_MESSAGE_DOC_SIZE;
+
+// === DEEP SLEEP ===
+// Les PIR doivent être sur des GPIO RTC (0, 2, 4, 12-15, 25-27, 32-39) pour réveiller l'ESP32
+const size_t RTC_EVENT_CAPACITY = 32;                  // Détections conservées pendant le sommeil
+const unsigned long DEEP_SLEEP_MAX_AWAKE = 30000;      // Rendormir même sans connexion (ms)
+const unsigned long DEEP_SLEEP_LINGER = 1500;          // Attente des messages twin/C2D après connexion (ms)
+const unsigned long DEEP_SLEEP_POLL_INTERVAL = 250;    // Vérification de la condition d'endormissement (ms)
+const unsigned long DEEP_SLEEP_HEARTBEAT = 3600000;    // Réveil périodique pour le statut (ms)
+const uint32_t RTC_STATE_MAGIC = 0x50495233;           // "PIR3"
+
+// === MODEM SLEEP / LIGHT SLEEP ===
+// Intervalle d'écoute WiFi (en beacons) déduit de la latence C2D acceptée.
+// Le PINGRESP du keepalive attend au pire un intervalle d'écoute au point
+// d'accès : on garde une marge de 3 sur MQTT_KEEPALIVE pour ne pas perdre la session.
+const unsigned long WIFI_BEACON_INTERVAL = 102;                          // 100 TU (ms)
+const unsigned long WIFI_DTIM_LATENCY = 3 * WIFI_BEACON_INTERVAL;        // En dessous : réveil à chaque DTIM
+const unsigned long MAX_C2D_LATENCY = MQTT_KEEPALIVE * 1000UL / 3;
 
 // === CONFIGURATION SYSTÈME ===
 const int WDT_TIMEOUT = 30;
-const int MAX_BUFFER_SIZE = 50;
+const uint32_t SEQ_BLOCK_SIZE = 1000;           // Numéros de séquence réservés par écriture NVS
+const uint16_t MQTT_WRITE_BUFFER_SIZE = 4096;   // Paquets MQTT regroupés par écriture TLS (= CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN)
+const uint16_t MQTT_WRITE_FLUSH_DELAY = 20;     // ms max avant l'envoi des paquets regroupés
+const size_t OUTBOX_RAM_SIZE = 16384;                           // Détections en RAM (sans partition outbox)
+const size_t OUTBOX_SESSION_RAM_SIZE = 2048;                    // Sessions en RAM (sans partition outbox)
+const size_t OUTBOX_PAYLOAD_SIZE = MQTT_MAX_PACKET_SIZE - 128;  // Place pour l'en-tête MQTT et le topic
+// Statut complet ~0,9 Ko, ~1,3 Ko au pire (publié en flux : pas borné par MQTT_MAX_PACKET_SIZE)
+const size_t OUTBOX_STATE_PAYLOAD_SIZE = 1536;
+const size_t OUTBOX_STATE_RAM_SIZE = MessageRingBase::recordSize(OUTBOX_STATE_PAYLOAD_SIZE);  // Dernier statut / twin
+
+// === OUTBOX PERSISTANTE (PARTITION FLASH) ===
+const uint8_t OUTBOX_PARTITION_SUBTYPE = 0x40;         // Voir partitions.csv
+const size_t OUTBOX_SESSION_FLASH_SIZE = 32 * SEGMENT_LOG_SECTOR_SIZE;  // Début de la partition, le reste aux détections
+// Formats des journaux : à changer si leurs zones bougent (segments effacés au montage)
+const uint32_t OUTBOX_SESSION_LAYOUT = 0x53455331;     // "SES1"
+const uint32_t OUTBOX_MOTION_LAYOUT = 0x4D4F5431;      // "MOT1"
+const size_t OUTBOX_STAGING_SIZE = 1024;               // Lot en RAM avant écriture flash
+const unsigned long OUTBOX_FLUSH_INTERVAL = 2000;      // Délai max avant écriture d'un lot (ms)
+const size_t OUTBOX_COMMIT_EVERY = 16;                 // Messages envoyés entre deux marques en flash
+static_assert(OUTBOX_PAYLOAD_SIZE + 8 <= OUTBOX_STAGING_SIZE, "Un message doit tenir dans le lot en RAM");
+
+// === VIDAGE DE L'OUTBOX ===
+// Azure IoT Hub limite les envois par appareil : on reste bien en dessous
+const uint32_t OUTBOX_DRAIN_RATE = 10;                 // Messages par seconde en moyenne
+const uint32_t OUTBOX_DRAIN_BURST = 5;                 // Rafale tolérée à la reconnexion
+const size_t OUTBOX_DRAIN_MAX_PER_LOOP = 4;            // Messages max par tour de loop()
+const uint64_t OUTBOX_DRAIN_BUDGET_US = 20000;         // Temps max d'envoi par tour de loop()
+
+// === QOS 1 (PUBLICATIONS ACQUITTÉES) ===
+// Jusqu'à inflightWindow messages publiés sans attendre leur PUBACK
+const size_t INFLIGHT_WINDOW_MAX = 16;                 // Borne de inflightWindow (Device Twin)
+const uint8_t INFLIGHT_WINDOW_DEFAULT = 4;             // 0 = QoS 0, sans accusé de réception
+const size_t INFLIGHT_POOL_SIZE = 4096;                // Copies des payloads en attente de PUBACK
+const unsigned long INFLIGHT_ACK_TIMEOUT = 20000;      // Sans PUBACK : reconnexion puis republication (ms)
+static_assert(INFLIGHT_POOL_SIZE >= MessageRingBase::recordSize(OUTBOX_STATE_PAYLOAD_SIZE),
+              "Un message doit tenir dans la fenêtre QoS 1");
 const char* FIRMWARE_VERSION = "2.0.0";
 
 // === STRUCTURES D'ÉTAT ===
+enum PowerMode : uint8_t {
+  POWER_ALWAYS_ON = 0,
+  POWER_DEEP_SLEEP = 1,
+  POWER_MODEM_SLEEP = 2,
+  POWER_LIGHT_SLEEP = 3
+};
+
+enum PayloadEncoding : uint8_t {
+  ENCODING_JSON = 0,
+  ENCODING_MSGPACK = 1
+};
+
 struct DeviceConfig {
   bool detectionEnabled = true;
   unsigned long cooldownPeriod = 5000;
+  unsigned long minPulseWidth = 0;     // 0 = désactivé
+  unsigned long retriggerMerge = 0;    // 0 = désactivé
+  unsigned long riseHold = 0;          // Niveau bas tenu avant un front montant (ms, 0 = désactivé)
+  unsigned long fallHold = 0;          // Niveau haut tenu avant un front descendant (ms, 0 = désactivé)
+  bool sessionMode = false;            // Sessions d'occupation au lieu d'un message par détection
+  unsigned long idleTimeout = 60000;   // Pièce considérée vide après ce délai (ms)
+  bool adaptiveCooldown = false;       // Cooldown ajusté selon le rythme des détections
+  unsigned long maxMessagesPerHour = 120;
+  unsigned long batchWindow = 0;       // Fenêtre de regroupement des détections (ms, 0 = désactivé)
+  PowerMode powerMode = POWER_ALWAYS_ON;
+  unsigned long c2dLatency = 1000;     // Latence C2D acceptée en modem/light sleep (ms)
+  PayloadEncoding encoding = ENCODING_JSON;  // Format de la télémétrie (le Device Twin reste en JSON)
+  uint8_t inflightWindow = INFLIGHT_WINDOW_DEFAULT;  // Publications QoS 1 sans PUBACK (0 = QoS 0)
   String firmwareVersion = FIRMWARE_VERSION;
 };
 
@@ -74,22 +201,54 @@ struct DeviceMetrics {
   int detectionCount = 0;
   int bufferedMessagesCount = 0;
   int sentFromBufferCount = 0;
-  unsigned long lastValidDetectionTime = 0;
   int wifiReconnectCount = 0;
   int mqttReconnectCount = 0;
   int failedPublishCount = 0;
+  uint32_t unreadableRecords = 0;      // Enregistrements de l'outbox illisibles, retirés sans envoi
+  int sessionCount = 0;
+  uint32_t loopWakeups = 0;            // Réveils de loop() depuis le dernier statut
+  uint32_t maxWakeLatencyUs = 0;       // Front PIR → traitement, max depuis le dernier statut
+  uint32_t wakeLatencySumUs = 0;       // Somme et nombre de mesures pour la moyenne
+  uint32_t wakeLatencySamples = 0;
+  uint32_t drainedMessages = 0;        // Messages renvoyés depuis l'outbox depuis le dernier statut
+  uint32_t drainTimeMs = 0;            // Durée cumulée de vidage correspondante
+  uint32_t maxPirGapUs = 0;            // Plus long tour de loop() sans traitement PIR pendant un vidage
+  uint32_t maxConnectGapUs = 0;        // Idem pendant une (re)connexion WiFi / NTP / MQTT
+  uint64_t publishCyclesSum = 0;       // Cycles CPU des publications depuis le dernier statut
+  uint32_t publishCount = 0;
+  uint32_t maxPublishCycles = 0;
+  uint32_t detectionPublishSumUs = 0;  // Front PIR → détection publiée, depuis le dernier statut
+  uint32_t detectionPublishSamples = 0;
+  uint32_t maxDetectionPublishUs = 0;
+  uint32_t ackSumMs = 0;               // Envoi → PUBACK (QoS 1), depuis le dernier statut
+  uint32_t ackSamples = 0;
+  uint32_t tlsWrites = 0;              // Écritures TLS (enregistrements chiffrés) depuis le dernier statut
+  unsigned long lastStatusTime = 0;
 };
 
-struct PirState {
-  bool lastState = LOW;
-  unsigned long lastStateChangeTime = 0;
-  bool motionInProgress = false;
+// Conservé en mémoire RTC pendant le deep sleep (remis à zéro au démarrage à froid)
+static_assert(std::is_trivially_copyable<DeviceMetrics>::value, "DeviceMetrics doit rester copiable en RTC");
+
+struct RtcRetainedState {
+  uint32_t magic;
+  uint8_t metrics[sizeof(DeviceMetrics)];   // Copie brute : pas de constructeur exécuté au réveil
+  uint32_t wakeCount;                       // Réveils depuis le démarrage à froid
+  uint32_t lastWakeToPublishMs;             // Réveil → première détection confirmée (PUBACK, QoS 0 : écrite
+                                            // dans le client TLS), cycle précédent
+  uint8_t wifiChannel;                      // Dernier AP connu (0 = inconnu, scan complet)
+  uint8_t wifiBssid[6];
+  uint64_t seqNext;                         // Numérotation des messages (voir SequenceAllocator)
+  uint64_t seqEnd;
+  RtcEventQueue<RTC_EVENT_CAPACITY> events;
 };
 
-struct PendingMessage {
-  String topic;
-  String payload;
-  unsigned long timestamp;
+// Files de l'outbox, par ordre de priorité au vidage
+enum OutboxLane : uint8_t {
+  LANE_TWIN,       // Dernier Device Twin reported
+  LANE_SESSION,    // Sessions d'occupation
+  LANE_HEALTH,     // Dernier statut
+  LANE_MOTION,     // Détections et lots
+  LANE_COUNT
 };
 
 // === ÉTATS DE CONNEXION ===
@@ -97,42 +256,269 @@ enum ConnectionState {
   DISCONNECTED,
   CONNECTING_WIFI,
   WIFI_CONNECTED,
-  CONNECTING_MQTT,
+  SYNCING_TIME,      // Attente de l'heure NTP (signature SAS)
+  CONNECTING_MQTT,   // TLS + CONNECT dans mqttConnectTask, loop() continue
   FULLY_CONNECTED
 };
 
+// Résultat de la dernière tentative de mqttConnectTask
+enum MqttAttemptResult : uint8_t {
+  MQTT_ATTEMPT_PENDING,
+  MQTT_ATTEMPT_OK,
+  MQTT_ATTEMPT_FAILED
+};
+
 // === INSTANCES GLOBALES ===
 DeviceConfig config;
 DeviceMetrics metrics;
-PirState pirState;
+// Pipeline de détection : paramètres modifiables via le Device Twin
+PirBank<PIR_COUNT, DetectionParams,
+        DebounceStage, HysteresisStage, MinPulseWidthStage, RetriggerMergeStage,
+        CooldownStage> pirBank(PIR_PINS);
+PirEdgeQueue<PIR_EDGE_QUEUE_SIZE> pirEdgeQueue;
+OccupancyEngine occupancy;
+AdaptiveCooldown adaptiveCooldown;
+MotionBatch<MOTION_BATCH_CAPACITY> motionBatch;
 ConnectionState connectionState = DISCONNECTED;
+RTC_DATA_ATTR RtcRetainedState rtcState;
 
 // === VARIABLES GLOBALES ===
-std::vector<PendingMessage> messageBuffer;
+// Anneaux en RAM des files (sessions et détections : seulement sans partition outbox)
+MessageRing<OUTBOX_STATE_RAM_SIZE> twinLane(EVICT_KEEP_LATEST);
+MessageRing<OUTBOX_SESSION_RAM_SIZE> sessionLane(EVICT_DROP_NEWEST);
+MessageRing<OUTBOX_STATE_RAM_SIZE> healthLane(EVICT_KEEP_LATEST);
+MessageRing<OUTBOX_RAM_SIZE> motionLane(EVICT_DROP_OLDEST);
+MessageRingBase* const laneRings[LANE_COUNT] = {&twinLane, &sessionLane, &healthLane, &motionLane};
+uint32_t laneOversized[LANE_COUNT] = {};   // Documents trop grands pour leur file (bufferJson)
+const char* const LANE_NAMES[LANE_COUNT] = {"twin", "session", "health", "motion"};
+char twinReportedTopic[64];
+char telemetryTopic[160];              // Télémétrie dans l'encodage configuré
+char jsonTelemetryTopic[160];          // Télémétrie déjà rendue en JSON (outbox)
+char msgpackTelemetryTopic[160];       // Télémétrie déjà rendue en MessagePack (fenêtre QoS 1)
 unsigned long lastConnectionAttempt = 0;
-unsigned long lastBufferCheck = 0;
-unsigned long lastTwinUpdate = 0;
 int twinRequestId = 0;
 
+// === ÉTAT TRANSMIS (DELTAS) ===
+// Seuils des valeurs bruitées : un écart plus petit n'est pas renvoyé
+const DeltaThreshold REPORT_THRESHOLDS[] = {
+  {"uptime", 3600, 0},                 // s
+  {"rssi", 5, 0}, {"rssiMin", 5, 0}, {"rssiMax", 5, 0}, {"rssiAvg", 5, 0},
+  {"freeHeap", 4096, 0}, {"minFreeHeap", 4096, 0},
+  {"wakeupsPerSec", 0, 0.2f},
+  {"avgWakeLatencyUs", 0, 0.25f}, {"maxWakeLatencyUs", 0, 0.25f},
+  {"avgPublishCycles", 0, 0.25f}, {"maxPublishCycles", 0, 0.25f},
+  {"tlsWritesPerPublish", 0.25f, 0},
+  {"avgDetectionPublishUs", 0, 0.25f}, {"maxDetectionPublishUs", 0, 0.25f},
+  {"writeAmp", 0.05f, 0}
+};
+JsonDelta reportDelta(REPORT_THRESHOLDS, sizeof(REPORT_THRESHOLDS) / sizeof(REPORT_THRESHOLDS[0]));
+StaticJsonDocument<TWIN_REPORTED_MESSAGE_DOC_SIZE> twinShadow;  // Reported confirmé par IoT Hub (vide = inconnu)
+StaticJsonDocument<TWIN_REPORTED_MESSAGE_DOC_SIZE> twinSent;    // Reported envoyé, en attente de sa réponse
+StaticJsonDocument<STATUS_MESSAGE_DOC_SIZE> statusShadow;       // Dernier statut publié, sans seq
+
+// Filtres des messages reçus : seuls les champs utilisés sont désérialisés
+StaticJsonDocument<TWIN_DESIRED_MESSAGE_FILTER_SIZE> twinDesiredFilter;
+StaticJsonDocument<JSON_OBJECT_SIZE(1) + TWIN_DESIRED_MESSAGE_FILTER_SIZE> twinGetFilter;
+StaticJsonDocument<C2D_COMMAND_MESSAGE_FILTER_SIZE> c2dFilter;
+int twinReportedRid = -1;              // $rid du dernier patch reported
+bool twinAwaitingAck = false;
+unsigned long lastFullTwinTime = 0;
+uint8_t statusDeltaCount = 0;          // Statuts delta depuis le dernier complet
+esp_sleep_wakeup_cause_t wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+bool fastBoot = false;                 // Réveil de deep sleep : démarrage et connexion abrégés
+bool wakePublishMeasured = false;
+unsigned long fullyConnectedAt = 0;
+PowerMode activePowerMode = POWER_ALWAYS_ON;   // Mode réellement appliqué (repli si light sleep indisponible)
+uint16_t appliedListenInterval = 0;            // Intervalle d'écoute de l'association en cours (0 = défaut)
+volatile bool pirLevelWakeArmed = false;       // PIR en interruptions de niveau (réveil light sleep)
+
 const unsigned long CONNECTION_RETRY_INTERVAL = 5000;
+const unsigned long NTP_SYNC_TIMEOUT = 10000;          // Heure toujours inconnue : nouvelle tentative
+const unsigned long MQTT_RETRY_INTERVAL = 15000;       // Entre deux tentatives MQTT (échec ou timeout)
+const unsigned long TLS_HANDSHAKE_TIMEOUT = 15;        // Secondes, poignée de main TLS dans mqttConnectTask
+const unsigned long LED_BLINK_INTERVAL = 100;          // Clignotement de connexion
 const unsigned long BUFFER_CHECK_INTERVAL = 10000;
 const unsigned long TWIN_UPDATE_INTERVAL = 60000;
+const unsigned long TWIN_FULL_REPORT_INTERVAL = 21600000;  // Reported complet toutes les 6 h, sinon des deltas
+const uint8_t STATUS_FULL_EVERY = 12;                  // Statut complet tous les 12 statuts (1 h)
+const unsigned long CONNECTION_POLL_INTERVAL = 500;    // Suivi de la connexion hors FULLY_CONNECTED
+const unsigned long MAX_IDLE_WAIT = 10000;             // Sommeil max de loop() (< WDT_TIMEOUT)
+const unsigned long HEALTH_SAMPLE_INTERVAL = 10000;    // Relevé RSSI / heap en tâche de fond
+const unsigned long HEALTH_REPORT_INTERVAL = 300000;   // Rapport de santé (statut) périodique
+
+// === RÉVEIL DE LOOP() (TICKLESS) ===
+TaskHandle_t loopTaskHandle = NULL;
+TaskHandle_t socketWatchTaskHandle = NULL;
+// Le socket MQTT n'est fermé qu'en tenant socketMutex ; socketWatchTask le
+// tient pendant son select(). socketWakeFd (eventfd) fait sortir select()
+// aussitôt quand une autre tâche veut fermer le socket.
+SemaphoreHandle_t socketMutex = NULL;
+int socketWakeFd = -1;
+volatile bool socketWatchParked = false;
+SoftTimers<7> timers;
+HealthSampler health;
 
 // === MQTT / Azure ===
-WiFiClientSecure tlsClient;
+// Client TLS dont on peut surveiller le socket (select) pour réveiller loop()
+// et qui compte ses écritures : chacune est chiffrée en au moins un enregistrement TLS
+void parkSocketWatcher();
+void releaseSocketWatcher();
+
+class WatchableTlsClient : public WiFiClientSecure {
+ public:
+  int socketFd() const { return sslclient ? sslclient->socket : -1; }
+  
+  size_t write(const uint8_t* buf, size_t size) override {
+    metrics.tlsWrites++;
+    return WiFiClientSecure::write(buf, size);
+  }
+  
+  // Toutes les fermetures (PubSubClient, timeouts, loop()) passent par ici :
+  // le numéro de socket n'est jamais libéré pendant le select() du watcher
+  void stop() override {
+    parkSocketWatcher();
+    WiFiClientSecure::stop();
+    releaseSocketWatcher();
+  }
+};
+
+WatchableTlsClient tlsClient;
 PubSubClient mqtt(tlsClient);
+// Tant que mqttConnecting est vrai, seule mqttConnectTask touche à mqtt et tlsClient.
+// La tâche et loop() peuvent tourner sur deux cœurs : la tâche rend la main par
+// un store release, loop() la reprend par un load acquire (écritures de la
+// tâche dans mqtt et tlsClient visibles)
+TaskHandle_t mqttConnectTaskHandle = NULL;
+std::atomic<bool> mqttConnecting(false);
+std::atomic<uint8_t> mqttConnectResult(MQTT_ATTEMPT_PENDING);
+bool ntpStarted = false;
+int ledBlinkTimer = -1;
+uint8_t ledBlinkToggles = 0;
+
+// === OUTBOX PERSISTANTE ===
+// Accès brut à une zone de la partition "outbox" (un journal par zone)
+class PartitionFlash {
+ public:
+  // Zone [offset, offset + length) ; length = 0 : jusqu'à la fin de la partition
+  bool begin(size_t offset, size_t length) {
+    partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          (esp_partition_subtype_t)OUTBOX_PARTITION_SUBTYPE, "outbox");
+    if (partition_ == NULL || offset >= partition_->size) {
+      partition_ = NULL;
+      return false;
+    }
+    // Les marques de consommation réécrivent un octet en place (voir segment_log.h)
+    if (partition_->encrypted) {
+      DEBUG_PRINTLN("[OUTBOX] ⚠️ Partition \"outbox\" chiffrée, non utilisable");
+      partition_ = NULL;
+      return false;
+    }
+    base_ = offset;
+    size_ = length > 0 && length < partition_->size - offset ? length : partition_->size - offset;
+    return true;
+  }
+  size_t size() const { return partition_ ? size_ : 0; }
+  bool read(size_t offset, void* dst, size_t length) {
+    return esp_partition_read(partition_, base_ + offset, dst, length) == ESP_OK;
+  }
+  bool write(size_t offset, const void* src, size_t length) {
+    return esp_partition_write(partition_, base_ + offset, src, length) == ESP_OK;
+  }
+  bool eraseSector(size_t offset) {
+    return esp_partition_erase_range(partition_, base_ + offset, SEGMENT_LOG_SECTOR_SIZE) == ESP_OK;
+  }
+
+ private:
+  const esp_partition_t* partition_ = NULL;
+  size_t base_ = 0;
+  size_t size_ = 0;
+};
+
+typedef SegmentLog<PartitionFlash, OUTBOX_STAGING_SIZE> OutboxLog;
+PartitionFlash sessionFlash;
+PartitionFlash motionFlash;
+OutboxLog sessionLog(sessionFlash, OUTBOX_SESSION_LAYOUT);
+OutboxLog motionLog(motionFlash, OUTBOX_MOTION_LAYOUT);
+OutboxLog* const laneLogs[LANE_COUNT] = {NULL, &sessionLog, NULL, &motionLog};
+uint8_t replayPayload[OUTBOX_STAGING_SIZE];
+int outboxFlushTimer = -1;
+TokenBucket drainBucket(OUTBOX_DRAIN_RATE, OUTBOX_DRAIN_BURST);
+bool drainPaused = false;              // Après un échec, reprise au prochain contrôle du buffer
+uint64_t drainStartUs = 0;             // Début du vidage en cours (0 = aucun)
+size_t outboxUncommitted = 0;          // Messages envoyés pas encore marqués en flash
+// QoS 0 : messages publiés pendant ce tour de vidage, retirés de leur file
+// (et marqués en flash) seulement après le flushWrites() commun
+size_t drainUnflushed[LANE_COUNT] = {0};
+LogReadMark drainMarks[LANE_COUNT];    // Files en flash : reprise si ce flush échoue
+
+// Source d'une publication QoS 1, libérée à son PUBACK
+const uint8_t INFLIGHT_DIRECT = LANE_COUNT;      // Publication directe, sans autre copie
+const uint8_t INFLIGHT_RTC = LANE_COUNT + 1;     // Détection gardée en RTC (deep sleep)
+struct InflightTag {
+  uint8_t source;          // File de l'outbox, INFLIGHT_DIRECT ou INFLIGHT_RTC
+  uint64_t seq;            // Statut : numéro du premier envoi ; RTC : numéro de la détection
+  LogPosition position;    // File en flash : enregistrement à marquer
+};
+typedef InflightWindow<InflightTag, INFLIGHT_WINDOW_MAX, INFLIGHT_POOL_SIZE> PublishWindow;
+PublishWindow inflight;
+LogPosition laneAcked[LANE_COUNT];     // Dernier enregistrement acquitté, par file en flash
+bool laneAckPending[LANE_COUNT] = {};
+uint64_t wakeEventsSentSeq = 0;        // Dernière détection RTC passée dans la fenêtre
+uint16_t publishPacketId = 0;          // QoS 1 de la prochaine publication (0 = QoS 0)
+bool publishDup = false;
+uint64_t lastPirServiceUs = 0;
+uint64_t lastIdleUs = 0;               // Attente passée dans waitForNextEvent() au dernier tour
 
 // === PREFERENCES (EEPROM) ===
 Preferences preferences;
 
+// Fin du bloc de numéros de séquence réservé, dans le namespace de la config
+class NvsSequenceStore {
+ public:
+  bool load(uint64_t& value) {
+    preferences.begin("iot-detector", true);
+    value = preferences.getULong64("seqEnd", 0);
+    preferences.end();
+    return true;
+  }
+  bool save(uint64_t value) {
+    preferences.begin("iot-detector", false);
+    size_t written = preferences.putULong64("seqEnd", value);
+    preferences.end();
+    return written == sizeof(value);
+  }
+};
+
+NvsSequenceStore seqStore;
+SequenceAllocator<NvsSequenceStore> sequence(seqStore, SEQ_BLOCK_SIZE);
+
 // === DÉCLARATIONS FORWARD ===
 void handleConnection();
-void connectMQTT();
-void publishStatus();
-void sendBufferedMessages();
+bool connectMQTT();
+void wakeLoop();
+void publishStatus(bool full = false);
+void publishDetectionJson(uint8_t sensor, uint64_t timestampUs);
+void publishMotionBatch();
+void publishSessionJson(const OccupancySession& session);
+void drainOutboxStep();
+// Issue d'une publication : un enregistrement illisible est retiré sans être envoyé
+enum PublishResult : uint8_t {
+  PUBLISH_FAILED,
+  PUBLISH_SENT,
+  PUBLISH_DROPPED
+};
+PublishResult publishRecord(uint8_t type, const uint8_t* data, size_t length, uint64_t* statusSeq = NULL);
+PublishWindow::Entry* trackPublish(uint8_t type, const uint8_t* data, size_t length, uint8_t source,
+                                   uint64_t seq = 0);
+PublishResult sendInflight(size_t index, bool dup);
+void releaseAcked();
+bool buildRecordJson(uint8_t type, const uint8_t* data, size_t length, JsonDocument& doc);
 void publishTwinReported();
 void saveConfig();
 void loadConfig();
+void queueWakeEvent(uint8_t sensor);
+void noteWakePublish();
+void buildMessageFilters();
 
 // ============================================
 // FONCTIONS UTILITAIRES AZURE
@@ -182,16 +568,10 @@ bool hmacSha256(const std::vector<uint8_t>&key,const uint8_t*msg,size_t len,uint
   return mbedtls_md_hmac(md, key.data(), key.size(), msg, len, out) == 0;
 }
 
-bool waitForTime(uint32_t ms=10000){
-  uint32_t s=millis();
+bool timeIsSet(){
   time_t now=0;
-  while(millis()-s<ms){ 
-    time(&now); 
-    if(now>1700000000) return true; 
-    delay(200); 
-    esp_task_wdt_reset();
-  }
-  return false;
+  time(&now);
+  return now>1700000000;
 }
 
 String buildSasToken(const String&host,const String&dev,const String&keyB64,uint32_t ttl){
@@ -216,6 +596,413 @@ String buildSasToken(const String&host,const String&dev,const String&keyB64,uint
   return "SharedAccessSignature sr="+urlEncode(res)+"&sig="+sig+"&se="+String(exp);
 }
 
+// ============================================
+// FONCTIONS PIR (ISR + TRAITEMENT DES FRONTS)
+// ============================================
+
+// Light sleep : les interruptions sur front ne réveillent pas l'ESP32.
+// Chaque PIR attend le niveau opposé à son niveau courant (interruption de
+// niveau, source de réveil GPIO) : l'effet est celui d'un front, réarmé à
+// chaque interruption.
+// Appelé depuis l'ISR : table en DRAM et accès registres par macros en
+// ligne, rien en flash (le cache peut être coupé pendant une écriture NVS).
+void IRAM_ATTR armPirLevelWake(uint32_t levels) {
+  for (size_t i = 0; i < PIR_COUNT; i++) {
+    uint8_t pin = PIR_PINS[i];
+    uint32_t intType = ((levels >> pin) & 1U) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+    REG_SET_FIELD(GPIO_REG(pin), GPIO_PIN_INT_TYPE, intType);
+    REG_SET_BIT(GPIO_REG(pin), GPIO_PIN_WAKEUP_ENABLE);
+  }
+}
+
+void disarmPirLevelWake() {
+  for (size_t i = 0; i < PIR_COUNT; i++) {
+    REG_CLR_BIT(GPIO_REG(PIR_PINS[i]), GPIO_PIN_WAKEUP_ENABLE);
+    REG_SET_FIELD(GPIO_REG(PIR_PINS[i]), GPIO_PIN_INT_TYPE, GPIO_INTR_ANYEDGE);
+  }
+}
+
+// Horodate chaque front d'un PIR avec un instantané de toutes les entrées,
+// le traitement se fait dans loop()
+void IRAM_ATTR onPirEdge() {
+  PirEdge edge;
+  edge.timestampUs = (uint64_t)esp_timer_get_time();
+  edge.levels = REG_READ(GPIO_IN_REG);
+  pirEdgeQueue.push(edge);
+  if (pirLevelWakeArmed) {
+    armPirLevelWake(edge.levels);
+  }
+  
+  BaseType_t higherPriorityWoken = pdFALSE;
+  if (loopTaskHandle) {
+    vTaskNotifyGiveFromISR(loopTaskHandle, &higherPriorityWoken);
+  }
+  if (higherPriorityWoken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+// Cooldown réellement appliqué par le pipeline (ms)
+unsigned long effectiveCooldown() {
+  if (config.adaptiveCooldown && adaptiveCooldown.effectiveMs() > 0) {
+    return adaptiveCooldown.effectiveMs();
+  }
+  return config.cooldownPeriod;
+}
+
+// Budget horaire appliqué par le cooldown : seulement quand chaque détection
+// part dans son propre message (sessions et lots ont leur propre rythme)
+uint32_t cooldownBudget() {
+  if (config.powerMode != POWER_DEEP_SLEEP && (config.sessionMode || config.batchWindow > 0)) {
+    return 0;
+  }
+  return config.maxMessagesPerHour;
+}
+
+void refreshCooldown() {
+  if (config.adaptiveCooldown) {
+    adaptiveCooldown.update((uint64_t)esp_timer_get_time(), config.cooldownPeriod,
+                            cooldownBudget(), ADAPTIVE_MAX_COOLDOWN);
+  }
+  pirBank.params().cooldownUs = effectiveCooldown() * 1000UL;
+}
+
+void refreshAdaptiveCooldown() {
+  if (config.adaptiveCooldown) {
+    unsigned long before = effectiveCooldown();
+    refreshCooldown();
+    if (effectiveCooldown() != before) {
+      DEBUG_PRINTF("[ADAPT] Cooldown effectif: %lu ms → %lu ms (%lu capteurs actifs)\n", before,
+                   effectiveCooldown(), (unsigned long)adaptiveCooldown.activeSensors());
+    }
+  }
+}
+
+void onCooldownCandidate(uint8_t sensor, uint64_t timestampUs) {
+  adaptiveCooldown.onCandidate(sensor, timestampUs);
+  refreshAdaptiveCooldown();
+}
+
+void addToMotionBatch(uint8_t sensor, uint64_t timestampUs) {
+  MotionBatchEntry entry;
+  entry.timestampMs = (uint32_t)(timestampUs / 1000);
+  entry.sensor = sensor;
+  motionBatch.add(entry);
+  DEBUG_PRINTF("[BATCH] Détection ajoutée au lot (%u/%u)\n",
+               (unsigned)motionBatch.size(), (unsigned)MOTION_BATCH_CAPACITY);
+  if (motionBatch.full()) {
+    publishMotionBatch();
+  }
+}
+
+// Publie le lot quand la fenêtre expire (ou immédiatement si le regroupement est coupé)
+void processMotionBatch() {
+  if (motionBatch.empty()) {
+    return;
+  }
+  if (config.batchWindow == 0 || config.sessionMode ||
+      motionBatch.expired((uint32_t)millis(), config.batchWindow)) {
+    publishMotionBatch();
+  }
+}
+
+void handlePirEvent(uint8_t sensor, PirEvent event, uint64_t timestampUs, uint64_t cooldownRemainingUs) {
+  switch (event) {
+    case PIR_EVENT_MOTION_START:
+      metrics.detectionCount++;
+      onCooldownCandidate(sensor, timestampUs);
+
+      DEBUG_PRINTLN("\n╔═══════════════════════════════════════╗");
+      DEBUG_PRINTF("║  🚨 DÉTECTION #%-4d  (PIR %-2u)        ║\n", metrics.detectionCount, sensor);
+      DEBUG_PRINTLN("╚═══════════════════════════════════════╝");
+
+      digitalWrite(LED_PIN, HIGH);
+
+      if (config.powerMode == POWER_DEEP_SLEEP) {
+        // Sessions et lots ne survivent pas au sommeil : une détection = un événement
+        queueWakeEvent(sensor);
+      } else {
+        occupancy.onMotionStart(sensor, timestampUs);
+        if (!config.sessionMode) {
+          if (config.batchWindow > 0) {
+            addToMotionBatch(sensor, timestampUs);
+          } else {
+            publishDetectionJson(sensor, timestampUs);
+          }
+        }
+      }
+
+      DEBUG_PRINTLN("───────────────────────────────────────\n");
+      break;
+
+    case PIR_EVENT_MOTION_END:
+      if (!pirBank.anyMotion()) {
+        digitalWrite(LED_PIN, LOW);
+      }
+      occupancy.onMotionEnd(sensor, timestampUs);
+      DEBUG_PRINTF("[PIR %u] ✅ Mouvement terminé\n", sensor);
+      break;
+
+    case PIR_EVENT_RETRIGGER:
+      occupancy.onActivity(sensor, timestampUs);
+      DEBUG_PRINTF("[PIR %u] 🔁 Redéclenchement fusionné\n", sensor);
+      break;
+
+    case PIR_EVENT_COOLDOWN_REJECTED:
+      occupancy.onActivity(sensor, timestampUs);
+      onCooldownCandidate(sensor, timestampUs);
+      DEBUG_PRINTF("[PIR %u] ⏳ Cooldown actif (%lu ms restant)\n", sensor,
+                    (unsigned long)(cooldownRemainingUs / 1000));
+      break;
+
+    default:
+      break;
+  }
+}
+
+void applyDetectionParams() {
+  DetectionParams& params = pirBank.params();
+  params.debounceUs = DEBOUNCE_DELAY * 1000UL;
+  params.minPulseUs = config.minPulseWidth * 1000UL;
+  params.mergeUs = config.retriggerMerge * 1000UL;
+  params.riseHoldUs = config.riseHold * 1000UL;
+  params.fallHoldUs = config.fallHold * 1000UL;
+  refreshCooldown();
+}
+
+// Écart entre deux traitements PIR, hors attente, mesuré pendant un vidage
+// et pendant une (re)connexion
+void notePirService(bool connecting) {
+  uint64_t nowUs = (uint64_t)esp_timer_get_time();
+  if (lastPirServiceUs != 0) {
+    uint64_t busyUs = nowUs - lastPirServiceUs - lastIdleUs;
+    if (drainStartUs != 0 && busyUs > metrics.maxPirGapUs) {
+      metrics.maxPirGapUs = (uint32_t)busyUs;
+    }
+    if (connecting && busyUs > metrics.maxConnectGapUs) {
+      metrics.maxConnectGapUs = (uint32_t)busyUs;
+    }
+  }
+  lastPirServiceUs = nowUs;
+  lastIdleUs = 0;
+}
+
+void processPirEdges() {
+  PirEdge edge;
+  while (pirEdgeQueue.pop(edge)) {
+    uint32_t latencyUs = (uint32_t)((uint64_t)esp_timer_get_time() - edge.timestampUs);
+    if (latencyUs > metrics.maxWakeLatencyUs) {
+      metrics.maxWakeLatencyUs = latencyUs;
+    }
+    metrics.wakeLatencySumUs += latencyUs;
+    metrics.wakeLatencySamples++;
+    pirBank.process(edge, handlePirEvent);
+  }
+  pirBank.poll((uint64_t)esp_timer_get_time(), handlePirEvent);
+}
+
+// Détection désactivée : on vide la file sans générer d'événement
+void discardPirEdges() {
+  PirEdge edge;
+  while (pirEdgeQueue.pop(edge)) {
+    pirBank.resync(edge);
+  }
+  if (pirBank.anyMotion()) {
+    pirBank.clearMotion();
+    occupancy.onAllMotionEnd((uint64_t)esp_timer_get_time());
+    digitalWrite(LED_PIN, LOW);
+  }
+}
+
+// Ferme les sessions d'occupation dont la pièce est vide depuis idleTimeout
+void processOccupancy() {
+  OccupancySession session;
+  if (occupancy.poll((uint64_t)esp_timer_get_time(),
+                     config.idleTimeout * 1000ULL,
+                     SESSION_MAX_DURATION * 1000ULL,
+                     session)) {
+    metrics.sessionCount++;
+    DEBUG_PRINTF("[SESSION] 🏁 Session #%d : %lu ms, %lu détections, %lu redéclenchements%s\n",
+                 metrics.sessionCount, (unsigned long)session.dwellMs(),
+                 (unsigned long)session.detections, (unsigned long)session.retriggers,
+                 session.partial ? " (partielle)" : "");
+    if (config.sessionMode) {
+      publishSessionJson(session);
+    }
+  }
+}
+
+// ============================================
+// FONCTIONS ÉNERGIE (MODEM / LIGHT SLEEP)
+// ============================================
+
+const char* powerModeName(PowerMode mode) {
+  switch (mode) {
+    case POWER_DEEP_SLEEP: return "deepSleep";
+    case POWER_MODEM_SLEEP: return "modemSleep";
+    case POWER_LIGHT_SLEEP: return "lightSleep";
+    default: return "alwaysOn";
+  }
+}
+
+// Renvoie false si le nom est inconnu
+bool parsePowerMode(const char* name, PowerMode& mode) {
+  if (name == nullptr) {
+    return false;
+  }
+  const PowerMode modes[] = {POWER_ALWAYS_ON, POWER_DEEP_SLEEP, POWER_MODEM_SLEEP, POWER_LIGHT_SLEEP};
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    if (strcmp(name, powerModeName(modes[i])) == 0) {
+      mode = modes[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool radioSleepEnabled() {
+  return config.powerMode == POWER_MODEM_SLEEP || config.powerMode == POWER_LIGHT_SLEEP;
+}
+
+// Intervalle d'écoute WiFi en beacons (0 = défaut du driver, réveil à chaque DTIM)
+uint16_t wifiListenInterval() {
+  if (!radioSleepEnabled() || config.c2dLatency < WIFI_DTIM_LATENCY) {
+    return 0;
+  }
+  unsigned long latency = config.c2dLatency < MAX_C2D_LATENCY ? config.c2dLatency : MAX_C2D_LATENCY;
+  return (uint16_t)(latency / WIFI_BEACON_INTERVAL);
+}
+
+wifi_ps_type_t wifiSleepType() {
+  if (!radioSleepEnabled()) {
+    return WIFI_PS_MIN_MODEM;  // Défaut Arduino
+  }
+  return wifiListenInterval() > 0 ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM;
+}
+
+// Light sleep automatique pendant l'attente de loop() (FreeRTOS tickless idle).
+// Renvoie false si le framework n'a pas été compilé avec la gestion d'énergie.
+bool configureLightSleep(bool enable) {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t pm;
+  pm.max_freq_mhz = ESP.getCpuFreqMHz();
+  pm.min_freq_mhz = pm.max_freq_mhz;  // Fréquence fixe : UART et timers non perturbés
+  pm.light_sleep_enable = enable;
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK) {
+    DEBUG_PRINTF("[POWER] ⚠️ esp_pm_configure: %s\n", esp_err_to_name(err));
+    return false;
+  }
+  
+  if (enable) {
+    esp_sleep_enable_gpio_wakeup();
+    pirLevelWakeArmed = true;
+    armPirLevelWake(REG_READ(GPIO_IN_REG));
+  } else if (pirLevelWakeArmed) {
+    pirLevelWakeArmed = false;
+    disarmPirLevelWake();
+  }
+  return true;
+#else
+  return !enable;
+#endif
+}
+
+// Applique powerMode et c2dLatency ; l'intervalle d'écoute n'est négocié
+// qu'à l'association, la connexion WiFi est refaite s'il change
+void applyPowerMode() {
+  PowerMode previous = activePowerMode;
+  activePowerMode = config.powerMode;
+  
+  if (activePowerMode == POWER_LIGHT_SLEEP) {
+    if (!configureLightSleep(true)) {
+      DEBUG_PRINTLN("[POWER] ⚠️ Light sleep indisponible, repli en modem sleep");
+      activePowerMode = POWER_MODEM_SLEEP;
+    }
+  } else if (previous == POWER_LIGHT_SLEEP) {
+    configureLightSleep(false);
+  }
+  
+  WiFi.setSleep(wifiSleepType());
+  
+  if (activePowerMode != previous) {
+    DEBUG_PRINTF("[POWER] Mode: %s → %s (intervalle d'écoute %u)\n",
+                 powerModeName(previous), powerModeName(activePowerMode), wifiListenInterval());
+  }
+  
+  if (connectionState != DISCONNECTED && connectionState != CONNECTING_WIFI &&
+      wifiListenInterval() != appliedListenInterval) {
+    DEBUG_PRINTLN("[POWER] Nouvel intervalle d'écoute, reconnexion WiFi");
+    if (!mqttConnecting.load(std::memory_order_acquire)) {
+      mqtt.disconnect();
+    }
+    WiFi.disconnect();
+    connectionState = DISCONNECTED;
+    lastConnectionAttempt = millis() - CONNECTION_RETRY_INTERVAL - 1;
+  }
+}
+
+// Lance l'association WiFi avec l'intervalle d'écoute du mode courant
+void beginWiFi() {
+  uint16_t listenInterval = wifiListenInterval();
+  bool connectNow = listenInterval == 0;
+  
+  WiFi.mode(WIFI_STA);
+  // WiFi.begin() réécrit la configuration (listen_interval à 0) et la
+  // reconnexion automatique du framework ferait de même
+  WiFi.setAutoReconnect(connectNow);
+  if (fastBoot && rtcState.wifiChannel != 0) {
+    // Canal et BSSID mémorisés : pas de scan complet au réveil
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, rtcState.wifiChannel, rtcState.wifiBssid, connectNow);
+  } else {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, 0, NULL, connectNow);
+  }
+  
+  if (!connectNow) {
+    wifi_config_t wifiConfig;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifiConfig) == ESP_OK) {
+      wifiConfig.sta.listen_interval = listenInterval;
+      esp_wifi_set_config(WIFI_IF_STA, &wifiConfig);
+    }
+    esp_wifi_connect();
+  }
+  appliedListenInterval = listenInterval;
+}
+
+// ============================================
+// FONCTIONS ENCODAGE (JSON / MESSAGEPACK)
+// ============================================
+
+const char* encodingName(PayloadEncoding encoding) {
+  return encoding == ENCODING_MSGPACK ? "msgpack" : "json";
+}
+
+// Renvoie false si le nom est inconnu
+bool parseEncoding(const char* name, PayloadEncoding& encoding) {
+  if (name == nullptr) {
+    return false;
+  }
+  if (strcmp(name, "json") == 0) {
+    encoding = ENCODING_JSON;
+  } else if (strcmp(name, "msgpack") == 0) {
+    encoding = ENCODING_MSGPACK;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Topics de télémétrie avec les propriétés système IoT Hub $.ct (content
+// type) et $.ce (content encoding) : le routage sur le corps du message
+// ne fonctionne que pour du JSON déclaré application/json + utf-8
+void applyEncoding() {
+  snprintf(jsonTelemetryTopic, sizeof(jsonTelemetryTopic),
+           "devices/%s/messages/events/$.ct=application%%2Fjson&$.ce=utf-8", IOTHUB_DEVICE_ID);
+  snprintf(msgpackTelemetryTopic, sizeof(msgpackTelemetryTopic),
+           "devices/%s/messages/events/$.ct=application%%2Fmsgpack", IOTHUB_DEVICE_ID);
+  strcpy(telemetryTopic, config.encoding == ENCODING_MSGPACK ? msgpackTelemetryTopic : jsonTelemetryTopic);
+}
+
 // ============================================
 // FONCTIONS CONFIGURATION (EEPROM)
 // ============================================
@@ -224,7 +1011,24 @@ void saveConfig() {
   preferences.begin("iot-detector", false);
   preferences.putBool("detectionEnabled", config.detectionEnabled);
   preferences.putULong("cooldown", config.cooldownPeriod);
+  preferences.putULong("minPulse", config.minPulseWidth);
+  preferences.putULong("mergeWindow", config.retriggerMerge);
+  preferences.putULong("riseHold", config.riseHold);
+  preferences.putULong("fallHold", config.fallHold);
+  preferences.putBool("sessionMode", config.sessionMode);
+  preferences.putULong("idleTimeout", config.idleTimeout);
+  preferences.putBool("adaptive", config.adaptiveCooldown);
+  preferences.putULong("msgPerHour", config.maxMessagesPerHour);
+  preferences.putULong("batchWindow", config.batchWindow);
+  preferences.putUChar("powerMode", config.powerMode);
+  preferences.putULong("c2dLatency", config.c2dLatency);
+  preferences.putUChar("encoding", config.encoding);
+  preferences.putUChar("inflightWindow", config.inflightWindow);
   preferences.end();
+  applyDetectionParams();
+  applyPowerMode();
+  applyEncoding();
+  inflight.setLimit(config.inflightWindow);
   DEBUG_PRINTLN("[CONFIG] ✅ Sauvegardé en EEPROM");
 }
 
@@ -232,181 +1036,1091 @@ void loadConfig() {
   preferences.begin("iot-detector", true);
   config.detectionEnabled = preferences.getBool("detectionEnabled", true);
   config.cooldownPeriod = preferences.getULong("cooldown", 5000);
+  config.minPulseWidth = preferences.getULong("minPulse", 0);
+  config.retriggerMerge = preferences.getULong("mergeWindow", 0);
+  config.riseHold = preferences.getULong("riseHold", 0);
+  config.fallHold = preferences.getULong("fallHold", 0);
+  config.sessionMode = preferences.getBool("sessionMode", false);
+  config.idleTimeout = preferences.getULong("idleTimeout", 60000);
+  config.adaptiveCooldown = preferences.getBool("adaptive", false);
+  config.maxMessagesPerHour = preferences.getULong("msgPerHour", 120);
+  config.batchWindow = preferences.getULong("batchWindow", 0);
+  uint8_t powerMode = preferences.getUChar("powerMode", POWER_ALWAYS_ON);
+  config.powerMode = powerMode <= POWER_LIGHT_SLEEP ? (PowerMode)powerMode : POWER_ALWAYS_ON;
+  config.c2dLatency = preferences.getULong("c2dLatency", 1000);
+  uint8_t encoding = preferences.getUChar("encoding", ENCODING_JSON);
+  config.encoding = encoding <= ENCODING_MSGPACK ? (PayloadEncoding)encoding : ENCODING_JSON;
+  uint8_t window = preferences.getUChar("inflightWindow", INFLIGHT_WINDOW_DEFAULT);
+  config.inflightWindow = window <= INFLIGHT_WINDOW_MAX ? window : INFLIGHT_WINDOW_DEFAULT;
   preferences.end();
-  DEBUG_PRINTF("[CONFIG] ✅ Chargé: detectionEnabled=%s, cooldown=%lu ms\n", 
+  applyDetectionParams();
+  applyPowerMode();
+  applyEncoding();
+  inflight.setLimit(config.inflightWindow);
+  DEBUG_PRINTF("[CONFIG] ✅ Chargé: detectionEnabled=%s, cooldown=%lu ms, minPulse=%lu ms, mergeWindow=%lu ms\n", 
                config.detectionEnabled ? "true" : "false", 
-               config.cooldownPeriod);
+               config.cooldownPeriod, config.minPulseWidth, config.retriggerMerge);
+  DEBUG_PRINTF("[CONFIG] ✅ Chargé: riseHold=%lu ms, fallHold=%lu ms\n", 
+               config.riseHold, config.fallHold);
+  DEBUG_PRINTF("[CONFIG] ✅ Chargé: sessionMode=%s, idleTimeout=%lu ms\n", 
+               config.sessionMode ? "true" : "false", config.idleTimeout);
+  DEBUG_PRINTF("[CONFIG] ✅ Chargé: adaptiveCooldown=%s, maxMessagesPerHour=%lu, batchWindow=%lu ms\n", 
+               config.adaptiveCooldown ? "true" : "false", config.maxMessagesPerHour,
+               config.batchWindow);
+  DEBUG_PRINTF("[CONFIG] ✅ Chargé: powerMode=%s, c2dLatency=%lu ms, encoding=%s, inflightWindow=%u\n",
+               powerModeName(config.powerMode), config.c2dLatency, encodingName(config.encoding),
+               config.inflightWindow);
 }
 
 // ============================================
 // FONCTIONS BUFFER
 // ============================================
 
-void addToBuffer(const String& topic, const String& payload) {
-  if (messageBuffer.size() >= MAX_BUFFER_SIZE) {
-    DEBUG_PRINTLN("[BUFFER] ⚠️ Buffer plein, suppression du plus ancien");
-    messageBuffer.erase(messageBuffer.begin());
+// Topic d'envoi selon le type d'enregistrement
+const char* outboxTopicName(uint8_t type) {
+  switch (type) {
+    case RECORD_TWIN_REPORTED:
+      // Nouveau $rid à chaque envoi
+      twinReportedRid = twinRequestId++;
+      snprintf(twinReportedTopic, sizeof(twinReportedTopic),
+               "$iothub/twin/PATCH/properties/reported/?$rid=%d", twinReportedRid);
+      return twinReportedTopic;
+    case RECORD_MSGPACK:
+      return msgpackTelemetryTopic;
+    default:
+      // Les enregistrements binaires sont rendus dans l'encodage courant
+      return recordIsJson(type) ? jsonTelemetryTopic : telemetryTopic;
+  }
+}
+
+uint8_t laneForType(uint8_t type) {
+  switch (type) {
+    case RECORD_TWIN_REPORTED:
+      return LANE_TWIN;
+    case RECORD_SESSION:
+      return LANE_SESSION;
+    case RECORD_STATUS:
+      return LANE_HEALTH;
+    default:
+      return LANE_MOTION;
+  }
+}
+
+// File gardée en flash si la partition existe, sinon dans son anneau en RAM
+bool laneOnFlash(uint8_t lane) {
+  return laneLogs[lane] != NULL && laneLogs[lane]->mounted();
+}
+
+size_t lanePending(uint8_t lane) {
+  return laneOnFlash(lane) ? laneLogs[lane]->pending() : laneRings[lane]->size();
+}
+
+// Perdus : évincés, ou trop grands pour leur file
+uint32_t laneDropped(uint8_t lane) {
+  uint32_t dropped = laneRings[lane]->dropped() + laneRings[lane]->tooLarge() + laneOversized[lane];
+  if (laneLogs[lane] != NULL) {
+    dropped += laneLogs[lane]->dropped() + laneLogs[lane]->tooLarge();
+  }
+  return dropped;
+}
+
+// Vide une file (commande clearBuffer, ou statut plus récent déjà envoyé)
+void discardLane(uint8_t lane) {
+  laneRings[lane]->clear();
+  if (laneOnFlash(lane)) {
+    laneLogs[lane]->discardAll();
+  }
+}
+
+size_t outboxPending() {
+  size_t pending = 0;
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    pending += lanePending(lane);
+  }
+  return pending;
+}
+
+uint32_t outboxDropped() {
+  uint32_t dropped = 0;
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    dropped += laneDropped(lane);
+  }
+  return dropped;
+}
+
+// Écrit en flash les lots en attente (aussi avant un redémarrage ou un deep sleep)
+void flushOutbox() {
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    if (laneOnFlash(lane) && laneLogs[lane]->stagedBytes() > 0 && !laneLogs[lane]->flush()) {
+      DEBUG_PRINTF("[OUTBOX] ❌ Écriture flash échouée (%s)\n", LANE_NAMES[lane]);
+    }
+  }
+  timers.setEnabled(outboxFlushTimer, false, millis());
+}
+
+void addToBuffer(OutboxRecordType type, const void* payload, size_t length) {
+  uint8_t lane = laneForType(type);
+  if (laneOnFlash(lane)) {
+    if (!laneLogs[lane]->append(type, (const uint8_t*)payload, length)) {
+      DEBUG_PRINTF("[OUTBOX] ❌ Message non journalisé (%u octets)\n", (unsigned)length);
+      return;
+    }
+    timers.setEnabled(outboxFlushTimer, true, millis());
+  } else {
+    switch (laneRings[lane]->push(type, (const uint8_t*)payload, length, millis())) {
+      case MessageRingBase::PUSH_TOO_LARGE:
+        DEBUG_PRINTF("[BUFFER] ❌ Message trop grand (%u octets), ignoré\n", (unsigned)length);
+        return;
+      case MessageRingBase::PUSH_DROPPED_NEWEST:
+        DEBUG_PRINTF("[BUFFER] ⚠️ File %s pleine, message ignoré\n", LANE_NAMES[lane]);
+        return;
+      case MessageRingBase::PUSH_DROPPED_OLDEST:
+        DEBUG_PRINTF("[BUFFER] ⚠️ File %s pleine, suppression du plus ancien\n", LANE_NAMES[lane]);
+        break;
+      default:
+        break;
+    }
   }
-  
-  PendingMessage msg;
-  msg.topic = topic;
-  msg.payload = payload;
-  msg.timestamp = millis();
-  
-  messageBuffer.push_back(msg);
   metrics.bufferedMessagesCount++;
   
-  DEBUG_PRINTF("[BUFFER] Message ajouté (#%d en attente)\n", messageBuffer.size());
+  DEBUG_PRINTF("[BUFFER] Message ajouté à la file %s (#%d en attente)\n", LANE_NAMES[lane], outboxPending());
 }
 
-void sendBufferedMessages() {
-  if (messageBuffer.empty()) {
-    return;
+// Plus ancien message de la file (après ceux publiés dans ce tour de vidage)
+bool outboxFront(uint8_t lane, uint8_t& type, const uint8_t*& payload, size_t& length) {
+  if (laneOnFlash(lane)) {
+    LogRecordInfo record;
+    if (!laneLogs[lane]->peek(record, replayPayload)) {
+      return false;
+    }
+    type = record.type;
+    payload = replayPayload;
+    length = record.length;
+    return true;
   }
-  
-  if (connectionState != FULLY_CONNECTED) {
-    DEBUG_PRINTLN("[BUFFER] Pas connecté, impossible d'envoyer");
+  MessageSlot slot;
+  if (!laneRings[lane]->peekAt(drainUnflushed[lane], slot, payload)) {
+    return false;
+  }
+  type = slot.type;
+  length = slot.length;
+  return true;
+}
+
+void outboxPop(uint8_t lane) {
+  if (laneOnFlash(lane)) {
+    laneLogs[lane]->consume();
+  } else {
+    laneRings[lane]->pop();
+  }
+}
+
+// Marque en flash la position de lecture des files persistantes ;
+// tant que la fenêtre QoS 1 n'est pas vide, seulement jusqu'au dernier
+// message acquitté. La fenêtre décide, pas inflightWindow : passé à 0 par
+// le Device Twin, des messages lus en flash peuvent encore attendre leur PUBACK
+void commitOutbox() {
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    if (!laneOnFlash(lane)) {
+      continue;
+    }
+    if (laneAckPending[lane]) {
+      laneLogs[lane]->commitThrough(laneAcked[lane]);
+      laneAckPending[lane] = false;
+    }
+    if (inflight.empty()) {
+      laneLogs[lane]->commit();
+    }
+  }
+  outboxUncommitted = 0;
+}
+
+// Vidage progressif : quelques messages par tour de loop(), cadencés par le
+// seau à jetons, pour que le traitement PIR ne soit jamais bloqué longtemps
+void endOutboxDrain(uint64_t nowUs) {
+  if (outboxUncommitted > 0) {
+    commitOutbox();
+  }
+  if (drainStartUs != 0) {
+    metrics.drainTimeMs += (uint32_t)((nowUs - drainStartUs) / 1000);
+    drainStartUs = 0;
+    DEBUG_PRINTF("[BUFFER] 📊 Vidage terminé, %d en attente\n", outboxPending());
+  }
+}
+
+bool outboxDrainActive() {
+  return !drainPaused && connectionState == FULLY_CONNECTED && outboxPending() > 0;
+}
+
+// QoS 0 : le message publié reste dans sa file jusqu'au flush du tour.
+// Une file en flash avance déjà sa lecture (en RAM jusqu'au commit).
+void holdUnflushed(uint8_t lane) {
+  if (laneOnFlash(lane)) {
+    if (drainUnflushed[lane] == 0) {
+      drainMarks[lane] = laneLogs[lane]->readMark();
+    }
+    laneLogs[lane]->consume();
+  }
+  drainUnflushed[lane]++;
+}
+
+// Fin d'un tour de vidage en QoS 0 : un seul flushWrites() pour tous les
+// messages publiés (un enregistrement TLS), puis retrait de leur file.
+// Échec (ou connexion perdue pendant le tour, un buffer plein a pu être
+// écrit en partie) : rien n'est retiré, les messages repartent au prochain
+// vidage. Renvoie le nombre de messages confirmés.
+size_t settleUnflushed() {
+  size_t held = 0;
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    held += drainUnflushed[lane];
+  }
+  if (held == 0) {
+    return 0;
+  }
+  bool flushed = mqtt.flushWrites() && mqtt.connected();
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    size_t count = drainUnflushed[lane];
+    drainUnflushed[lane] = 0;
+    if (count == 0) {
+      continue;
+    }
+    if (!laneOnFlash(lane)) {
+      for (size_t i = 0; flushed && i < count; i++) {
+        laneRings[lane]->pop();
+      }
+    } else if (flushed) {
+      outboxUncommitted += count;
+    } else if (!laneLogs[lane]->rewind(drainMarks[lane])) {
+      DEBUG_PRINTF("[BUFFER] ⚠️ File %s recyclée, %u messages non confirmés\n", LANE_NAMES[lane],
+                   (unsigned)count);
+    }
+  }
+  if (!flushed) {
+    DEBUG_PRINTLN("[BUFFER] ❌ Écriture TLS échouée, vidage suspendu");
+    drainPaused = true;
+    return 0;
+  }
+  if (outboxUncommitted >= OUTBOX_COMMIT_EVERY) {
+    commitOutbox();
+  }
+  return held;
+}
+
+// QoS 1 : fenêtre pleine, le vidage reprend au prochain PUBACK
+bool drainWaitingForAck() {
+  return config.inflightWindow > 0 && !inflight.canAdd(OUTBOX_PAYLOAD_SIZE);
+}
+
+// Priorité stricte : la première file non vide est toujours servie d'abord
+void drainOutboxStep() {
+  uint64_t startUs = (uint64_t)esp_timer_get_time();
+  if (!outboxDrainActive()) {
+    endOutboxDrain(startUs);
     return;
   }
   
-  DEBUG_PRINTF("[BUFFER] 📤 Envoi de %d messages en attente...\n", messageBuffer.size());
-  
-  std::vector<PendingMessage> toSend = messageBuffer;
-  messageBuffer.clear();
+  flushOutbox();
+  uint8_t lane = 0;
+  uint8_t type;
+  const uint8_t* payload;
+  size_t length;
+  size_t sent = 0;
+  size_t unflushedSent = 0;
+  uint64_t nowUs = startUs;
   
-  int successCount = 0;
-  int failCount = 0;
-  
-  for (size_t i = 0; i < toSend.size(); i++) {
-    bool ok = mqtt.publish(toSend[i].topic.c_str(), toSend[i].payload.c_str());
+  while (sent < OUTBOX_DRAIN_MAX_PER_LOOP && nowUs - startUs < OUTBOX_DRAIN_BUDGET_US) {
+    while (lane < LANE_COUNT && !outboxFront(lane, type, payload, length)) {
+      lane++;
+    }
+    bool tracked = config.inflightWindow > 0;
+    if (lane == LANE_COUNT || (tracked && !inflight.canAdd(length)) || !drainBucket.tryTake(nowUs)) {
+      break;
+    }
+    if (drainStartUs == 0) {
+      drainStartUs = nowUs;
+      DEBUG_PRINTF("[BUFFER] 📤 Vidage de %d messages en attente...\n", outboxPending());
+    }
     
-    if (ok) {
-      successCount++;
-      metrics.sentFromBufferCount++;
-      DEBUG_PRINTF("[BUFFER] ✅ %d/%d envoyé\n", i+1, toSend.size());
-      delay(100);
-    } else {
-      failCount++;
-      DEBUG_PRINTF("[BUFFER] ❌ %d/%d échoué\n", i+1, toSend.size());
-      addToBuffer(toSend[i].topic, toSend[i].payload);
+    if (tracked) {
+      // Copié dans la fenêtre : la file en flash n'est marquée qu'au PUBACK
+      if (!trackPublish(type, payload, length, lane)) {
+        break;
+      }
+      outboxPop(lane);
+    }
+    PublishResult result = tracked ? sendInflight(inflight.size() - 1, false)
+                                   : publishRecord(type, payload, length);
+    if (result == PUBLISH_FAILED) {
+      // Nouvel essai au prochain contrôle du buffer (QoS 1 : republié à la reconnexion)
+      DEBUG_PRINTF("[BUFFER] ❌ Envoi échoué (%s), vidage suspendu\n", LANE_NAMES[lane]);
+      drainPaused = true;
+      break;
     }
     
-    esp_task_wdt_reset();
+    sent++;
+    if (!tracked) {
+      // QoS 0 : rien d'autre ne confirme l'envoi, retiré après le flush du tour
+      holdUnflushed(lane);
+      if (result == PUBLISH_SENT) {
+        unflushedSent++;
+      }
+    } else if (result == PUBLISH_SENT) {
+      metrics.sentFromBufferCount++;
+      metrics.drainedMessages++;
+    }
+    nowUs = (uint64_t)esp_timer_get_time();
+  }
+  if (settleUnflushed() > 0) {
+    metrics.sentFromBufferCount += unflushedSent;
+    metrics.drainedMessages += unflushedSent;
   }
+  releaseAcked();
   
-  DEBUG_PRINTF("[BUFFER] 📊 Résumé: %d ✅, %d ❌\n", successCount, failCount);
+  if (!outboxDrainActive()) {
+    endOutboxDrain(nowUs);
+  }
 }
 
 // ============================================
 // FONCTIONS PUBLICATION (AVEC ARDUINOJSON)
 // ============================================
 
-void publishDetectionJson(){
-  String topic = "devices/" + String(IOTHUB_DEVICE_ID) + "/messages/events/";
-  
-  StaticJsonDocument<512> doc;
+// Sortie de serializeJson vers le client MQTT : ni String ni copie dans le
+// buffer de paquets. PubSubClient regroupe les écritures (setWriteBuffer) :
+// un enregistrement TLS pour plusieurs paquets au lieu d'un par caractère
+class MqttPayloadStream : public Print {
+ public:
+  size_t write(uint8_t c) override { return write(&c, 1); }
   
-  doc["event"] = "motion";
-  doc["count"] = metrics.detectionCount;
-  doc["ts"] = millis();
+  size_t write(const uint8_t* data, size_t size) override {
+    if (failed_) {
+      return 0;
+    }
+    failed_ = mqtt.write(data, size) != size;
+    written_ += size;
+    return failed_ ? 0 : size;
+  }
   
-  JsonObject configObj = doc.createNestedObject("config");
-  configObj["detectionEnabled"] = config.detectionEnabled;
-  configObj["cooldown"] = config.cooldownPeriod;
-  configObj["firmware"] = config.firmwareVersion;
+  bool failed() const { return failed_; }
+  size_t written() const { return written_; }
   
-  JsonObject system = doc.createNestedObject("system");
-  system["rssi"] = WiFi.RSSI();
-  system["freeHeap"] = ESP.getFreeHeap();
-  system["uptime"] = millis() / 1000;
-  system["cpuFreq"] = ESP.getCpuFreqMHz();
-  system["buffered"] = metrics.bufferedMessagesCount;
-  system["sentFromBuffer"] = metrics.sentFromBufferCount;
-  system["wifiReconnects"] = metrics.wifiReconnectCount;
-  system["mqttReconnects"] = metrics.mqttReconnectCount;
+ private:
+  size_t written_ = 0;
+  bool failed_ = false;
+};
+
+void notePublishCycles(uint32_t startCycles) {
+  uint32_t cycles = ESP.getCycleCount() - startCycles;
+  metrics.publishCyclesSum += cycles;
+  metrics.publishCount++;
+  if (cycles > metrics.maxPublishCycles) {
+    metrics.maxPublishCycles = cycles;
+  }
+}
+
+// En-tête PUBLISH ; QoS 1 si sendInflight() a posé un identifiant de paquet
+bool beginMqttPublish(const char* topic, size_t length) {
+  uint16_t packetId = publishPacketId;
+  bool dup = publishDup;
+  publishPacketId = 0;
+  publishDup = false;
+  return mqtt.beginPublish(topic, length, false, packetId, dup);
+}
+
+// Paquet tronqué : le flux MQTT est désynchronisé, on coupe la connexion
+bool endStreamedPublish(bool complete, uint32_t startCycles) {
+  if (!complete) {
+    DEBUG_PRINTLN("[MQTT] ❌ Publication interrompue, connexion fermée");
+    tlsClient.stop();
+    return false;
+  }
+  bool ok = mqtt.endPublish() > 0;
+  notePublishCycles(startCycles);
+  return ok;
+}
+
+// Publication en flux : longueur mesurée d'avance, document écrit directement dans le client
+bool publishDocument(const char* topic, const JsonDocument& doc, PayloadEncoding encoding) {
+  uint32_t startCycles = ESP.getCycleCount();
+  bool msgpack = encoding == ENCODING_MSGPACK;
+  size_t length = msgpack ? measureMsgPack(doc) : measureJson(doc);
+  if (!beginMqttPublish(topic, length)) {
+    return false;
+  }
+  MqttPayloadStream stream;
+  if (msgpack) {
+    serializeMsgPack(doc, stream);
+  } else {
+    serializeJson(doc, stream);
+  }
+  return endStreamedPublish(!stream.failed() && stream.written() == length, startCycles);
+}
+
+bool publishJson(const char* topic, const JsonDocument& doc) {
+  return publishDocument(topic, doc, ENCODING_JSON);
+}
+
+// Télémétrie (détections, sessions, statut) dans l'encodage choisi par le Device Twin
+bool publishTelemetry(const JsonDocument& doc) {
+  return publishDocument(telemetryTopic, doc, config.encoding);
+}
+
+// JSON déjà rendu ; `suffix` remplace le dernier caractère s'il est fourni
+bool publishRaw(const char* topic, const uint8_t* data, size_t length,
+                const char* suffix = NULL, size_t suffixLength = 0) {
+  uint32_t startCycles = ESP.getCycleCount();
+  size_t body = suffix ? length - 1 : length;
+  if (!beginMqttPublish(topic, body + suffixLength)) {
+    return false;
+  }
+  bool complete = mqtt.write(data, body) == body &&
+                  (!suffix || mqtt.write((const uint8_t*)suffix, suffixLength) == suffixLength);
+  return endStreamedPublish(complete, startCycles);
+}
+
+// Fin d'objet JSON portant le numéro de séquence : ,"seq":N}
+size_t formatSeqSuffix(uint64_t seq, char* out) {
+  static const char KEY[] = ",\"seq\":";
+  char digits[20];
+  size_t count = 0;
+  do {
+    digits[count++] = (char)('0' + seq % 10);
+    seq /= 10;
+  } while (seq > 0);
   
-  String payload;
-  serializeJson(doc, payload);
+  memcpy(out, KEY, sizeof(KEY) - 1);
+  size_t pos = sizeof(KEY) - 1;
+  while (count > 0) {
+    out[pos++] = digits[--count];
+  }
+  out[pos++] = '}';
+  return pos;
+}
+
+// Publie un enregistrement de l'outbox : rendu à la volée dans l'encodage courant si binaire.
+// `statusSeq` (QoS 1) garde le numéro d'un statut pour sa republication.
+PublishResult publishRecord(uint8_t type, const uint8_t* data, size_t length, uint64_t* statusSeq) {
+  if (type == RECORD_STATUS) {
+    if (length < 2 || data[length - 1] != '}') {
+      DEBUG_PRINTLN("[BUFFER] ⚠️ Statut tronqué, ignoré");
+      metrics.unreadableRecords++;
+      return PUBLISH_DROPPED;
+    }
+    // Numéroté à l'envoi : les statuts remplacés ne laissent pas de trou
+    uint64_t seq = statusSeq != NULL && *statusSeq != 0 ? *statusSeq : sequence.next();
+    char suffix[32];
+    size_t suffixLength = formatSeqSuffix(seq, suffix);
+    bool ok = publishRaw(outboxTopicName(type), data, length, suffix, suffixLength);
+    if (statusSeq != NULL) {
+      *statusSeq = seq;
+    } else if (!ok) {
+      sequence.release(seq);
+    }
+    return ok ? PUBLISH_SENT : PUBLISH_FAILED;
+  }
+  if (recordIsJson(type) || type == RECORD_MSGPACK) {
+    return publishRaw(outboxTopicName(type), data, length) ? PUBLISH_SENT : PUBLISH_FAILED;
+  }
   
+  StaticJsonDocument<RECORD_DOC_SIZE> doc;
+  if (!buildRecordJson(type, data, length, doc)) {
+    // Enregistrement illisible : on le retire plutôt que de bloquer la file
+    DEBUG_PRINTF("[BUFFER] ⚠️ Enregistrement type %u illisible, ignoré\n", type);
+    metrics.unreadableRecords++;
+    return PUBLISH_DROPPED;
+  }
+  return publishTelemetry(doc) ? PUBLISH_SENT : PUBLISH_FAILED;
+}
+
+// Met en file un document déjà construit (statut, Device Twin reported).
+// Ces files sont en RAM : le tampon a la taille de leur plus grand message
+void bufferJson(OutboxRecordType type, const JsonDocument& doc) {
+  static char payload[OUTBOX_STATE_PAYLOAD_SIZE];
+  uint8_t lane = laneForType(type);
+  size_t length = measureJson(doc);
+  if (length > laneRings[lane]->payloadCapacity() || length >= sizeof(payload)) {
+    DEBUG_PRINTF("[BUFFER] ❌ Document trop grand (%u octets), ignoré\n", (unsigned)length);
+    laneOversized[lane]++;
+    return;
+  }
+  length = serializeJson(doc, payload, sizeof(payload));
+  addToBuffer(type, payload, length);
+}
+
+// Publie tout de suite si connecté, sinon garde l'enregistrement en buffer
+// Renvoie true si l'enregistrement est parti, false s'il a été mis en buffer
+// (en QoS 1, un envoi échoué reste dans la fenêtre et repart à la reconnexion)
+bool publishOrBuffer(OutboxRecordType type, const void* record, size_t length) {
   if(connectionState != FULLY_CONNECTED) {
     DEBUG_PRINTLN("[MQTT] Déconnecté, ajout au buffer");
-    addToBuffer(topic, payload);
+    addToBuffer(type, record, length);
+    return false;
+  }
+  
+  bool tracked = config.inflightWindow > 0;
+  if (tracked && !trackPublish(type, (const uint8_t*)record, length, INFLIGHT_DIRECT)) {
+    DEBUG_PRINTLN("[MQTT] Fenêtre QoS 1 pleine, ajout au buffer");
+    addToBuffer(type, record, length);
+    return false;
+  }
+  // Événement en direct : envoyé sans attendre MQTT_WRITE_FLUSH_DELAY, avec
+  // ce qui était déjà regroupé ; un échec d'écriture est vu tout de suite
+  PublishResult result = tracked ? sendInflight(inflight.size() - 1, false)
+                                 : publishRecord(type, (const uint8_t*)record, length);
+  if (result == PUBLISH_DROPPED) {
+    // Rien n'est parti ni mis en buffer ; l'entrée QoS 1 est déjà acquittée
+    releaseAcked();
+    return false;
+  }
+  bool ok = result == PUBLISH_SENT && mqtt.flushWrites();
+  
+  if (ok) {
+    DEBUG_PRINTF("[MQTT] Publish ✅ OK (type %u)\n", type);
+  } else if (tracked) {
+    DEBUG_PRINTLN("[MQTT] ❌ Publish échoué, republié à la reconnexion");
+    metrics.failedPublishCount++;
   } else {
-    bool ok = mqtt.publish(topic.c_str(), payload.c_str());
+    DEBUG_PRINTLN("[MQTT] ❌ Publish échoué, ajout au buffer");
+    metrics.failedPublishCount++;
+    addToBuffer(type, record, length);
+  }
+  return ok;
+}
+
+// ============================================
+// FONCTIONS QOS 1 (FENÊTRE DE PUBLICATIONS)
+// ============================================
+
+// Identifiant libre : le compteur de PubSubClient repart de 1 à chaque connexion
+uint16_t nextInflightId() {
+  uint16_t packetId;
+  do {
+    packetId = mqtt.nextPacketId();
+  } while (inflight.contains(packetId));
+  return packetId;
+}
+
+// Copie un message dans la fenêtre, avant de le retirer de sa file ; NULL si elle est pleine
+PublishWindow::Entry* trackPublish(uint8_t type, const uint8_t* data, size_t length, uint8_t source,
+                                   uint64_t seq) {
+  InflightTag tag;
+  tag.source = source;
+  tag.seq = seq;
+  tag.position = source < LANE_COUNT && laneOnFlash(source) ? laneLogs[source]->position() : LogPosition();
+  return inflight.add(nextInflightId(), type, data, length, tag);
+}
+
+// Envoie (ou republie avec DUP) le message `index` de la fenêtre
+PublishResult sendInflight(size_t index, bool dup) {
+  PublishWindow::Entry& entry = inflight[index];
+  size_t length;
+  const uint8_t* payload = inflight.payload(index, length);
+  publishPacketId = entry.packetId;
+  publishDup = dup;
+  PublishResult result = publishRecord(entry.type, payload, length, &entry.tag.seq);
+  if (result == PUBLISH_DROPPED) {
+    // Enregistrement illisible, rien n'est parti : pas de PUBACK à attendre
+    entry.acked = true;
+  }
+  publishPacketId = 0;
+  publishDup = false;
+  entry.sent = result != PUBLISH_FAILED;
+  entry.sentMs = millis();
+  return result;
+}
+
+// Libère, dans l'ordre d'envoi, les messages acquittés en tête de fenêtre
+void releaseAcked() {
+  while (inflight.frontAcked()) {
+    const InflightTag& tag = inflight.front().tag;
+    if (tag.source < LANE_COUNT && laneOnFlash(tag.source)) {
+      // Marques en flash groupées, comme en QoS 0
+      laneAcked[tag.source] = tag.position;
+      laneAckPending[tag.source] = true;
+      if (++outboxUncommitted >= OUTBOX_COMMIT_EVERY) {
+        commitOutbox();
+      }
+    } else if (tag.source == INFLIGHT_RTC) {
+      noteWakePublish();
+      if (!rtcState.events.empty() && rtcState.events.front().seq == tag.seq) {
+        rtcState.events.pop();
+      }
+    }
+    inflight.pop();
+  }
+}
+
+void onPubAck(uint16_t packetId) {
+  PublishWindow::Entry* entry = inflight.ack(packetId);
+  if (entry == NULL) {
+    DEBUG_PRINTF("[MQTT] ⚠️ PUBACK inattendu (id %u)\n", packetId);
+    return;
+  }
+  metrics.ackSumMs += millis() - entry->sentMs;
+  metrics.ackSamples++;
+  releaseAcked();
+}
+
+// Reconnexion : republie dans l'ordre, avec DUP, tout ce qui attend son PUBACK
+void resendInflight() {
+  size_t resent = 0;
+  for (size_t i = 0; i < inflight.size(); i++) {
+    if (inflight[i].acked) {
+      continue;
+    }
+    PublishResult result = sendInflight(i, true);
+    if (result == PUBLISH_FAILED) {
+      DEBUG_PRINTLN("[MQTT] ❌ Republication QoS 1 interrompue");
+      break;
+    }
+    if (result == PUBLISH_SENT) {
+      resent++;
+    }
+  }
+  releaseAcked();
+  if (resent > 0) {
+    DEBUG_PRINTF("[MQTT] 🔁 %u messages QoS 1 republiés (DUP)\n", (unsigned)resent);
+  }
+}
+
+// Sans PUBACK, MQTT ne permet de republier qu'après une reconnexion
+void checkInflightTimeout() {
+  uint32_t sentMs;
+  if (connectionState == FULLY_CONNECTED && inflight.oldestUnacked(sentMs) &&
+      millis() - sentMs > INFLIGHT_ACK_TIMEOUT) {
+    DEBUG_PRINTLN("[MQTT] ❌ PUBACK non reçu, connexion fermée");
+    metrics.failedPublishCount++;
+    tlsClient.stop();
+  }
+}
+
+// Détection ou en-tête de lot : rien n'est lu du driver WiFi ni de l'allocateur
+MotionRecord captureMotionRecord(uint8_t sensor, uint32_t timestampMs) {
+  MotionRecord record;
+  record.seq = sequence.next();
+  record.timestampMs = timestampMs;
+  record.sensor = sensor;
+  return record;
+}
+
+// Construit le document d'un enregistrement binaire ; false s'il est illisible
+bool buildRecordJson(uint8_t type, const uint8_t* data, size_t length, JsonDocument& doc) {
+  switch (type) {
+    case RECORD_MOTION: {
+      MotionRecord record;
+      if (!decodeMotionRecord(type, data, length, record)) {
+        return false;
+      }
+      MotionMessage message;
+      message.seq = record.seq;
+      message.ts = record.timestampMs;
+      message.sensor = record.sensor;
+      return encodeMessage(message, doc);
+    }
     
-    if (ok) {
-      DEBUG_PRINTF("[MQTT] Publish ✅ OK : %s\n", payload.c_str());
-      
-      if (!messageBuffer.empty()) {
-        sendBufferedMessages();
+    // Plusieurs détections dans un seul message : [ts, sensor] par détection
+    case RECORD_MOTION_BATCH: {
+      BatchRecordView batch;
+      if (!decodeBatchRecord(type, data, length, batch) || batch.entries > MOTION_BATCH_MESSAGE_DETECTIONS_MAX) {
+        return false;
       }
-    } else {
-      DEBUG_PRINTLN("[MQTT] ❌ Publish échoué, ajout au buffer");
-      metrics.failedPublishCount++;
-      addToBuffer(topic, payload);
+      MotionBatchMessage message;
+      message.seq = batch.header.seq;
+      message.ts = batch.header.timestampMs;
+      for (size_t i = 0; i < batch.entries; i++) {
+        PackedBatchEntry entry = readBatchEntry(data, i);
+        message.detections[i].ts = entry.timestampMs;
+        message.detections[i].sensor = entry.sensor;
+      }
+      message.detectionsCount = batch.entries;
+      return encodeMessage(message, doc);
+    }
+    
+    case RECORD_SESSION: {
+      SessionRecord record;
+      if (!decodeSessionRecord(type, data, length, record)) {
+        return false;
+      }
+      SessionMessage message;
+      message.seq = record.seq;
+      message.hasStart = record.startEpoch != 0;
+      message.start = record.startEpoch;
+      message.startMs = record.startMs;
+      message.dwell = record.dwellMs;
+      message.detections = record.detections;
+      message.retriggers = record.retriggers;
+      message.sensors = record.sensorMask;
+      message.partial = record.partial != 0;
+      message.hasPartial = message.partial;
+      return encodeMessage(message, doc);
+    }
+    
+    default:
+      return false;
+  }
+}
+
+void publishDetectionJson(uint8_t sensor, uint64_t timestampUs) {
+  MotionRecord record = captureMotionRecord(sensor, (uint32_t)(timestampUs / 1000));
+  if (publishOrBuffer(RECORD_MOTION, &record, sizeof(record))) {
+    uint32_t latencyUs = (uint32_t)((uint64_t)esp_timer_get_time() - timestampUs);
+    metrics.detectionPublishSumUs += latencyUs;
+    metrics.detectionPublishSamples++;
+    if (latencyUs > metrics.maxDetectionPublishUs) {
+      metrics.maxDetectionPublishUs = latencyUs;
+    }
+  }
+}
+
+// Plusieurs détections dans un seul enregistrement
+void publishMotionBatch() {
+  if (motionBatch.empty()) {
+    return;
+  }
+  
+  uint8_t record[batchRecordSize(MOTION_BATCH_CAPACITY)];
+  MotionRecord header = captureMotionRecord(0, (uint32_t)millis());
+  memcpy(record, &header, sizeof(header));
+  for (size_t i = 0; i < motionBatch.size(); i++) {
+    PackedBatchEntry entry;
+    entry.timestampMs = motionBatch[i].timestampMs;
+    entry.sensor = motionBatch[i].sensor;
+    memcpy(record + batchRecordSize(i), &entry, sizeof(entry));
+  }
+  
+  size_t length = batchRecordSize(motionBatch.size());
+  DEBUG_PRINTF("[BATCH] 📦 Lot de %u détections (%u octets)\n",
+               (unsigned)motionBatch.size(), (unsigned)length);
+  motionBatch.clear();
+  
+  publishOrBuffer(RECORD_MOTION_BATCH, record, length);
+}
+
+// Une session d'occupation terminée : un seul message compact
+void publishSessionJson(const OccupancySession& session) {
+  uint64_t nowUs = (uint64_t)esp_timer_get_time();
+  time_t now;
+  time(&now);
+  
+  SessionRecord record;
+  record.seq = sequence.next();
+  record.startEpoch = now > 1700000000
+                          ? (uint32_t)(now - (time_t)((nowUs - session.startUs) / 1000000ULL)) : 0;
+  record.startMs = (uint32_t)(session.startUs / 1000);
+  record.dwellMs = session.dwellMs();
+  record.detections = saturate16(session.detections);
+  record.retriggers = saturate16(session.retriggers);
+  record.sensorMask = session.sensorMask;
+  record.partial = session.partial ? 1 : 0;
+  
+  publishOrBuffer(RECORD_SESSION, &record, sizeof(record));
+}
+
+// Relevé en tâche de fond de l'état du système, résumé dans le statut
+void sampleHealth() {
+  health.addHeap(ESP.getFreeHeap());
+  if (WiFi.status() == WL_CONNECTED) {
+    health.addRssi((int8_t)WiFi.RSSI());
+  }
+}
+
+// Le statut sert de rapport de santé : état du système sur la fenêtre écoulée.
+// Entre deux statuts complets, seuls les champs modifiés sont publiés.
+// QoS 0 : publié directement dans l'encodage courant
+bool publishStatusNow(JsonDocument& message) {
+  uint64_t seq = sequence.next();
+  message["seq"] = seq;
+  bool ok = publishTelemetry(message);
+  message.remove("seq");
+  if (!ok) {
+    sequence.release(seq);
+  }
+  return ok;
+}
+
+// QoS 1 : rendu dans la fenêtre (JSON : seq ajouté à l'envoi, comme depuis l'outbox).
+// true si le statut y est entré : un envoi échoué repart à la reconnexion
+bool publishStatusTracked(JsonDocument& message) {
+  static uint8_t payload[OUTBOX_STATE_PAYLOAD_SIZE];
+  PublishWindow::Entry* entry;
+  if (config.encoding == ENCODING_MSGPACK) {
+    uint64_t seq = sequence.next();
+    message["seq"] = seq;
+    size_t length = measureMsgPack(message);
+    entry = length <= sizeof(payload)
+                ? trackPublish(RECORD_MSGPACK, payload, serializeMsgPack(message, payload, sizeof(payload)),
+                               INFLIGHT_DIRECT, seq)
+                : NULL;
+    message.remove("seq");
+    if (entry == NULL) {
+      sequence.release(seq);
     }
+  } else {
+    message.remove("seq");             // Ajouté à l'envoi par publishRecord
+    size_t length = measureJson(message);
+    entry = length < sizeof(payload)
+                ? trackPublish(RECORD_STATUS, payload, serializeJson(message, (char*)payload, sizeof(payload)),
+                               INFLIGHT_DIRECT)
+                : NULL;
   }
+  if (entry == NULL) {
+    DEBUG_PRINTLN("[STATUS] Fenêtre QoS 1 pleine");
+    return false;
+  }
+  if (sendInflight(inflight.size() - 1, false) == PUBLISH_FAILED || !mqtt.flushWrites()) {
+    DEBUG_PRINTLN("[STATUS] ❌ Publish échoué, republié à la reconnexion");
+    metrics.failedPublishCount++;
+  }
+  return true;
 }
 
-void publishStatus() {
-  String topic = "devices/" + String(IOTHUB_DEVICE_ID) + "/messages/events/";
+void publishStatus(bool full) {
+  sampleHealth();
+  
+  StatusMessage status;
+  status.firmware = config.firmwareVersion.c_str();
+  status.uptime = millis() / 1000;
+  status.detectionEnabled = config.detectionEnabled;
+  status.cooldown = config.cooldownPeriod;
+  status.detectionCount = metrics.detectionCount;
+  status.sessionCount = metrics.sessionCount;
+  status.occupied = occupancy.isOpen();
+  status.powerMode = powerModeName(activePowerMode);
   
-  StaticJsonDocument<512> doc;
+  StatusSystem& system = status.system;
+  system.rssi = health.rssiLast();
+  system.hasRssiMin = system.hasRssiMax = system.hasRssiAvg = health.hasRssi();
+  system.rssiMin = health.rssiMin();
+  system.rssiMax = health.rssiMax();
+  system.rssiAvg = health.rssiAvg();
+  system.freeHeap = health.heapLast();
+  system.minFreeHeap = health.heapMin();
+  system.cpuFreq = ESP.getCpuFreqMHz();
+  system.buffered = outboxPending();
+  system.bufferDropped = outboxDropped();
+  system.wifiReconnects = metrics.wifiReconnectCount;
+  system.mqttReconnects = metrics.mqttReconnectCount;
+  system.failedPublishes = metrics.failedPublishCount;
+  system.unreadableRecords = metrics.unreadableRecords;
+  system.pirEdgesDropped = pirEdgeQueue.dropped();
+  system.seqNvsWrites = sequence.writes();
+  if (metrics.publishCount > 0) {
+    system.hasAvgPublishCycles = system.hasMaxPublishCycles = true;
+    system.avgPublishCycles = (uint32_t)(metrics.publishCyclesSum / metrics.publishCount);
+    system.maxPublishCycles = metrics.maxPublishCycles;
+    system.hasTlsWritesPerPublish = true;
+    system.tlsWritesPerPublish = (float)metrics.tlsWrites / (float)metrics.publishCount;
+  }
   
-  doc["event"] = "status";
-  doc["firmware"] = config.firmwareVersion;
-  doc["uptime"] = millis() / 1000;
-  doc["detectionEnabled"] = config.detectionEnabled;
-  doc["cooldown"] = config.cooldownPeriod;
-  doc["detectionCount"] = metrics.detectionCount;
+  unsigned long now = millis();
+  unsigned long elapsed = now - metrics.lastStatusTime;
+  system.wakeupsPerSec = elapsed > 0 ? (float)metrics.loopWakeups * 1000.0f / (float)elapsed : 0.0f;
+  system.maxWakeLatencyUs = metrics.maxWakeLatencyUs;
+  system.avgWakeLatencyUs = metrics.wakeLatencySamples > 0
+                                ? metrics.wakeLatencySumUs / metrics.wakeLatencySamples : 0;
+  if (metrics.detectionPublishSamples > 0) {
+    system.hasAvgDetectionPublishUs = system.hasMaxDetectionPublishUs = true;
+    system.avgDetectionPublishUs = metrics.detectionPublishSumUs / metrics.detectionPublishSamples;
+    system.maxDetectionPublishUs = metrics.maxDetectionPublishUs;
+  }
+  if (metrics.drainedMessages > 0) {
+    system.hasDrainRate = system.hasMaxPirGapUs = true;
+    system.drainRate = metrics.drainTimeMs > 0
+                           ? (float)metrics.drainedMessages * 1000.0f / (float)metrics.drainTimeMs : 0.0f;
+    system.maxPirGapUs = metrics.maxPirGapUs;
+  }
+  if (metrics.maxConnectGapUs > 0) {
+    system.hasMaxConnectGapUs = true;
+    system.maxConnectGapUs = metrics.maxConnectGapUs;
+  }
+  system.hasListenInterval = radioSleepEnabled();
+  system.listenInterval = appliedListenInterval;
+  if (config.powerMode == POWER_DEEP_SLEEP) {
+    system.hasSleepWakes = system.hasWakeToPublishMs = system.hasWakeEventsDropped = true;
+    system.sleepWakes = rtcState.wakeCount;
+    system.wakeToPublishMs = rtcState.lastWakeToPublishMs;
+    system.wakeEventsDropped = rtcState.events.dropped;
+  }
+  if (config.inflightWindow > 0 || !inflight.empty()) {
+    system.hasInflight = true;
+    system.inflight = inflight.size();
+  }
+  if (metrics.ackSamples > 0) {
+    system.hasAvgAckMs = true;
+    system.avgAckMs = metrics.ackSumMs / metrics.ackSamples;
+  }
+  
+  // Occupation et pertes par file : [en attente, perdus]
+  LaneCounts* lanes[LANE_COUNT] = {&system.lanes.twin, &system.lanes.session, &system.lanes.health,
+                                   &system.lanes.motion};
+  for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+    lanes[lane]->pending = lanePending(lane);
+    lanes[lane]->dropped = laneDropped(lane);
+  }
+  if (motionLog.mounted()) {
+    uint64_t payloadBytes = motionLog.payloadBytes() + sessionLog.payloadBytes();
+    system.hasOutbox = true;
+    system.outbox.segments = motionLog.segmentCount() + sessionLog.segmentCount();
+    system.outbox.erases = motionLog.erases() + sessionLog.erases();
+    system.outbox.corrupt = motionLog.corrupt() + sessionLog.corrupt();
+    system.outbox.writeAmp = payloadBytes > 0
+                                 ? (float)(motionLog.flashBytes() + sessionLog.flashBytes()) / (float)payloadBytes
+                                 : 0.0f;
+  }
   
-  JsonObject system = doc.createNestedObject("system");
-  system["rssi"] = WiFi.RSSI();
-  system["freeHeap"] = ESP.getFreeHeap();
-  system["buffered"] = messageBuffer.size();
-  system["wifiReconnects"] = metrics.wifiReconnectCount;
-  system["mqttReconnects"] = metrics.mqttReconnectCount;
-  system["failedPublishes"] = metrics.failedPublishCount;
+  // Statiques : ~3 Ko, hors de la pile de loop() et du callback MQTT
+  static StaticJsonDocument<STATUS_MESSAGE_DOC_SIZE> doc;
+  if (!encodeMessage(status, doc)) {
+    DEBUG_PRINTLN("[STATUS] ❌ Document trop petit, statut non envoyé");
+    return;
+  }
   
-  String payload;
-  serializeJson(doc, payload);
+  // Delta par rapport au dernier statut publié ; complet s'il déborde
+  full = full || statusShadow.isNull() || statusDeltaCount >= STATUS_FULL_EVERY;
+  static StaticJsonDocument<512> patch;
+  if (!full) {
+    reportDelta.diff(doc.as<JsonObjectConst>(), statusShadow.as<JsonObjectConst>(), patch.to<JsonObject>());
+    patch["event"] = "status";
+    patch["delta"] = true;
+    patch["seq"] = 0;                  // Place réservée avant le contrôle de taille
+    full = patch.overflowed();
+  }
+  JsonDocument& message = full ? (JsonDocument&)doc : (JsonDocument&)patch;
   
+  // Hors connexion, seul le dernier statut complet est gardé (numéroté à l'envoi).
+  // En QoS 1, un delta perdu fausserait l'état vu par le backend : il passe
+  // par la fenêtre, comme la télémétrie
+  bool ok = false;
   if (connectionState == FULLY_CONNECTED) {
-    bool ok = mqtt.publish(topic.c_str(), payload.c_str());
-    DEBUG_PRINTF("[STATUS] Publish %s\n", ok ? "✅ OK" : "❌ FAIL");
+    ok = config.inflightWindow > 0 ? publishStatusTracked(message) : publishStatusNow(message);
+  }
+  if (!ok) {
+    DEBUG_PRINTLN("[STATUS] Non envoyé, gardé en buffer");
+    bufferJson(RECORD_STATUS, doc);
+    return;
+  }
+  DEBUG_PRINTF("[STATUS] Publish ✅ OK (%s)\n", full ? "complet" : "delta");
+  discardLane(LANE_HEALTH);
+  if (full) {
+    statusDeltaCount = 0;
+  } else {
+    JsonDelta::settle(doc.as<JsonObject>(), statusShadow.as<JsonObjectConst>(), patch.as<JsonObjectConst>());
+    statusDeltaCount++;
   }
+  statusShadow.set(doc);
+  metrics.loopWakeups = 0;
+  metrics.maxWakeLatencyUs = 0;
+  metrics.wakeLatencySumUs = 0;
+  metrics.wakeLatencySamples = 0;
+  metrics.drainedMessages = 0;
+  metrics.drainTimeMs = 0;
+  metrics.maxPirGapUs = 0;
+  metrics.maxConnectGapUs = 0;
+  metrics.publishCyclesSum = 0;
+  metrics.publishCount = 0;
+  metrics.tlsWrites = 0;
+  metrics.maxPublishCycles = 0;
+  metrics.detectionPublishSumUs = 0;
+  metrics.detectionPublishSamples = 0;
+  metrics.maxDetectionPublishUs = 0;
+  metrics.ackSumMs = 0;
+  metrics.ackSamples = 0;
+  health.reset();
+  metrics.lastStatusTime = now;
 }
 
 void publishTwinReported() {
-  String topic = "$iothub/twin/PATCH/properties/reported/?$rid=" + String(twinRequestId++);
+  TwinReportedMessage reported;
+  reported.firmware = config.firmwareVersion.c_str();
+  reported.uptime = millis() / 1000;
+  reported.detectionEnabled = config.detectionEnabled;
+  reported.cooldown = config.cooldownPeriod;
+  reported.minPulse = config.minPulseWidth;
+  reported.mergeWindow = config.retriggerMerge;
+  reported.riseHold = config.riseHold;
+  reported.fallHold = config.fallHold;
+  reported.sessionMode = config.sessionMode;
+  reported.idleTimeout = config.idleTimeout;
+  reported.adaptiveCooldown = config.adaptiveCooldown;
+  reported.maxMessagesPerHour = config.maxMessagesPerHour;
+  reported.effectiveCooldown = effectiveCooldown();
+  reported.batchWindow = config.batchWindow;
+  reported.powerMode = powerModeName(config.powerMode);
+  reported.c2dLatency = config.c2dLatency;
+  reported.encoding = encodingName(config.encoding);
+  reported.inflightWindow = config.inflightWindow;
+  reported.detectionCount = metrics.detectionCount;
   
-  StaticJsonDocument<512> doc;
-  doc["firmware"] = config.firmwareVersion;
-  doc["uptime"] = millis() / 1000;
-  doc["detectionEnabled"] = config.detectionEnabled;
-  doc["cooldown"] = config.cooldownPeriod;
-  doc["detectionCount"] = metrics.detectionCount;
+  reported.interArrival.ewma = (uint32_t)adaptiveCooldown.ewmaIntervalMs();
+  reported.interArrival.p50 = (uint32_t)adaptiveCooldown.p50IntervalMs();
+  reported.interArrival.p90 = (uint32_t)adaptiveCooldown.p90IntervalMs();
+  reported.interArrival.samples = adaptiveCooldown.samples();
   
-  JsonObject system = doc.createNestedObject("system");
-  system["rssi"] = WiFi.RSSI();
-  system["freeHeap"] = ESP.getFreeHeap();
-  system["cpuFreq"] = ESP.getCpuFreqMHz();
-  system["buffered"] = messageBuffer.size();
+  reported.system.rssi = WiFi.RSSI();
+  reported.system.freeHeap = ESP.getFreeHeap();
+  reported.system.cpuFreq = ESP.getCpuFreqMHz();
+  reported.system.buffered = outboxPending();
   
-  String payload;
-  serializeJson(doc, payload);
+  static StaticJsonDocument<TWIN_REPORTED_MESSAGE_DOC_SIZE> doc;
+  if (!encodeMessage(reported, doc)) {
+    DEBUG_PRINTLN("[TWIN] ❌ Document trop petit, reported non envoyé");
+    return;
+  }
   
-  if (connectionState == FULLY_CONNECTED) {
-    bool ok = mqtt.publish(topic.c_str(), payload.c_str());
-    DEBUG_PRINTF("[TWIN] Reported %s\n", ok ? "✅ OK" : "❌ FAIL");
+  // Patch des propriétés qui diffèrent de l'état confirmé par IoT Hub : un
+  // patch sans réponse (perdu, connexion coupée) est simplement inclus au suivant
+  unsigned long now = millis();
+  bool full = twinShadow.isNull() || now - lastFullTwinTime >= TWIN_FULL_REPORT_INTERVAL;
+  static StaticJsonDocument<TWIN_REPORTED_MESSAGE_DOC_SIZE> patch;
+  if (!full && connectionState == FULLY_CONNECTED) {
+    if (reportDelta.diff(doc.as<JsonObjectConst>(), twinShadow.as<JsonObjectConst>(), patch.to<JsonObject>()) == 0) {
+      DEBUG_PRINTLN("[TWIN] Reported inchangé, rien à envoyer");
+      return;
+    }
+    full = patch.overflowed();
+  }
+  
+  // Hors connexion, seul le dernier état complet est gardé
+  bool ok = connectionState == FULLY_CONNECTED &&
+            publishJson(outboxTopicName(RECORD_TWIN_REPORTED), full ? (JsonDocument&)doc : (JsonDocument&)patch);
+  DEBUG_PRINTF("[TWIN] Reported %s %s\n", full ? "complet" : "delta", ok ? "✅ OK" : "❌ gardé en buffer");
+  if (!ok) {
+    // Le reported complet repart de l'outbox : sa réponse ne confirme rien de connu ici
+    twinShadow.clear();
+    twinSent.clear();
+    twinAwaitingAck = false;
+    bufferJson(RECORD_TWIN_REPORTED, doc);
+    return;
+  }
+  discardLane(LANE_TWIN);
+  if (full) {
+    lastFullTwinTime = now;
+  } else {
+    JsonDelta::settle(doc.as<JsonObject>(), twinShadow.as<JsonObjectConst>(), patch.as<JsonObjectConst>());
+  }
+  twinSent.set(doc);
+  twinAwaitingAck = true;
+}
+
+// Réponse d'IoT Hub au dernier patch reported : l'état envoyé devient la
+// shadow, ou la shadow est oubliée en cas de refus (prochain envoi complet)
+void onTwinReportedResponse(int status) {
+  twinAwaitingAck = false;
+  if (status < 200 || status >= 300) {
+    DEBUG_PRINTF("[TWIN] ❌ Reported refusé (%d), prochain envoi complet\n", status);
+    twinShadow.clear();
+  } else if (!twinSent.isNull()) {
+    twinShadow.set(twinSent);
   }
+  twinSent.clear();
 }
 
 void requestTwinGet() {
-  String topic = "$iothub/twin/GET/?$rid=" + String(twinRequestId++);
+  char topic[48];
+  snprintf(topic, sizeof(topic), "$iothub/twin/GET/?$rid=%d", twinRequestId++);
   
   if (connectionState == FULLY_CONNECTED) {
-    bool ok = mqtt.publish(topic.c_str(), "");
+    bool ok = mqtt.publish(topic, "");
     DEBUG_PRINTF("[TWIN] GET request %s\n", ok ? "✅ OK" : "❌ FAIL");
   }
 }
@@ -415,15 +2129,17 @@ void requestTwinGet() {
 // FONCTIONS DEVICE TWIN
 // ============================================
 
-void handleTwinDesired(const JsonObject& doc) {
+// Les chaînes de `desired` pointent dans le payload MQTT : elles sont lues
+// avant publishTwinReported(), qui réutilise le buffer de PubSubClient
+void handleTwinDesired(const TwinDesiredMessage& desired) {
   DEBUG_PRINTLN("\n╔═══════════════════════════════════════╗");
   DEBUG_PRINTLN("║  🔄 DEVICE TWIN DESIRED UPDATE       ║");
   DEBUG_PRINTLN("╚═══════════════════════════════════════╝");
   
   bool changed = false;
   
-  if (doc.containsKey("detectionEnabled")) {
-    bool newValue = doc["detectionEnabled"];
+  if (desired.hasDetectionEnabled) {
+    bool newValue = desired.detectionEnabled;
     if (newValue != config.detectionEnabled) {
       config.detectionEnabled = newValue;
       DEBUG_PRINTF("[TWIN] detectionEnabled: %s → %s\n", 
@@ -447,8 +2163,8 @@ void handleTwinDesired(const JsonObject& doc) {
     }
   }
   
-  if (doc.containsKey("cooldown")) {
-    unsigned long newValue = doc["cooldown"];
+  if (desired.hasCooldown) {
+    unsigned long newValue = desired.cooldown;
     if (newValue >= 1000 && newValue <= 60000 && newValue != config.cooldownPeriod) {
       DEBUG_PRINTF("[TWIN] cooldown: %lu ms → %lu ms\n", 
                     config.cooldownPeriod, newValue);
@@ -457,6 +2173,138 @@ void handleTwinDesired(const JsonObject& doc) {
     }
   }
   
+  if (desired.hasSessionMode) {
+    bool newValue = desired.sessionMode;
+    if (newValue != config.sessionMode) {
+      DEBUG_PRINTF("[TWIN] sessionMode: %s → %s\n", 
+                    !newValue ? "true" : "false",
+                    newValue ? "true" : "false");
+      config.sessionMode = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasIdleTimeout) {
+    unsigned long newValue = desired.idleTimeout;
+    if (newValue >= 5000 && newValue <= 3600000 && newValue != config.idleTimeout) {
+      DEBUG_PRINTF("[TWIN] idleTimeout: %lu ms → %lu ms\n", 
+                    config.idleTimeout, newValue);
+      config.idleTimeout = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasAdaptiveCooldown) {
+    bool newValue = desired.adaptiveCooldown;
+    if (newValue != config.adaptiveCooldown) {
+      DEBUG_PRINTF("[TWIN] adaptiveCooldown: %s → %s\n", 
+                    !newValue ? "true" : "false",
+                    newValue ? "true" : "false");
+      config.adaptiveCooldown = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasMaxMessagesPerHour) {
+    unsigned long newValue = desired.maxMessagesPerHour;
+    if (newValue >= 1 && newValue <= 3600 && newValue != config.maxMessagesPerHour) {
+      DEBUG_PRINTF("[TWIN] maxMessagesPerHour: %lu → %lu\n", 
+                    config.maxMessagesPerHour, newValue);
+      config.maxMessagesPerHour = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasBatchWindow) {
+    unsigned long newValue = desired.batchWindow;
+    if (newValue <= 300000 && newValue != config.batchWindow) {
+      DEBUG_PRINTF("[TWIN] batchWindow: %lu ms → %lu ms\n", 
+                    config.batchWindow, newValue);
+      config.batchWindow = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasMinPulse) {
+    unsigned long newValue = desired.minPulse;
+    if (newValue <= 10000 && newValue != config.minPulseWidth) {
+      DEBUG_PRINTF("[TWIN] minPulse: %lu ms → %lu ms\n", 
+                    config.minPulseWidth, newValue);
+      config.minPulseWidth = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasMergeWindow) {
+    unsigned long newValue = desired.mergeWindow;
+    if (newValue <= 60000 && newValue != config.retriggerMerge) {
+      DEBUG_PRINTF("[TWIN] mergeWindow: %lu ms → %lu ms\n", 
+                    config.retriggerMerge, newValue);
+      config.retriggerMerge = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasRiseHold) {
+    unsigned long newValue = desired.riseHold;
+    if (newValue <= 10000 && newValue != config.riseHold) {
+      DEBUG_PRINTF("[TWIN] riseHold: %lu ms → %lu ms\n", 
+                    config.riseHold, newValue);
+      config.riseHold = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasFallHold) {
+    unsigned long newValue = desired.fallHold;
+    if (newValue <= 10000 && newValue != config.fallHold) {
+      DEBUG_PRINTF("[TWIN] fallHold: %lu ms → %lu ms\n", 
+                    config.fallHold, newValue);
+      config.fallHold = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasPowerMode) {
+    PowerMode newValue;
+    if (parsePowerMode(desired.powerMode, newValue) && newValue != config.powerMode) {
+      DEBUG_PRINTF("[TWIN] powerMode: %s → %s\n", 
+                    powerModeName(config.powerMode), powerModeName(newValue));
+      config.powerMode = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasC2dLatency) {
+    unsigned long newValue = desired.c2dLatency;
+    if (newValue >= 100 && newValue <= MAX_C2D_LATENCY && newValue != config.c2dLatency) {
+      DEBUG_PRINTF("[TWIN] c2dLatency: %lu ms → %lu ms\n", 
+                    config.c2dLatency, newValue);
+      config.c2dLatency = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasEncoding) {
+    PayloadEncoding newValue;
+    if (parseEncoding(desired.encoding, newValue) && newValue != config.encoding) {
+      DEBUG_PRINTF("[TWIN] encoding: %s → %s\n", 
+                    encodingName(config.encoding), encodingName(newValue));
+      config.encoding = newValue;
+      changed = true;
+    }
+  }
+  
+  if (desired.hasInflightWindow) {
+    unsigned long newValue = desired.inflightWindow;
+    if (newValue <= INFLIGHT_WINDOW_MAX && newValue != config.inflightWindow) {
+      DEBUG_PRINTF("[TWIN] inflightWindow: %u → %lu\n", 
+                    config.inflightWindow, newValue);
+      config.inflightWindow = (uint8_t)newValue;
+      changed = true;
+    }
+  }
+  
   if (changed) {
     DEBUG_PRINTLN("[TWIN] ✅ Configuration mise à jour depuis Azure");
     saveConfig();
@@ -472,35 +2320,50 @@ void handleTwinDesired(const JsonObject& doc) {
 // CALLBACK MQTT
 // ============================================
 
+void buildMessageFilters() {
+  buildTwinDesiredFilter(twinDesiredFilter.to<JsonObject>());
+  buildTwinDesiredFilter(twinGetFilter.to<JsonObject>().createNestedObject("desired"));
+  buildC2dCommandFilter(c2dFilter.to<JsonObject>());
+}
+
+// Les messages sont désérialisés en place dans le buffer de PubSubClient :
+// les chaînes restent dans le payload (valide jusqu'à la fin du callback)
+// et le filtre écarte $version, metadata et reported avant toute allocation.
 void messageCallback(char* topic, byte* payload, unsigned int length) {
   String topicStr = String(topic);
-  
-  String message = "";
-  for (unsigned int i = 0; i < length; i++) {
-    message += (char)payload[i];
-  }
+  char* message = (char*)payload;
   
   // TRAITER DEVICE TWIN DESIRED
   if (topicStr.startsWith("$iothub/twin/PATCH/properties/desired/")) {
     DEBUG_PRINTLN("\n╔═══════════════════════════════════════╗");
     DEBUG_PRINTLN("║  📨 TWIN DESIRED PATCH REÇU !         ║");
     DEBUG_PRINTLN("╚═══════════════════════════════════════╝");
-    DEBUG_PRINTF("[TWIN] Payload: %s\n", message.c_str());
+    DEBUG_PRINTF("[TWIN] Payload: %.*s\n", (int)length, message);
     
-    StaticJsonDocument<512> doc;
-    DeserializationError error = deserializeJson(doc, message);
+    StaticJsonDocument<TWIN_DESIRED_MESSAGE_DOC_SIZE> doc;
+    DeserializationError error = deserializeJson(doc, message, length,
+                                                 DeserializationOption::Filter(twinDesiredFilter));
     
+    TwinDesiredMessage desired;
     if (error) {
       DEBUG_PRINTF("[TWIN] ❌ Erreur parsing JSON: %s\n", error.c_str());
-      return;
+    } else if (!decodeMessage(doc.as<JsonObjectConst>(), desired)) {
+      DEBUG_PRINTLN("[TWIN] ❌ Propriété desired de type invalide, patch ignoré");
+    } else {
+      handleTwinDesired(desired);
     }
-    
-    handleTwinDesired(doc.as<JsonObject>());
     return;
   }
   
   // TRAITER TWIN RESPONSE
   if (topicStr.startsWith("$iothub/twin/res/")) {
+    int ridStart = topicStr.indexOf("$rid=");
+    if (ridStart >= 0 && topicStr.substring(ridStart + 5).toInt() == twinReportedRid) {
+      int codeStart = topicStr.indexOf("/res/") + 5;
+      onTwinReportedResponse(topicStr.substring(codeStart, topicStr.indexOf("/", codeStart)).toInt());
+      return;
+    }
+    
     DEBUG_PRINTLN("\n╔═══════════════════════════════════════╗");
     DEBUG_PRINTLN("║  📋 TWIN GET RESPONSE REÇUE !         ║");
     DEBUG_PRINTLN("╚═══════════════════════════════════════╝");
@@ -512,17 +2375,22 @@ void messageCallback(char* topic, byte* payload, unsigned int length) {
     DEBUG_PRINTF("[TWIN] Status Code: %s\n", statusCode.c_str());
     
     if (statusCode == "200") {
-      StaticJsonDocument<1024> doc;
-      DeserializationError error = deserializeJson(doc, message);
+      StaticJsonDocument<JSON_OBJECT_SIZE(1) + TWIN_DESIRED_MESSAGE_DOC_SIZE> doc;
+      DeserializationError error = deserializeJson(doc, message, length,
+                                                   DeserializationOption::Filter(twinGetFilter));
       
-      if (!error) {
-        if (doc.containsKey("desired")) {
-          JsonObject desired = doc["desired"];
-          DEBUG_PRINTLN("[TWIN] Propriétés desired trouvées:");
-          serializeJsonPretty(desired, Serial);
-          Serial.println();
-          
+      if (error) {
+        DEBUG_PRINTF("[TWIN] ❌ Erreur parsing JSON: %s\n", error.c_str());
+      } else if (doc.containsKey("desired")) {
+        DEBUG_PRINTLN("[TWIN] Propriétés desired trouvées:");
+        serializeJsonPretty(doc["desired"], Serial);
+        Serial.println();
+        
+        TwinDesiredMessage desired;
+        if (decodeMessage(doc["desired"].as<JsonObjectConst>(), desired)) {
           handleTwinDesired(desired);
+        } else {
+          DEBUG_PRINTLN("[TWIN] ❌ Propriétés desired de type invalide, ignorées");
         }
       }
     }
@@ -537,22 +2405,23 @@ void messageCallback(char* topic, byte* payload, unsigned int length) {
     DEBUG_PRINTLN("║  📨 MESSAGE C2D REÇU DEPUIS AZURE !   ║");
     DEBUG_PRINTLN("╚═══════════════════════════════════════╝");
     
-    DEBUG_PRINTF("[C2D] Payload: %s\n", message.c_str());
+    DEBUG_PRINTF("[C2D] Payload: %.*s\n", (int)length, message);
     
-    StaticJsonDocument<256> doc;
-    DeserializationError error = deserializeJson(doc, message);
+    StaticJsonDocument<C2D_COMMAND_MESSAGE_DOC_SIZE> doc;
+    DeserializationError error = deserializeJson(doc, message, length,
+                                                 DeserializationOption::Filter(c2dFilter));
     
     if (error) {
       DEBUG_PRINTF("[C2D] ❌ Erreur parsing JSON: %s\n", error.c_str());
       return;
     }
     
-    const char* command = doc["command"];
-    
-    if (command == nullptr) {
+    C2dCommandMessage c2d;
+    if (!decodeMessage(doc.as<JsonObjectConst>(), c2d)) {
       DEBUG_PRINTLN("[C2D] ❌ Aucune commande trouvée");
       return;
     }
+    const char* command = c2d.command;
     
     DEBUG_PRINTF("[C2D] 🎯 Commande: %s\n", command);
     
@@ -580,8 +2449,8 @@ void messageCallback(char* topic, byte* payload, unsigned int length) {
       publishTwinReported();
       
     } else if (strcmp(command, "setCooldown") == 0) {
-      if (doc.containsKey("value")) {
-        unsigned long newCooldown = doc["value"];
+      if (c2d.hasValue) {
+        unsigned long newCooldown = c2d.value;
         if (newCooldown >= 1000 && newCooldown <= 60000) {
           config.cooldownPeriod = newCooldown;
           DEBUG_PRINTF("[C2D] ✅ Cooldown changé: %lu ms\n", config.cooldownPeriod);
@@ -593,7 +2462,7 @@ void messageCallback(char* topic, byte* payload, unsigned int length) {
       
     } else if (strcmp(command, "getStatus") == 0) {
       DEBUG_PRINTLN("[C2D] 📊 Envoi du statut...");
-      publishStatus();
+      publishStatus(true);
       publishTwinReported();
       
     } else if (strcmp(command, "getTwin") == 0) {
@@ -602,11 +2471,16 @@ void messageCallback(char* topic, byte* payload, unsigned int length) {
       
     } else if (strcmp(command, "reboot") == 0) {
       DEBUG_PRINTLN("[C2D] 🔄 REDÉMARRAGE dans 3 secondes...");
+      flushOutbox();
+      endOutboxDrain((uint64_t)esp_timer_get_time());
+      sequence.persist();
       delay(3000);
       ESP.restart();
       
     } else if (strcmp(command, "clearBuffer") == 0) {
-      messageBuffer.clear();
+      for (uint8_t lane = 0; lane < LANE_COUNT; lane++) {
+        discardLane(lane);
+      }
       DEBUG_PRINTLN("[C2D] ✅ Buffer vidé");
       publishStatus();
       
@@ -622,24 +2496,18 @@ void messageCallback(char* topic, byte* payload, unsigned int length) {
 // FONCTIONS CONNEXION (MACHINE À ÉTATS)
 // ============================================
 
-void connectMQTT() {
+// Exécutée par mqttConnectTask : la poignée de main TLS et l'attente du
+// CONNACK bloquent plusieurs secondes, loop() continue à traiter les PIR
+bool connectMQTT() {
   DEBUG_PRINTLN("[TLS] Configuration du certificat Azure IoT Hub...");
   tlsClient.setCACert(azure_root_ca);
+  tlsClient.setHandshakeTimeout(TLS_HANDSHAKE_TIMEOUT);
   
   mqtt.setCallback(messageCallback);
+  mqtt.setPubAckCallback(onPubAck);
+  mqtt.setWriteBuffer(MQTT_WRITE_BUFFER_SIZE, MQTT_WRITE_FLUSH_DELAY);
   mqtt.setServer(IOTHUB_HOST, 8883);
 
-  DEBUG_PRINTLN("[NTP] Synchronisation de l'heure...");
-  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-  if (!waitForTime()) {
-      DEBUG_PRINTLN("[NTP] ❌ Échec de la synchronisation.");
-      return;
-  } else {
-      time_t now;
-      time(&now);
-      DEBUG_PRINTF("[NTP] ✅ Heure synchronisée : %s", ctime(&now));
-  }
-
   String sas = buildSasToken(IOTHUB_HOST, IOTHUB_DEVICE_ID, IOTHUB_DEVICE_KEY_BASE64, 3600);
   String clientId = IOTHUB_DEVICE_ID;
   String username = String(IOTHUB_HOST) + "/" + IOTHUB_DEVICE_ID + "/?api-version=2020-09-30";
@@ -653,7 +2521,7 @@ void connectMQTT() {
   DEBUG_PRINTLN("[MQTT] Connexion à IoT Hub...");
   if (!mqtt.connect(clientId.c_str(), username.c_str(), sas.c_str())) {
     DEBUG_PRINTF("[MQTT] ❌ Échec, rc=%d\n", mqtt.state());
-    return;
+    return false;
   }
   
   DEBUG_PRINTLN("[MQTT] ✅ Connecté à IoT Hub");
@@ -670,10 +2538,66 @@ void connectMQTT() {
   if (mqtt.subscribe("$iothub/twin/res/#")) {
     DEBUG_PRINTLN("[TWIN] ✅ Abonné aux réponses twin");
   }
+  // Abonnements regroupés : envoyés avant de rendre mqtt à loop()
+  return mqtt.flushWrites();
+}
+
+// Une tentative de connexion par notification de loop()
+void mqttConnectTask(void* arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    bool ok = connectMQTT();
+    mqttConnectResult.store(ok ? MQTT_ATTEMPT_OK : MQTT_ATTEMPT_FAILED, std::memory_order_release);
+    mqttConnecting.store(false, std::memory_order_release);
+    wakeLoop();
+  }
+}
+
+void startMqttConnect() {
+  // La notification ordonne ces écritures avant le réveil de la tâche
+  mqttConnectResult.store(MQTT_ATTEMPT_PENDING, std::memory_order_relaxed);
+  mqttConnecting.store(true, std::memory_order_relaxed);
+  xTaskNotifyGive(mqttConnectTaskHandle);
+}
+
+// Clignotement LED sans bloquer loop() : 3 impulsions
+void onLedBlinkTimer() {
+  digitalWrite(LED_PIN, ledBlinkToggles % 2 == 0 ? HIGH : LOW);
+  if (++ledBlinkToggles >= 6) {
+    timers.setEnabled(ledBlinkTimer, false, millis());
+  }
+}
+
+// Connexion établie : exécuté dans loop(), les publications partent directement
+void onMqttConnected(unsigned long now) {
+  DEBUG_PRINTLN("[MQTT] ✅ État: FULLY_CONNECTED");
+  connectionState = FULLY_CONNECTED;
+  fullyConnectedAt = now;
+  
+  // Clignotement LED pour signaler la connexion complète (pas sur batterie)
+  if (config.powerMode != POWER_DEEP_SLEEP) {
+    ledBlinkToggles = 0;
+    timers.setEnabled(ledBlinkTimer, true, now);
+  }
   
-  delay(1000);
+  // Les messages en attente partent progressivement depuis loop(),
+  // après ceux de la fenêtre QoS 1 restés sans PUBACK
+  drainPaused = false;
+  resendInflight();
+  
+  // Réponse au dernier patch reported perdue avec la connexion : la shadow
+  // reste l'état confirmé, le prochain patch reprend ce qui n'a pas été acquitté
+  if (twinAwaitingAck) {
+    twinSent.clear();
+    twinAwaitingAck = false;
+  }
   
+  // Réveil sur détection : seules les détections en attente sont publiées,
+  // le statut complet part au réveil périodique
   requestTwinGet();
+  if (fastBoot && wakeCause != ESP_SLEEP_WAKEUP_TIMER) {
+    return;
+  }
   publishTwinReported();
   publishStatus();
 }
@@ -685,8 +2609,7 @@ void handleConnection() {
     case DISCONNECTED:
       if (now - lastConnectionAttempt > CONNECTION_RETRY_INTERVAL) {
         DEBUG_PRINTLN("[CONN] ⚡ Tentative de connexion WiFi...");
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+        beginWiFi();
         connectionState = CONNECTING_WIFI;
         lastConnectionAttempt = now;
       }
@@ -701,6 +2624,7 @@ void handleConnection() {
       } else if (now - lastConnectionAttempt > 20000) {
         DEBUG_PRINTLN("\n[WiFi] ❌ Timeout");
         WiFi.disconnect();
+        rtcState.wifiChannel = 0;
         connectionState = DISCONNECTED;
         metrics.wifiReconnectCount++;
       }
@@ -710,33 +2634,51 @@ void handleConnection() {
       if (WiFi.status() != WL_CONNECTED) {
         DEBUG_PRINTLN("[WiFi] ⚠️ Déconnecté");
         connectionState = DISCONNECTED;
-      } else if (!mqtt.connected()) {
+      } else if (mqttConnecting.load(std::memory_order_acquire)) {
+        // Tentative précédente pas encore terminée (coupure WiFi pendant le TLS)
+      } else if (mqtt.connected()) {
+        onMqttConnected(now);
+      } else {
+        if (!ntpStarted) {
+          DEBUG_PRINTLN("[NTP] Synchronisation de l'heure...");
+          configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+          ntpStarted = true;
+        }
+        connectionState = SYNCING_TIME;
+        lastConnectionAttempt = now;
+      }
+      break;
+      
+    case SYNCING_TIME:
+      // SNTP tourne dans la pile lwIP : l'heure est relevée à chaque tour
+      if (WiFi.status() != WL_CONNECTED) {
+        DEBUG_PRINTLN("[WiFi] ⚠️ Déconnecté");
+        connectionState = DISCONNECTED;
+      } else if (timeIsSet()) {
+        time_t t;
+        time(&t);
+        DEBUG_PRINTF("[NTP] ✅ Heure synchronisée : %s", ctime(&t));
         DEBUG_PRINTLN("[MQTT] Tentative de connexion...");
-        connectMQTT();
+        startMqttConnect();
         connectionState = CONNECTING_MQTT;
         lastConnectionAttempt = now;
+      } else if (now - lastConnectionAttempt > NTP_SYNC_TIMEOUT) {
+        DEBUG_PRINTLN("[NTP] ❌ Échec de la synchronisation.");
+        configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+        lastConnectionAttempt = now;
       }
       break;
       
     case CONNECTING_MQTT:
-      if (mqtt.connected()) {
-        DEBUG_PRINTLN("[MQTT] ✅ État: FULLY_CONNECTED");
-        connectionState = FULLY_CONNECTED;
-        
-        // Clignotement LED pour signaler la connexion complète
-        for (int i = 0; i < 3; i++) {
-          digitalWrite(LED_PIN, HIGH);
-          delay(100);
-          digitalWrite(LED_PIN, LOW);
-          delay(100);
-        }
-        
-        // Envoyer les messages en attente
-        if (!messageBuffer.empty()) {
-          sendBufferedMessages();
-        }
-      } else if (now - lastConnectionAttempt > 15000) {
-        DEBUG_PRINTLN("[MQTT] ❌ Timeout");
+      // Pas de timeout ici : la tâche rend la main au plus tard après les
+      // timeouts TLS et MQTT, et mqtt ne doit pas être touché avant
+      if (mqttConnecting.load(std::memory_order_acquire)) {
+        break;
+      }
+      if (mqttConnectResult.load(std::memory_order_acquire) == MQTT_ATTEMPT_OK && mqtt.connected()) {
+        onMqttConnected(now);
+      } else if (now - lastConnectionAttempt > MQTT_RETRY_INTERVAL) {
+        DEBUG_PRINTLN("[MQTT] Nouvelle tentative");
         connectionState = WIFI_CONNECTED;
         metrics.mqttReconnectCount++;
       }
@@ -754,22 +2696,419 @@ void handleConnection() {
   }
 }
 
+// ============================================
+// FONCTIONS RÉVEIL (BOUCLE TICKLESS)
+// ============================================
+
+void wakeLoop() {
+  if (loopTaskHandle) {
+    xTaskNotifyGive(loopTaskHandle);
+  }
+}
+
+void onWiFiEvent(arduino_event_id_t event) {
+  wakeLoop();
+}
+
+void onBufferCheckTimer() {
+  drainPaused = false;
+  checkInflightTimeout();
+}
+
+void onTwinUpdateTimer() {
+  if (connectionState == FULLY_CONNECTED) {
+    publishTwinReported();
+  }
+}
+
+void onOutboxFlushTimer() {
+  flushOutbox();
+}
+
+void onHealthSampleTimer() {
+  sampleHealth();
+}
+
+void onHealthReportTimer() {
+  publishStatus();
+}
+
+void onAdaptiveCooldownTimer() {
+  refreshAdaptiveCooldown();
+}
+
+// Traite les paquets MQTT reçus puis réarme la surveillance du socket
+void pollMqtt() {
+  int packets = 0;
+  do {
+    mqtt.loop();
+  } while (mqtt.connected() && tlsClient.available() > 0 && ++packets < 8);
+  
+  if (socketWatchTaskHandle) {
+    xTaskNotifyGive(socketWatchTaskHandle);
+  }
+}
+
+// Fait sortir socketWatchTask de select() et attend qu'il lâche le socket.
+// Appelé avant toute fermeture, depuis loop() ou mqttConnectTask.
+void parkSocketWatcher() {
+  if (socketMutex == NULL) {
+    return;
+  }
+  socketWatchParked = true;
+  if (socketWakeFd >= 0) {
+    uint64_t one = 1;
+    write(socketWakeFd, &one, sizeof(one));
+  }
+  xSemaphoreTake(socketMutex, portMAX_DELAY);
+}
+
+void releaseSocketWatcher() {
+  if (socketMutex == NULL) {
+    return;
+  }
+  xSemaphoreGive(socketMutex);
+  socketWatchParked = false;
+  if (socketWatchTaskHandle) {
+    xTaskNotifyGive(socketWatchTaskHandle);
+  }
+}
+
+// Réveille loop() quand le socket MQTT devient lisible
+void socketWatchTask(void* arg) {
+  for (;;) {
+    // Une fermeture est en cours : ne pas reprendre le socket avant la fin
+    if (socketWatchParked) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+      continue;
+    }
+    
+    xSemaphoreTake(socketMutex, portMAX_DELAY);
+    int fd = connectionState == FULLY_CONNECTED ? tlsClient.socketFd() : -1;
+    if (fd < 0 || socketWatchParked) {
+      xSemaphoreGive(socketMutex);
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+      continue;
+    }
+    
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(fd, &readSet);
+    int maxFd = fd;
+    if (socketWakeFd >= 0) {
+      FD_SET(socketWakeFd, &readSet);
+      maxFd = socketWakeFd > fd ? socketWakeFd : fd;
+    }
+    struct timeval timeout = {1, 0};
+    int ready = select(maxFd + 1, &readSet, NULL, NULL, &timeout);
+    bool readable = ready > 0 && FD_ISSET(fd, &readSet);
+    if (ready > 0 && socketWakeFd >= 0 && FD_ISSET(socketWakeFd, &readSet)) {
+      uint64_t count;
+      read(socketWakeFd, &count, sizeof(count));
+    }
+    xSemaphoreGive(socketMutex);
+    
+    if (readable) {
+      wakeLoop();
+      // Attendre que loop() ait consommé les données avant de resurveiller
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    } else if (ready < 0) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    }
+  }
+}
+
+// Calcule la prochaine échéance et bloque loop() jusque-là
+void waitForNextEvent() {
+  if (!pirEdgeQueue.empty()) {
+    return;
+  }
+  
+  unsigned long nowMs = millis();
+  uint64_t nowUs = (uint64_t)esp_timer_get_time();
+  uint32_t waitMs = timers.msUntilNext(nowMs, MAX_IDLE_WAIT);
+  
+  if (connectionState != FULLY_CONNECTED && waitMs > CONNECTION_POLL_INTERVAL) {
+    waitMs = CONNECTION_POLL_INTERVAL;
+  }
+  
+  // Paquets regroupés en attente : mqtt.loop() les envoie à l'échéance
+  if (connectionState == FULLY_CONNECTED) {
+    waitMs = mqtt.msUntilFlush(waitMs);
+  }
+  
+  uint64_t deadlineUs = pirBank.nextDeadlineUs();
+  uint64_t sessionDeadlineUs = occupancy.nextDeadlineUs(config.idleTimeout * 1000ULL,
+                                                        SESSION_MAX_DURATION * 1000ULL);
+  if (sessionDeadlineUs < deadlineUs) {
+    deadlineUs = sessionDeadlineUs;
+  }
+  if (deadlineUs != UINT64_MAX) {
+    uint64_t untilMs = deadlineUs > nowUs ? (deadlineUs - nowUs + 999) / 1000 : 0;
+    if (untilMs < waitMs) {
+      waitMs = (uint32_t)untilMs;
+    }
+  }
+  
+  if (!motionBatch.empty() && config.batchWindow > 0) {
+    int32_t untilMs = (int32_t)(motionBatch.deadlineMs(config.batchWindow) - (uint32_t)nowMs);
+    if (untilMs < 0) {
+      untilMs = 0;
+    }
+    if ((uint32_t)untilMs < waitMs) {
+      waitMs = (uint32_t)untilMs;
+    }
+  }
+  
+  if (config.powerMode == POWER_DEEP_SLEEP && waitMs > DEEP_SLEEP_POLL_INTERVAL) {
+    waitMs = DEEP_SLEEP_POLL_INTERVAL;
+  }
+  
+  if (outboxDrainActive() && !drainWaitingForAck()) {
+    uint32_t untilTokenMs = (uint32_t)((drainBucket.usUntilToken(nowUs) + 999) / 1000);
+    if (untilTokenMs < waitMs) {
+      waitMs = untilTokenMs;
+    }
+  }
+  
+  if (waitMs > 0) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+  }
+  lastIdleUs = (uint64_t)esp_timer_get_time() - nowUs;
+  metrics.loopWakeups++;
+}
+
+// ============================================
+// FONCTIONS DEEP SLEEP
+// ============================================
+
+// Démarrage à froid : état RTC remis à zéro. Réveil : métriques restaurées.
+void restoreRtcState() {
+  if (!fastBoot || rtcState.magic != RTC_STATE_MAGIC) {
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcState.magic = RTC_STATE_MAGIC;
+    return;
+  }
+  memcpy(&metrics, rtcState.metrics, sizeof(metrics));
+  metrics.loopWakeups = 0;
+  metrics.maxWakeLatencyUs = 0;
+  metrics.lastStatusTime = 0;
+  rtcState.wakeCount++;
+}
+
+void saveRtcState() {
+  memcpy(rtcState.metrics, &metrics, sizeof(metrics));
+  if (WiFi.status() == WL_CONNECTED && WiFi.BSSID() != nullptr) {
+    rtcState.wifiChannel = (uint8_t)WiFi.channel();
+    memcpy(rtcState.wifiBssid, WiFi.BSSID(), sizeof(rtcState.wifiBssid));
+  }
+  rtcState.seqNext = sequence.peek();
+  rtcState.seqEnd = sequence.reservedEnd();
+}
+
+// Détection à publier avant le prochain sommeil
+void queueWakeEvent(uint8_t sensor) {
+  time_t now;
+  time(&now);
+  
+  RtcMotionEvent event;
+  event.seq = sequence.next();
+  event.epoch = now > 1700000000 ? (uint32_t)now : 0;
+  event.sensor = sensor;
+  rtcState.events.push(event);
+  
+  DEBUG_PRINTF("[SLEEP] Détection #%d mise en file (%u en attente)\n",
+               metrics.detectionCount, (unsigned)rtcState.events.size());
+}
+
+// Le front qui a réveillé l'ESP32 a eu lieu avant l'ISR : il compte comme détection
+void recordWakeDetection() {
+  if (!config.detectionEnabled) {
+    return;
+  }
+  
+  uint8_t sensor = 0;
+  if (wakeCause == ESP_SLEEP_WAKEUP_EXT1) {
+    uint64_t wakePins = esp_sleep_get_ext1_wakeup_status();
+    for (size_t i = 0; i < PIR_COUNT; i++) {
+      if (wakePins & (1ULL << PIR_PINS[i])) {
+        sensor = (uint8_t)i;
+        break;
+      }
+    }
+  }
+  
+  metrics.detectionCount++;
+  DEBUG_PRINTF("[SLEEP] 🚨 Réveil sur détection #%d (PIR %u)\n", metrics.detectionCount, sensor);
+  queueWakeEvent(sensor);
+}
+
+// Message d'une détection conservée en RTC
+void encodeWakeEvent(const RtcMotionEvent& event, JsonDocument& doc) {
+  MotionMessage message;
+  message.seq = event.seq;
+  message.ts = millis();
+  message.sensor = event.sensor;
+  message.hasTime = event.epoch != 0;
+  message.time = event.epoch;
+  message.hasWakeToPublishMs = true;
+  message.wakeToPublishMs = rtcState.lastWakeToPublishMs;
+  encodeMessage(message, doc);
+}
+
+// Première détection du réveil confirmée : PUBACK (releaseAcked) ou, en QoS 0,
+// écriture dans le client TLS réussie
+void noteWakePublish() {
+  if (fastBoot && wakeCause != ESP_SLEEP_WAKEUP_TIMER && !wakePublishMeasured) {
+    // esp_timer démarre au réveil : c'est directement la durée réveil → publication
+    wakePublishMeasured = true;
+    rtcState.lastWakeToPublishMs = (uint32_t)(esp_timer_get_time() / 1000);
+    DEBUG_PRINTF("[SLEEP] ⏱️ Réveil → publication confirmée: %lu ms\n",
+                 (unsigned long)rtcState.lastWakeToPublishMs);
+  }
+}
+
+// QoS 1 : chaque détection reste en RTC jusqu'à son PUBACK (voir releaseAcked)
+void publishWakeEventsTracked() {
+  for (size_t i = 0; i < rtcState.events.size(); i++) {
+    const RtcMotionEvent& event = rtcState.events.at(i);
+    if (event.seq <= wakeEventsSentSeq) {
+      continue;
+    }
+    
+    StaticJsonDocument<MOTION_MESSAGE_DOC_SIZE> doc;
+    encodeWakeEvent(event, doc);
+    char payload[OUTBOX_PAYLOAD_SIZE];
+    size_t length = serializeJson(doc, payload, sizeof(payload));
+    if (!trackPublish(RECORD_JSON, (const uint8_t*)payload, length, INFLIGHT_RTC, event.seq)) {
+      return;
+    }
+    wakeEventsSentSeq = event.seq;
+    
+    if (sendInflight(inflight.size() - 1, false) == PUBLISH_FAILED) {
+      DEBUG_PRINTLN("[SLEEP] ❌ Publish échoué, republié à la reconnexion");
+      metrics.failedPublishCount++;
+      return;
+    }
+    esp_task_wdt_reset();
+  }
+}
+
+// Publie les détections conservées en RTC, la plus ancienne d'abord
+void publishWakeEvents() {
+  if (rtcState.events.empty() || connectionState != FULLY_CONNECTED) {
+    return;
+  }
+  if (config.inflightWindow > 0) {
+    publishWakeEventsTracked();
+    return;
+  }
+  
+  // QoS 0 : retirées de la RTC seulement une fois passées au client TLS
+  size_t published = 0;
+  while (published < rtcState.events.size()) {
+    StaticJsonDocument<MOTION_MESSAGE_DOC_SIZE> doc;
+    encodeWakeEvent(rtcState.events.at(published), doc);
+    if (!publishTelemetry(doc)) {
+      break;
+    }
+    published++;
+    esp_task_wdt_reset();
+  }
+  if (published == 0 || !mqtt.flushWrites() || !mqtt.connected()) {
+    DEBUG_PRINTLN("[SLEEP] ❌ Publish échoué, détections gardées en RTC");
+    metrics.failedPublishCount++;
+    return;
+  }
+  for (size_t i = 0; i < published; i++) {
+    rtcState.events.pop();
+  }
+  noteWakePublish();
+  if (!rtcState.events.empty()) {
+    DEBUG_PRINTLN("[SLEEP] ❌ Publish échoué, détections restantes gardées en RTC");
+    metrics.failedPublishCount++;
+  }
+}
+
+void enterDeepSleep() {
+  DEBUG_PRINTF("[SLEEP] 💤 Deep sleep (%u détections en attente)\n", (unsigned)rtcState.events.size());
+  
+  flushOutbox();
+  endOutboxDrain((uint64_t)esp_timer_get_time());
+  saveRtcState();
+  if (!mqttConnecting.load(std::memory_order_acquire)) {
+    mqtt.disconnect();
+  }
+  WiFi.disconnect(true);
+  digitalWrite(LED_PIN, LOW);
+  
+  if (config.detectionEnabled) {
+    if (PIR_COUNT == 1) {
+      esp_sleep_enable_ext0_wakeup((gpio_num_t)PIR_PINS[0], 1);
+    } else {
+      esp_sleep_enable_ext1_wakeup(PIR_PIN_MASK, ESP_EXT1_WAKEUP_ANY_HIGH);
+    }
+  }
+  esp_sleep_enable_timer_wakeup(DEEP_SLEEP_HEARTBEAT * 1000ULL);
+  
+  Serial.flush();
+  esp_deep_sleep_start();
+}
+
+// Rendort l'ESP32 quand tout est publié (ou quand la connexion n'aboutit pas)
+void maybeEnterDeepSleep() {
+  if (config.powerMode != POWER_DEEP_SLEEP) {
+    return;
+  }
+  
+  unsigned long now = millis();
+  if (now < DEEP_SLEEP_MAX_AWAKE) {
+    if (connectionState != FULLY_CONNECTED || now - fullyConnectedAt < DEEP_SLEEP_LINGER) {
+      return;
+    }
+    if (!rtcState.events.empty() || outboxPending() > 0 || !inflight.empty()) {
+      return;
+    }
+  }
+  
+  // Réveil sur niveau haut : un PIR encore actif réveillerait aussitôt l'ESP32
+  if (config.detectionEnabled && (REG_READ(GPIO_IN_REG) & PIR_PIN_MASK) != 0) {
+    return;
+  }
+  
+  enterDeepSleep();
+}
+
 // ============================================
 // SETUP
 // ============================================
 
 void setup() {
   Serial.begin(115200);
-  delay(1000);
   
-  Serial.println("\n\n╔═══════════════════════════════════════╗");
-  Serial.println("║   ESP32 - Azure IoT Hub PIR Sensor    ║");
-  Serial.printf("║   Firmware: %-25s ║\n", FIRMWARE_VERSION);
-  Serial.println("╚═══════════════════════════════════════╝\n");
+  wakeCause = esp_sleep_get_wakeup_cause();
+  fastBoot = wakeCause == ESP_SLEEP_WAKEUP_EXT0 || wakeCause == ESP_SLEEP_WAKEUP_EXT1 ||
+             wakeCause == ESP_SLEEP_WAKEUP_TIMER;
+  
+  if (fastBoot) {
+    DEBUG_PRINTF("\n[SLEEP] ⏰ Réveil (%s)\n", wakeCause == ESP_SLEEP_WAKEUP_TIMER ? "timer" : "PIR");
+  } else {
+    delay(1000);
+    
+    Serial.println("\n\n╔═══════════════════════════════════════╗");
+    Serial.println("║   ESP32 - Azure IoT Hub PIR Sensor    ║");
+    Serial.printf("║   Firmware: %-25s ║\n", FIRMWARE_VERSION);
+    Serial.println("╚═══════════════════════════════════════╝\n");
+  }
+  
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
   
-  pinMode(PIR_PIN, INPUT);
   pinMode(LED_PIN, OUTPUT);
   digitalWrite(LED_PIN, LOW);
+  for (size_t i = 0; i < PIR_COUNT; i++) {
+    pinMode(PIR_PINS[i], INPUT);
+    attachInterrupt(digitalPinToInterrupt(PIR_PINS[i]), onPirEdge, CHANGE);
+  }
   
   DEBUG_PRINTLN("[WDT] Configuration du watchdog...");
   esp_task_wdt_init(WDT_TIMEOUT, true);
@@ -777,9 +3116,73 @@ void setup() {
   
   DEBUG_PRINTLN("[CONFIG] Chargement de la configuration...");
   loadConfig();
+  restoreRtcState();
+  buildMessageFilters();
+  
+  // Numérotation des messages : reprise depuis la RAM RTC au réveil, sinon depuis la NVS
+  if (fastBoot && rtcState.seqEnd != 0) {
+    sequence.resume(rtcState.seqNext, rtcState.seqEnd);
+  } else if (!sequence.begin()) {
+    DEBUG_PRINTLN("[SEQ] ⚠️ Réservation NVS échouée");
+  }
+  DEBUG_PRINTF("[SEQ] Prochain message : seq=%llu\n", (unsigned long long)sequence.peek());
+  
+  bool sessionMounted = sessionFlash.begin(0, OUTBOX_SESSION_FLASH_SIZE) && sessionLog.mount();
+  if (sessionMounted && motionFlash.begin(OUTBOX_SESSION_FLASH_SIZE, 0) && motionLog.mount()) {
+    DEBUG_PRINTF("[OUTBOX] ✅ Journaux flash montés : %d sessions, %d détections en attente\n",
+                 sessionLog.pending(), motionLog.pending());
+    uint32_t foreign = sessionLog.foreignSegments() + motionLog.foreignSegments();
+    if (foreign > 0) {
+      DEBUG_PRINTF("[OUTBOX] ⚠️ %u segments d'un autre format effacés\n", (unsigned)foreign);
+    }
+  } else {
+    // Tout en flash ou tout en RAM : pas de journal de sessions seul
+    if (sessionMounted) {
+      sessionLog.unmount();
+    }
+    DEBUG_PRINTLN("[OUTBOX] ⚠️ Partition \"outbox\" absente, buffer en RAM uniquement");
+  }
   
   metrics.bootTime = millis();
   
+  if (fastBoot) {
+    // Le PIR est déjà haut : partir de l'état courant des entrées
+    PirEdge levels;
+    levels.timestampUs = (uint64_t)esp_timer_get_time();
+    levels.levels = REG_READ(GPIO_IN_REG);
+    pirBank.resync(levels);
+    if (wakeCause != ESP_SLEEP_WAKEUP_TIMER) {
+      recordWakeDetection();
+    }
+    // Connexion WiFi immédiate, sans attendre CONNECTION_RETRY_INTERVAL
+    lastConnectionAttempt = millis() - CONNECTION_RETRY_INTERVAL - 1;
+  }
+  
+  DEBUG_PRINTLN("[LOOP] Configuration du réveil sur événement...");
+  unsigned long now = millis();
+  timers.add(BUFFER_CHECK_INTERVAL, onBufferCheckTimer, now);
+  timers.add(TWIN_UPDATE_INTERVAL, onTwinUpdateTimer, now);
+  timers.add(HEALTH_SAMPLE_INTERVAL, onHealthSampleTimer, now);
+  timers.add(HEALTH_REPORT_INTERVAL, onHealthReportTimer, now);
+  timers.add(ADAPTIVE_REFRESH_INTERVAL, onAdaptiveCooldownTimer, now);
+  outboxFlushTimer = timers.add(OUTBOX_FLUSH_INTERVAL, onOutboxFlushTimer, now);
+  timers.setEnabled(outboxFlushTimer, false, now);
+  ledBlinkTimer = timers.add(LED_BLINK_INTERVAL, onLedBlinkTimer, now);
+  timers.setEnabled(ledBlinkTimer, false, now);
+  WiFi.onEvent(onWiFiEvent);
+  esp_vfs_eventfd_config_t eventfdConfig = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+  if (esp_vfs_eventfd_register(&eventfdConfig) == ESP_OK) {
+    socketWakeFd = eventfd(0, 0);
+  }
+  socketMutex = xSemaphoreCreateMutex();
+  xTaskCreatePinnedToCore(socketWatchTask, "mqttWatch", 2048, NULL, 1,
+                          &socketWatchTaskHandle, xPortGetCoreID());
+  // Connexion TLS/MQTT sur l'autre cœur quand il existe : le calcul de la
+  // poignée de main ne prend pas de temps à loop()
+  xTaskCreatePinnedToCore(mqttConnectTask, "mqttConnect", 8192, NULL, 1,
+                          &mqttConnectTaskHandle,
+                          portNUM_PROCESSORS > 1 ? 1 - xPortGetCoreID() : xPortGetCoreID());
+  
   DEBUG_PRINTLN("[SYSTEM] ✅ Initialisation terminée\n");
   DEBUG_PRINTF("[SYSTEM] Mode DEBUG: %s\n", DEBUG_MODE ? "ACTIVÉ" : "DÉSACTIVÉ");
   DEBUG_PRINTF("[SYSTEM] RAM libre: %d bytes\n", ESP.getFreeHeap());
@@ -794,78 +3197,35 @@ void loop() {
   esp_task_wdt_reset();
   
   // Gestion de la connexion (non-bloquante)
+  bool connecting = connectionState != FULLY_CONNECTED;
   handleConnection();
   
   // Traiter les messages MQTT seulement si connecté
   if (connectionState == FULLY_CONNECTED) {
-    mqtt.loop();
-  }
-  
-  // Vérifier et envoyer les messages en buffer périodiquement
-  if (millis() - lastBufferCheck > BUFFER_CHECK_INTERVAL) {
-    lastBufferCheck = millis();
-    if (!messageBuffer.empty() && connectionState == FULLY_CONNECTED) {
-      sendBufferedMessages();
-    }
+    pollMqtt();
   }
   
-  // Mise à jour périodique du Device Twin
-  if (millis() - lastTwinUpdate > TWIN_UPDATE_INTERVAL) {
-    lastTwinUpdate = millis();
-    if (connectionState == FULLY_CONNECTED) {
-      publishTwinReported();
-    }
-  }
+  // Buffer, Device Twin, keepalive MQTT
+  timers.run(millis());
   
   // === LOGIQUE PIR (FONCTIONNE MÊME SI DÉCONNECTÉ) ===
+  // Les fronts sont capturés par l'ISR, même pendant une opération bloquante
+  notePirService(connecting);
   if (!config.detectionEnabled) {
-    delay(100);
-    return;
-  }
-  
-  bool currentState = digitalRead(PIR_PIN);
-  unsigned long now = millis();
-  
-  // Détection du front montant (début de mouvement)
-  if (currentState == HIGH && pirState.lastState == LOW) {
-    if ((now - pirState.lastStateChangeTime) > DEBOUNCE_DELAY) {
-      if (!pirState.motionInProgress) {
-        if ((now - metrics.lastValidDetectionTime) > config.cooldownPeriod) {
-          pirState.motionInProgress = true;
-          metrics.detectionCount++;
-          metrics.lastValidDetectionTime = now;
-          
-          DEBUG_PRINTLN("\n╔═══════════════════════════════════════╗");
-          DEBUG_PRINTF("║  🚨 DÉTECTION #%-4d                  ║\n", metrics.detectionCount);
-          DEBUG_PRINTLN("╚═══════════════════════════════════════╝");
-          
-          digitalWrite(LED_PIN, HIGH);
-          
-          publishDetectionJson();
-          
-          DEBUG_PRINTLN("───────────────────────────────────────\n");
-        } else {
-          DEBUG_PRINTF("[PIR] ⏳ Cooldown actif (%lu ms restant)\n", 
-                        config.cooldownPeriod - (now - metrics.lastValidDetectionTime));
-        }
-      }
-    }
-    pirState.lastStateChangeTime = now;
+    discardPirEdges();
+  } else {
+    processPirEdges();
   }
+  processOccupancy();
+  processMotionBatch();
   
-  // Détection du front descendant (fin de mouvement)
-  if (currentState == LOW && pirState.lastState == HIGH) {
-    if ((now - pirState.lastStateChangeTime) > DEBOUNCE_DELAY) {
-      if (pirState.motionInProgress) {
-        pirState.motionInProgress = false;
-        digitalWrite(LED_PIN, LOW);
-        DEBUG_PRINTLN("[PIR] ✅ Mouvement terminé");
-      }
-    }
-    pirState.lastStateChangeTime = now;
-  }
+  // Messages en attente : quelques-uns par tour, sans bloquer le PIR
+  drainOutboxStep();
   
-  pirState.lastState = currentState;
+  // Mode deep sleep : publier les détections conservées puis se rendormir
+  publishWakeEvents();
+  maybeEnterDeepSleep();
   
-  delay(50);
-}
\ No newline at end of file
+  // Dormir jusqu'au prochain événement (front PIR, socket, WiFi) ou échéance
+  waitForNextEvent();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// === ARDUINO MINIMAL (TESTS HÔTE) ===
+// Juste ce qu'il faut pour compiler lib/PubSubClient dans env:native.
+// Horloge simulée : millis() n'avance que par delay(), yield() (1 ms,
+// pour qu'une attente active finisse par expirer) ou le test lui-même.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_byte_near(p) pgm_read_byte(p)
+
+struct FakeClock {
+  unsigned long now = 0;
+  unsigned long delayCalls = 0;
+  unsigned long yieldCalls = 0;
+};
+
+inline FakeClock& fakeClock() {
+  static FakeClock clock;
+  return clock;
+}
+
+inline unsigned long millis() {
+  return fakeClock().now;
+}
+
+inline void delay(unsigned long ms) {
+  fakeClock().delayCalls++;
+  fakeClock().now += ms;
+}
+
+inline void yield() {
+  fakeClock().yieldCalls++;
+  fakeClock().now++;
+}
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buffer[n])) {
+      n++;
+    }
+    return n;
+  }
+};
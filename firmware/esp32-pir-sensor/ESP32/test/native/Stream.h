@@ -0,0 +1,10 @@
+#pragma once
+
+#include "Arduino.h"
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "Client.h"
+
+// === CLIENT RÉSEAU SIMULÉ (TESTS HÔTE) ===
+// Les octets reçus arrivent par enregistrements, comme avec WiFiClientSecure :
+// read(buf, size) rend au plus le reste de l'enregistrement en tête.
+// Tout ce qui est écrit est gardé ; chaque appel à write() est compté.
+
+class FakeClient : public Client {
+ public:
+  // Enregistrement reçu, lisible à partir de `at` (heure simulée)
+  void receive(const std::vector<uint8_t>& record, unsigned long at = 0) {
+    records_.push_back(Record{record, 0, at});
+  }
+
+  // Découpe `bytes` en enregistrements de `recordSize` octets au plus
+  void receiveSplit(const std::vector<uint8_t>& bytes, size_t recordSize) {
+    for (size_t i = 0; i < bytes.size(); i += recordSize) {
+      size_t end = i + recordSize < bytes.size() ? i + recordSize : bytes.size();
+      receive(std::vector<uint8_t>(bytes.begin() + i, bytes.begin() + end));
+    }
+  }
+
+  int connect(IPAddress, uint16_t) override { return open(); }
+  int connect(const char*, uint16_t) override { return open(); }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t size) override {
+    writeCalls++;
+    if (!connected_) {
+      return 0;
+    }
+    size_t accepted = size < writeLimit ? size : writeLimit;
+    written.insert(written.end(), buf, buf + accepted);
+    return accepted;
+  }
+
+  int available() override {
+    int count = 0;
+    for (const Record& record : records_) {
+      if (record.at > millis()) {
+        break;
+      }
+      count += (int)(record.bytes.size() - record.offset);
+    }
+    return count;
+  }
+
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+
+  int read(uint8_t* buf, size_t size) override {
+    readCalls++;
+    if (records_.empty() || records_.front().at > millis()) {
+      return 0;
+    }
+    Record& record = records_.front();
+    size_t left = record.bytes.size() - record.offset;
+    size_t count = size < left ? size : left;
+    memcpy(buf, record.bytes.data() + record.offset, count);
+    record.offset += count;
+    if (record.offset == record.bytes.size()) {
+      records_.pop_front();
+    }
+    return (int)count;
+  }
+
+  int peek() override { return records_.empty() ? -1 : records_.front().bytes[records_.front().offset]; }
+  void flush() override {}
+  void stop() override {
+    stopCalls++;
+    connected_ = false;
+  }
+  uint8_t connected() override { return connected_; }
+  operator bool() override { return connected_; }
+
+  std::vector<uint8_t> written;
+  size_t writeLimit = (size_t)-1;   // Octets acceptés par write() (écriture partielle au-delà)
+  size_t writeCalls = 0;
+  size_t readCalls = 0;
+  size_t stopCalls = 0;
+
+ private:
+  struct Record {
+    std::vector<uint8_t> bytes;
+    size_t offset;
+    unsigned long at;
+  };
+
+  int open() {
+    connected_ = true;
+    return 1;
+  }
+
+  std::deque<Record> records_;
+  bool connected_ = false;
+};
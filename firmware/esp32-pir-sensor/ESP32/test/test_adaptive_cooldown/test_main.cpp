@@ -0,0 +1,123 @@
+#include <unity.h>
+
+#include "adaptive_cooldown.h"
+#include "detection_pipeline.h"
+
+// === COOLDOWN ADAPTATIF ===
+
+static const uint64_t SEC = 1000000ULL;
+static const uint32_t CONFIGURED_MS = 5000;
+static const uint32_t MAX_MS = 600000;
+
+void setUp() {}
+void tearDown() {}
+
+static void test_configured_until_enough_samples() {
+  AdaptiveCooldown adaptive;
+  adaptive.onCandidate(0, 10 * SEC);
+  adaptive.onCandidate(0, 11 * SEC);
+  TEST_ASSERT_EQUAL_UINT32(CONFIGURED_MS, adaptive.update(11 * SEC, CONFIGURED_MS, 120, MAX_MS));
+}
+
+// Un capteur, un candidat toutes les 10 s, 120 messages/h (un toutes les 30 s)
+static void test_single_sensor_target() {
+  AdaptiveCooldown adaptive;
+  uint64_t t = 10 * SEC;
+  for (int i = 0; i < 50; i++) {
+    adaptive.onCandidate(0, t);
+    t += 10 * SEC;
+  }
+  uint32_t effective = adaptive.update(t - 10 * SEC, CONFIGURED_MS, 120, MAX_MS);
+  TEST_ASSERT_UINT32_WITHIN(1000, 20000, effective);
+}
+
+static void test_no_budget_keeps_configured() {
+  AdaptiveCooldown adaptive;
+  uint64_t t = 10 * SEC;
+  for (int i = 0; i < 50; i++) {
+    adaptive.onCandidate(0, t);
+    t += SEC;
+  }
+  TEST_ASSERT_EQUAL_UINT32(CONFIGURED_MS, adaptive.update(t, CONFIGURED_MS, 0, MAX_MS));
+}
+
+// Quatre capteurs très actifs : le cooldown est propre à chaque capteur,
+// le total publié sur une heure doit pourtant tenir dans le budget
+static void test_budget_holds_across_sensors() {
+  const uint32_t budget = 120;
+  const uint8_t sensors = 4;
+  AdaptiveCooldown adaptive;
+  DetectionPipeline<sensors, DetectionParams, CooldownStage> pipeline;
+  pipeline.params().cooldownUs = CONFIGURED_MS * 1000UL;
+
+  uint32_t published = 0;
+  uint64_t now = 10 * SEC;
+  auto sink = [&](uint8_t sensor, PirEvent event, uint64_t ts, uint64_t) {
+    if (event == PIR_EVENT_MOTION_START || event == PIR_EVENT_COOLDOWN_REJECTED) {
+      adaptive.onCandidate(sensor, ts);
+      uint32_t ms = adaptive.update(ts, CONFIGURED_MS, budget, MAX_MS);
+      pipeline.params().cooldownUs = ms * 1000UL;
+    }
+    if (event == PIR_EVENT_MOTION_START && ts >= 3600 * SEC + 10 * SEC) {
+      published++;
+    }
+  };
+
+  // Chaque capteur se déclenche toutes les 2 s, décalés de 0,5 s
+  for (uint64_t t = 0; t < 2 * 3600 * SEC; t += SEC / 2) {
+    uint8_t sensor = (uint8_t)((t / (SEC / 2)) % sensors);
+    now = 10 * SEC + t;
+    pipeline.process(PirSignal{sensor, true, now}, sink);
+    pipeline.process(PirSignal{sensor, false, now + SEC / 5}, sink);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(sensors, adaptive.activeSensors());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(budget, published);
+  TEST_ASSERT_GREATER_THAN_UINT32(budget / 2, published);
+}
+
+// Sans nouveau candidat, les appels périodiques à update() ramènent le
+// cooldown au cooldown configuré
+static void test_decays_without_candidates() {
+  AdaptiveCooldown adaptive;
+  uint64_t t = 10 * SEC;
+  for (int i = 0; i < 50; i++) {
+    adaptive.onCandidate(0, t);
+    t += 2 * SEC;
+  }
+  uint32_t raised = adaptive.update(t, CONFIGURED_MS, 120, MAX_MS);
+  TEST_ASSERT_GREATER_THAN_UINT32(20000, raised);
+
+  uint32_t effective = raised;
+  for (int minute = 1; minute <= 60; minute++) {
+    effective = adaptive.update(t + minute * 60 * SEC, CONFIGURED_MS, 120, MAX_MS);
+  }
+  TEST_ASSERT_EQUAL_UINT32(CONFIGURED_MS, effective);
+}
+
+// Un capteur silencieux pendant plus de deux heures ne compte plus
+static void test_active_sensors_expire() {
+  AdaptiveCooldown adaptive;
+  adaptive.onCandidate(0, 10 * SEC);
+  adaptive.onCandidate(1, 20 * SEC);
+  adaptive.onCandidate(2, 30 * SEC);
+  TEST_ASSERT_EQUAL_UINT32(3, adaptive.activeSensors());
+
+  uint64_t t = 30 * SEC;
+  for (int i = 0; i < 3 * 60; i++) {
+    t += 60 * SEC;
+    adaptive.onCandidate(0, t);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, adaptive.activeSensors());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_configured_until_enough_samples);
+  RUN_TEST(test_single_sensor_target);
+  RUN_TEST(test_no_budget_keeps_configured);
+  RUN_TEST(test_budget_holds_across_sensors);
+  RUN_TEST(test_decays_without_candidates);
+  RUN_TEST(test_active_sensors_expire);
+  return UNITY_END();
+}
@@ -0,0 +1,247 @@
+#include <unity.h>
+
+#include <random>
+#include <vector>
+
+#include "detection_pipeline.h"
+
+// === PIPELINE DE DÉTECTION : TRACES DE RÉFÉRENCE ===
+// Chaque trace est une suite de niveaux PIR horodatés ; la sortie attendue
+// a été relevée sur la logique de loop() d'origine (anti-rebond 500 ms,
+// cooldown 5 s) puis, pour les étages ajoutés, vérifiée à la main.
+
+struct TraceStep {
+  uint32_t ms;
+  bool level;
+};
+
+struct Expected {
+  PirEvent event;
+  uint32_t ms;
+  uint32_t remainingMs;
+};
+
+struct Event {
+  PirEvent event;
+  uint64_t timestampUs;
+  uint64_t remainingUs;
+};
+
+struct Recorder {
+  std::vector<Event> events;
+  void operator()(uint8_t, PirEvent event, uint64_t ts, uint64_t remaining) {
+    events.push_back({event, ts, remaining});
+  }
+};
+
+typedef DetectionPipeline<1, DetectionParams, DebounceStage, HysteresisStage,
+                          MinPulseWidthStage, RetriggerMergeStage, CooldownStage> FullPipeline;
+
+template <class Pipeline, size_t N>
+static std::vector<Event> run(Pipeline& pipeline, const TraceStep (&trace)[N]) {
+  Recorder rec;
+  for (size_t i = 0; i < N; i++) {
+    PirSignal s{0, trace[i].level, (uint64_t)trace[i].ms * 1000};
+    pipeline.process(s, rec);
+  }
+  pipeline.poll(UINT64_MAX / 2, rec);
+  return rec.events;
+}
+
+template <size_t M>
+static void assertEvents(const Expected (&expected)[M], const std::vector<Event>& events) {
+  TEST_ASSERT_EQUAL(M, events.size());
+  for (size_t i = 0; i < M; i++) {
+    TEST_ASSERT_EQUAL(expected[i].event, events[i].event);
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)expected[i].ms * 1000, events[i].timestampUs);
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)expected[i].remainingMs * 1000, events[i].remainingUs);
+  }
+}
+
+// Logique de loop() avant le pipeline, conservée comme référence
+struct LegacyDetector {
+  uint64_t debounceUs = 500000;
+  uint64_t cooldownUs = 5000000;
+  bool lastState = false;
+  bool motionInProgress = false;
+  uint64_t lastStateChangeTime = 0;
+  uint64_t lastValidDetectionTime = 0;
+
+  template <class Sink>
+  void process(const PirSignal& s, Sink& sink) {
+    uint64_t now = s.timestampUs;
+    if (s.level && !lastState) {
+      if (now - lastStateChangeTime > debounceUs && !motionInProgress) {
+        if (now - lastValidDetectionTime > cooldownUs) {
+          motionInProgress = true;
+          lastValidDetectionTime = now;
+          sink(0, PIR_EVENT_MOTION_START, now, (uint64_t)0);
+        } else {
+          sink(0, PIR_EVENT_COOLDOWN_REJECTED, now, cooldownUs - (now - lastValidDetectionTime));
+        }
+      }
+      lastStateChangeTime = now;
+    } else if (!s.level && lastState) {
+      if (now - lastStateChangeTime > debounceUs && motionInProgress) {
+        motionInProgress = false;
+        sink(0, PIR_EVENT_MOTION_END, now, (uint64_t)0);
+      }
+      lastStateChangeTime = now;
+    }
+    lastState = s.level;
+  }
+
+  template <class Sink>
+  void poll(uint64_t, Sink&) {}
+};
+
+// Rebonds, cooldown, fin perdue dans un rebond puis rattrapée
+static const TraceStep LEGACY_TRACE[] = {
+  {10000, true},  {10200, false}, {10400, true},  {12000, false},
+  {13000, true},  {14000, false}, {16000, true},  {16300, false},
+  {20000, true},  {21000, false}, {21100, false}, {30000, true},
+  {30400, false}, {31000, true},  {32000, false},
+};
+
+static const Expected LEGACY_EXPECTED[] = {
+  {PIR_EVENT_MOTION_START, 10000, 0},
+  {PIR_EVENT_MOTION_END, 12000, 0},
+  {PIR_EVENT_COOLDOWN_REJECTED, 13000, 2000},
+  {PIR_EVENT_MOTION_START, 16000, 0},
+  {PIR_EVENT_MOTION_END, 21000, 0},
+  {PIR_EVENT_MOTION_START, 30000, 0},
+  {PIR_EVENT_MOTION_END, 32000, 0},
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void test_golden_legacy_reference() {
+  LegacyDetector legacy;
+  assertEvents(LEGACY_EXPECTED, run(legacy, LEGACY_TRACE));
+}
+
+// Étages ajoutés à 0 : sortie identique à la logique d'origine
+static void test_golden_full_pipeline_defaults() {
+  FullPipeline pipeline;
+  assertEvents(LEGACY_EXPECTED, run(pipeline, LEGACY_TRACE));
+}
+
+static void test_golden_fixed_params() {
+  DetectionPipeline<1, FixedDetectionParams<500000, 5000000>,
+                    DebounceStage, CooldownStage> pipeline;
+  assertEvents(LEGACY_EXPECTED, run(pipeline, LEGACY_TRACE));
+}
+
+// Impulsion de 600 ms rejetée, impulsion de 3 s validée à son front montant
+static void test_golden_min_pulse() {
+  static const TraceStep trace[] = {
+    {10000, true}, {10600, false}, {20000, true}, {23000, false},
+  };
+  static const Expected expected[] = {
+    {PIR_EVENT_MOTION_START, 20000, 0},
+    {PIR_EVENT_MOTION_END, 23000, 0},
+  };
+  FullPipeline pipeline;
+  pipeline.params().minPulseUs = 2000000;
+  assertEvents(expected, run(pipeline, trace));
+}
+
+// Redéclenchement dans la fenêtre : un seul mouvement
+static void test_golden_retrigger_merge() {
+  static const TraceStep trace[] = {
+    {10000, true}, {12000, false}, {14000, true}, {16000, false}, {30000, true},
+  };
+  static const Expected expected[] = {
+    {PIR_EVENT_MOTION_START, 10000, 0},
+    {PIR_EVENT_RETRIGGER, 14000, 0},
+    {PIR_EVENT_MOTION_END, 16000, 0},
+    {PIR_EVENT_MOTION_START, 30000, 0},
+  };
+  FullPipeline pipeline;
+  pipeline.params().mergeUs = 3000000;
+  assertEvents(expected, run(pipeline, trace));
+}
+
+// Front montant après un niveau bas trop court, front descendant après
+// un niveau haut trop court : tous deux ignorés
+static void test_golden_hysteresis() {
+  static const TraceStep trace[] = {
+    {10000, true}, {15000, false}, {16000, true}, {20000, false},
+    {20800, true}, {21500, false}, {26000, true},
+  };
+  static const Expected expected[] = {
+    {PIR_EVENT_MOTION_START, 10000, 0},
+    {PIR_EVENT_MOTION_END, 15000, 0},
+    {PIR_EVENT_MOTION_START, 26000, 0},
+  };
+  FullPipeline pipeline;
+  pipeline.params().cooldownUs = 0;
+  pipeline.params().riseHoldUs = 2000000;
+  pipeline.params().fallHoldUs = 1000000;
+  assertEvents(expected, run(pipeline, trace));
+}
+
+// Traces aléatoires (rebonds, niveaux répétés) : même sortie que la référence
+static void test_random_traces_match_legacy() {
+  std::mt19937 rng(1);
+  for (int trial = 0; trial < 200; trial++) {
+    LegacyDetector legacy;
+    FullPipeline pipeline;
+    Recorder a, b;
+    uint64_t t = 0;
+    bool level = false;
+    bool last = false;
+    for (int k = 0; k < 500; k++) {
+      t += rng() % 2000000;
+      level = !level;
+      if (rng() % 5 == 0) {
+        level = !level;
+      }
+      PirSignal s{0, level, t};
+      legacy.process(s, a);
+      // Comme PirBank, le pipeline ne reçoit que les changements de niveau
+      if (level != last) {
+        pipeline.process(s, b);
+        last = level;
+      }
+    }
+    TEST_ASSERT_EQUAL(a.events.size(), b.events.size());
+    for (size_t i = 0; i < a.events.size(); i++) {
+      TEST_ASSERT_EQUAL(a.events[i].event, b.events[i].event);
+      TEST_ASSERT_EQUAL_UINT64(a.events[i].timestampUs, b.events[i].timestampUs);
+      TEST_ASSERT_EQUAL_UINT64(a.events[i].remainingUs, b.events[i].remainingUs);
+    }
+  }
+}
+
+// Échéance différée exposée à loop() et annulée par clearMotion()
+static void test_deadline_and_clear() {
+  FullPipeline pipeline;
+  pipeline.params().minPulseUs = 2000000;
+  Recorder rec;
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, pipeline.nextDeadlineUs());
+  pipeline.process(PirSignal{0, true, 10000000}, rec);
+  TEST_ASSERT_EQUAL_UINT64(12000000, pipeline.nextDeadlineUs());
+  pipeline.poll(11999999, rec);
+  TEST_ASSERT_EQUAL(0, rec.events.size());
+  pipeline.poll(12000000, rec);
+  TEST_ASSERT_EQUAL(1, rec.events.size());
+  TEST_ASSERT_TRUE(pipeline.anyMotion());
+  pipeline.clearMotion();
+  TEST_ASSERT_FALSE(pipeline.anyMotion());
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, pipeline.nextDeadlineUs());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_golden_legacy_reference);
+  RUN_TEST(test_golden_full_pipeline_defaults);
+  RUN_TEST(test_golden_fixed_params);
+  RUN_TEST(test_golden_min_pulse);
+  RUN_TEST(test_golden_retrigger_merge);
+  RUN_TEST(test_golden_hysteresis);
+  RUN_TEST(test_random_traces_match_legacy);
+  RUN_TEST(test_deadline_and_clear);
+  return UNITY_END();
+}
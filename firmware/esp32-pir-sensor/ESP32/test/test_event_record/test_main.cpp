@@ -0,0 +1,170 @@
+#include <unity.h>
+
+#include <vector>
+
+#include "event_record.h"
+
+// === ENREGISTREMENTS BINAIRES DE L'OUTBOX ===
+
+void setUp() {}
+void tearDown() {}
+
+static void test_json_types() {
+  TEST_ASSERT_TRUE(recordIsJson(RECORD_JSON));
+  TEST_ASSERT_TRUE(recordIsJson(RECORD_STATUS));
+  TEST_ASSERT_TRUE(recordIsJson(RECORD_TWIN_REPORTED));
+  TEST_ASSERT_FALSE(recordIsJson(RECORD_MOTION));
+  TEST_ASSERT_FALSE(recordIsJson(RECORD_MOTION_BATCH));
+  TEST_ASSERT_FALSE(recordIsJson(RECORD_SESSION));
+  TEST_ASSERT_FALSE(recordIsJson(RECORD_MSGPACK));
+}
+
+// Copie depuis un payload non aligné, refusée si elle dépasse la longueur
+static void test_read_unaligned() {
+  MotionRecord record;
+  record.seq = 0x0102030405060708ULL;
+  record.timestampMs = 123456;
+  record.sensor = 3;
+
+  uint8_t buffer[sizeof(record) + 1];
+  memcpy(buffer + 1, &record, sizeof(record));
+
+  MotionRecord copy;
+  TEST_ASSERT_TRUE(readRecord(buffer + 1, sizeof(record), copy));
+  TEST_ASSERT_TRUE(copy.seq == record.seq);
+  TEST_ASSERT_EQUAL_UINT32(123456, copy.timestampMs);
+  TEST_ASSERT_EQUAL_UINT8(3, copy.sensor);
+
+  TEST_ASSERT_FALSE(readRecord(buffer + 1, sizeof(record) - 1, copy));
+  PackedBatchEntry entry;
+  TEST_ASSERT_FALSE(readRecord(buffer + 1, sizeof(record), entry, sizeof(record) - 2));
+}
+
+static void test_batch_layout() {
+  TEST_ASSERT_EQUAL(sizeof(MotionRecord), batchRecordSize(0));
+  TEST_ASSERT_EQUAL(sizeof(MotionRecord) + 3 * sizeof(PackedBatchEntry), batchRecordSize(3));
+
+  std::vector<uint8_t> record(batchRecordSize(3));
+  MotionRecord header = {};
+  header.seq = 77;
+  memcpy(record.data(), &header, sizeof(header));
+  for (size_t i = 0; i < 3; i++) {
+    PackedBatchEntry entry = {(uint32_t)(1000 + i), (uint8_t)i};
+    memcpy(record.data() + batchRecordSize(i), &entry, sizeof(entry));
+  }
+
+  BatchRecordView batch;
+  TEST_ASSERT_TRUE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), record.size(), batch));
+  TEST_ASSERT_EQUAL(3, batch.entries);
+  TEST_ASSERT_TRUE(batch.header.seq == 77);
+  for (size_t i = 0; i < 3; i++) {
+    PackedBatchEntry entry = readBatchEntry(record.data(), i);
+    TEST_ASSERT_EQUAL_UINT32(1000 + i, entry.timestampMs);
+    TEST_ASSERT_EQUAL_UINT8(i, entry.sensor);
+  }
+}
+
+// Longueurs incohérentes : l'enregistrement est illisible
+static void test_batch_bad_lengths() {
+  std::vector<uint8_t> record(batchRecordSize(4));
+  BatchRecordView batch;
+  TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), 0, batch));
+  TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), sizeof(MotionRecord) - 1, batch));
+  TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), sizeof(MotionRecord), batch));
+  TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), batchRecordSize(2) + 1, batch));
+  TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), batchRecordSize(2) - 1, batch));
+  TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MOTION, record.data(), batchRecordSize(2), batch));
+  TEST_ASSERT_TRUE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), batchRecordSize(1), batch));
+  TEST_ASSERT_EQUAL(1, batch.entries);
+}
+
+static std::vector<uint8_t> batchRecord(uint64_t seq, size_t entries) {
+  std::vector<uint8_t> record(batchRecordSize(entries));
+  MotionRecord header = {seq, 50000, 0};
+  memcpy(record.data(), &header, sizeof(header));
+  for (size_t i = 0; i < entries; i++) {
+    PackedBatchEntry entry = {(uint32_t)(40000 + i), (uint8_t)(i % 8)};
+    memcpy(record.data() + batchRecordSize(i), &entry, sizeof(entry));
+  }
+  return record;
+}
+
+// Un seul format par type : 33 octets sont 4 détections, 68 octets 11,
+// quelle que soit la forme qu'une autre version aurait pu leur donner
+static void test_batch_length_gives_entries() {
+  const size_t ENTRIES[] = {4, 11};
+  const size_t SIZES[] = {33, 68};
+  for (size_t n = 0; n < 2; n++) {
+    std::vector<uint8_t> record = batchRecord(900 + n, ENTRIES[n]);
+    TEST_ASSERT_EQUAL(SIZES[n], record.size());
+
+    BatchRecordView batch;
+    TEST_ASSERT_TRUE(decodeBatchRecord(RECORD_MOTION_BATCH, record.data(), record.size(), batch));
+    TEST_ASSERT_EQUAL(ENTRIES[n], batch.entries);
+    TEST_ASSERT_TRUE(batch.header.seq == 900 + n);
+    TEST_ASSERT_EQUAL_UINT32(50000, batch.header.timestampMs);
+    for (size_t i = 0; i < batch.entries; i++) {
+      PackedBatchEntry entry = readBatchEntry(record.data(), i);
+      TEST_ASSERT_EQUAL_UINT32(40000 + i, entry.timestampMs);
+      TEST_ASSERT_EQUAL_UINT8(i % 8, entry.sensor);
+    }
+
+    // Les autres types ne relisent pas un lot
+    TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MOTION, record.data(), record.size(), batch));
+    TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_JSON, record.data(), record.size(), batch));
+    TEST_ASSERT_FALSE(decodeBatchRecord(RECORD_MSGPACK, record.data(), record.size(), batch));
+  }
+}
+
+static void test_saturate16() {
+  TEST_ASSERT_EQUAL_UINT16(0, saturate16(0));
+  TEST_ASSERT_EQUAL_UINT16(65535, saturate16(65535));
+  TEST_ASSERT_EQUAL_UINT16(65535, saturate16(65536));
+  TEST_ASSERT_EQUAL_UINT16(65535, saturate16(0xFFFFFFFFu));
+}
+
+// Détection et session : la longueur doit être exactement celle du type
+static void test_motion_record() {
+  MotionRecord current = {77, 99, 1};
+  MotionRecord record;
+  TEST_ASSERT_TRUE(decodeMotionRecord(RECORD_MOTION, (const uint8_t*)&current, sizeof(current), record));
+  TEST_ASSERT_TRUE(record.seq == 77);
+  TEST_ASSERT_EQUAL_UINT32(99, record.timestampMs);
+  TEST_ASSERT_EQUAL_UINT8(1, record.sensor);
+
+  uint8_t longer[sizeof(current) + sizeof(PackedBatchEntry)] = {};
+  memcpy(longer, &current, sizeof(current));
+  TEST_ASSERT_FALSE(decodeMotionRecord(RECORD_MOTION, longer, sizeof(longer), record));
+  TEST_ASSERT_FALSE(decodeMotionRecord(RECORD_MOTION, longer, sizeof(current) - 1, record));
+  TEST_ASSERT_FALSE(decodeMotionRecord(RECORD_MOTION_BATCH, longer, sizeof(current), record));
+  TEST_ASSERT_FALSE(decodeMotionRecord(RECORD_SESSION, (const uint8_t*)&current, sizeof(current), record));
+}
+
+static void test_session_record() {
+  SessionRecord current = {55, 1700000000, 500, 60000, 12, 3, 0x5, 1};
+  SessionRecord record;
+  TEST_ASSERT_TRUE(decodeSessionRecord(RECORD_SESSION, (const uint8_t*)&current, sizeof(current), record));
+  TEST_ASSERT_TRUE(record.seq == 55);
+  TEST_ASSERT_EQUAL_UINT32(1700000000, record.startEpoch);
+  TEST_ASSERT_EQUAL_UINT32(60000, record.dwellMs);
+  TEST_ASSERT_EQUAL_UINT16(12, record.detections);
+  TEST_ASSERT_EQUAL_UINT16(3, record.retriggers);
+  TEST_ASSERT_EQUAL_UINT32(0x5, record.sensorMask);
+  TEST_ASSERT_EQUAL_UINT8(1, record.partial);
+
+  TEST_ASSERT_FALSE(decodeSessionRecord(RECORD_SESSION, (const uint8_t*)&current, sizeof(current) - 8, record));
+  TEST_ASSERT_FALSE(decodeSessionRecord(RECORD_MOTION, (const uint8_t*)&current, sizeof(current), record));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_json_types);
+  RUN_TEST(test_read_unaligned);
+  RUN_TEST(test_batch_layout);
+  RUN_TEST(test_batch_bad_lengths);
+  RUN_TEST(test_batch_length_gives_entries);
+  RUN_TEST(test_saturate16);
+  RUN_TEST(test_motion_record);
+  RUN_TEST(test_session_record);
+  return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <unity.h>
+
+#include <string>
+
+#include "inflight_window.h"
+
+// === FENÊTRE DE PUBLICATIONS QOS 1 ===
+
+struct Tag {
+  uint32_t source;
+};
+
+typedef InflightWindow<Tag, 4, 512> Window;
+
+void setUp() {}
+void tearDown() {}
+
+static Window::Entry* add(Window& window, uint16_t packetId, const std::string& text) {
+  Tag tag;
+  tag.source = packetId * 10u;
+  return window.add(packetId, 1, (const uint8_t*)text.data(), text.size(), tag);
+}
+
+static std::string payloadText(const Window& window, size_t index) {
+  size_t length;
+  const uint8_t* data = window.payload(index, length);
+  return data ? std::string((const char*)data, length) : "";
+}
+
+static void test_add_keeps_order_and_copies_payload() {
+  Window window;
+  std::string source = "first";
+  Window::Entry* entry = add(window, 1, source);
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_FALSE(entry->sent);
+  TEST_ASSERT_FALSE(entry->acked);
+  TEST_ASSERT_EQUAL(10, entry->tag.source);
+  source = "XXXXX";
+  add(window, 2, "second");
+  TEST_ASSERT_EQUAL(2, window.size());
+  TEST_ASSERT_EQUAL_STRING("first", payloadText(window, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("second", payloadText(window, 1).c_str());
+  TEST_ASSERT_EQUAL(2, window[1].packetId);
+  TEST_ASSERT_TRUE(window.contains(2));
+  TEST_ASSERT_FALSE(window.contains(3));
+}
+
+// inflightWindow du Device Twin : borné par la capacité
+static void test_limit() {
+  Window window;
+  window.setLimit(2);
+  TEST_ASSERT_NOT_NULL(add(window, 1, "a"));
+  TEST_ASSERT_NOT_NULL(add(window, 2, "b"));
+  TEST_ASSERT_FALSE(window.canAdd(1));
+  TEST_ASSERT_NULL(add(window, 3, "c"));
+  TEST_ASSERT_EQUAL(2, window.size());
+
+  window.setLimit(100);
+  TEST_ASSERT_EQUAL(4, window.limit());
+  TEST_ASSERT_NOT_NULL(add(window, 3, "c"));
+  TEST_ASSERT_NOT_NULL(add(window, 4, "d"));
+  TEST_ASSERT_NULL(add(window, 5, "e"));
+}
+
+// Payloads trop gros pour le pool : pleine avant la limite
+static void test_pool_full() {
+  Window window;
+  std::string big(200, 'p');
+  TEST_ASSERT_NOT_NULL(add(window, 1, big));
+  TEST_ASSERT_NOT_NULL(add(window, 2, big));
+  TEST_ASSERT_FALSE(window.canAdd(big.size()));
+  TEST_ASSERT_NULL(add(window, 3, big));
+  TEST_ASSERT_EQUAL(2, window.size());
+  TEST_ASSERT_NOT_NULL(add(window, 3, "small"));
+
+  window.ack(1);
+  window.pop();
+  TEST_ASSERT_NOT_NULL(add(window, 4, big));
+  TEST_ASSERT_EQUAL_STRING("small", payloadText(window, 1).c_str());
+}
+
+// Un PUBACK en avance attend que les messages qui le précèdent soient acquittés
+static void test_out_of_order_ack() {
+  Window window;
+  add(window, 1, "a");
+  add(window, 2, "b");
+  add(window, 3, "c");
+  TEST_ASSERT_NOT_NULL(window.ack(2));
+  TEST_ASSERT_FALSE(window.frontAcked());
+
+  TEST_ASSERT_NOT_NULL(window.ack(1));
+  TEST_ASSERT_TRUE(window.frontAcked());
+  TEST_ASSERT_EQUAL(10, window.front().tag.source);
+  window.pop();
+  TEST_ASSERT_TRUE(window.frontAcked());
+  TEST_ASSERT_EQUAL(2, window.front().packetId);
+  window.pop();
+  TEST_ASSERT_FALSE(window.frontAcked());
+  TEST_ASSERT_EQUAL_STRING("c", payloadText(window, 0).c_str());
+}
+
+static void test_unknown_and_duplicate_ack() {
+  Window window;
+  add(window, 7, "a");
+  TEST_ASSERT_NULL(window.ack(8));
+  TEST_ASSERT_NOT_NULL(window.ack(7));
+  TEST_ASSERT_NULL(window.ack(7));
+  window.pop();
+  TEST_ASSERT_TRUE(window.empty());
+  window.pop();
+  TEST_ASSERT_TRUE(window.empty());
+  TEST_ASSERT_EQUAL(0, window.bytesUsed());
+}
+
+// Délai de PUBACK : seuls les messages envoyés et non acquittés comptent
+static void test_oldest_unacked() {
+  Window window;
+  uint32_t sentMs = 0;
+  add(window, 1, "a");
+  add(window, 2, "b");
+  add(window, 3, "c");
+  TEST_ASSERT_FALSE(window.oldestUnacked(sentMs));
+
+  window[0].sent = true;
+  window[0].sentMs = 100;
+  window[1].sent = true;
+  window[1].sentMs = 200;
+  TEST_ASSERT_TRUE(window.oldestUnacked(sentMs));
+  TEST_ASSERT_EQUAL_UINT32(100, sentMs);
+
+  window.ack(1);
+  TEST_ASSERT_TRUE(window.oldestUnacked(sentMs));
+  TEST_ASSERT_EQUAL_UINT32(200, sentMs);
+
+  // Coupure : à republier, plus en attente de PUBACK
+  window[1].sent = false;
+  TEST_ASSERT_FALSE(window.oldestUnacked(sentMs));
+}
+
+// Entrées et pool circulaires : l'ordre et les payloads tiennent au fil des tours
+static void test_wraps_around() {
+  Window window;
+  uint16_t nextId = 1;
+  uint16_t expected = 1;
+  for (int round = 0; round < 50; round++) {
+    while (add(window, nextId, "message " + std::to_string(nextId)) != nullptr) {
+      nextId++;
+    }
+    size_t acks = 1 + round % 3;
+    for (size_t i = 0; i < acks && !window.empty(); i++) {
+      TEST_ASSERT_EQUAL(expected, window.front().packetId);
+      TEST_ASSERT_EQUAL_STRING(("message " + std::to_string(expected)).c_str(), payloadText(window, 0).c_str());
+      window.ack(expected);
+      window.pop();
+      expected++;
+    }
+  }
+  TEST_ASSERT_EQUAL(nextId - expected, window.size());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_add_keeps_order_and_copies_payload);
+  RUN_TEST(test_limit);
+  RUN_TEST(test_pool_full);
+  RUN_TEST(test_out_of_order_ack);
+  RUN_TEST(test_unknown_and_duplicate_ack);
+  RUN_TEST(test_oldest_unacked);
+  RUN_TEST(test_wraps_around);
+  return UNITY_END();
+}
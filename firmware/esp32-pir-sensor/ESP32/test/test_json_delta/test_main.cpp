@@ -0,0 +1,155 @@
+#include <unity.h>
+
+#include "json_delta.h"
+
+// === DIFFÉRENCES ENTRE DOCUMENTS JSON ===
+
+static const DeltaThreshold THRESHOLDS[] = {
+  {"rssi", 5.0f, 0.0f},
+  {"freeHeap", 4096.0f, 0.0f},
+  {"uptime", 0.0f, 0.25f},
+};
+static const JsonDelta delta(THRESHOLDS, sizeof(THRESHOLDS) / sizeof(THRESHOLDS[0]));
+
+void setUp() {}
+void tearDown() {}
+
+static void parse(JsonDocument& doc, const char* json) {
+  TEST_ASSERT_TRUE(deserializeJson(doc, json) == DeserializationError::Ok);
+}
+
+static void test_identical_documents_give_empty_patch() {
+  StaticJsonDocument<256> current, shadow, patch;
+  parse(current, "{\"a\":1,\"b\":\"x\",\"n\":{\"c\":true}}");
+  parse(shadow, "{\"a\":1,\"b\":\"x\",\"n\":{\"c\":true}}");
+  TEST_ASSERT_EQUAL(0, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  TEST_ASSERT_EQUAL(0, patch.size());
+}
+
+static void test_only_changed_members() {
+  StaticJsonDocument<256> current, shadow, patch;
+  parse(current, "{\"a\":2,\"b\":\"x\",\"c\":false}");
+  parse(shadow, "{\"a\":1,\"b\":\"x\",\"c\":true}");
+  TEST_ASSERT_EQUAL(2, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  TEST_ASSERT_EQUAL(2, patch["a"].as<int>());
+  TEST_ASSERT_FALSE(patch["c"].as<bool>());
+  TEST_ASSERT_FALSE(patch.containsKey("b"));
+}
+
+// Un objet imbriqué ne porte que ses membres modifiés, et disparaît s'il n'a pas changé
+static void test_nested_objects() {
+  StaticJsonDocument<512> current, shadow, patch;
+  parse(current, "{\"n\":{\"x\":1,\"y\":3},\"m\":{\"z\":1}}");
+  parse(shadow, "{\"n\":{\"x\":1,\"y\":2},\"m\":{\"z\":1}}");
+  TEST_ASSERT_EQUAL(1, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  TEST_ASSERT_EQUAL(1, patch["n"].size());
+  TEST_ASSERT_EQUAL(3, patch["n"]["y"].as<int>());
+  TEST_ASSERT_FALSE(patch.containsKey("m"));
+}
+
+static void test_removed_member_is_null() {
+  StaticJsonDocument<256> current, shadow, patch;
+  parse(current, "{\"a\":1}");
+  parse(shadow, "{\"a\":1,\"gone\":5}");
+  TEST_ASSERT_EQUAL(1, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  TEST_ASSERT_TRUE(patch.containsKey("gone"));
+  TEST_ASSERT_TRUE(patch["gone"].isNull());
+}
+
+static void test_new_member_is_sent() {
+  StaticJsonDocument<256> current, shadow, patch;
+  parse(current, "{\"a\":1,\"rssi\":-70}");
+  parse(shadow, "{\"a\":1}");
+  TEST_ASSERT_EQUAL(1, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  TEST_ASSERT_EQUAL(-70, patch["rssi"].as<int>());
+}
+
+static void test_absolute_threshold() {
+  StaticJsonDocument<256> current, shadow, patch;
+  parse(shadow, "{\"rssi\":-70,\"freeHeap\":100000}");
+  parse(current, "{\"rssi\":-74,\"freeHeap\":97000}");
+  TEST_ASSERT_EQUAL(0, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  parse(current, "{\"rssi\":-76,\"freeHeap\":95000}");
+  TEST_ASSERT_EQUAL(2, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+}
+
+static void test_relative_threshold() {
+  StaticJsonDocument<256> current, shadow, patch;
+  parse(shadow, "{\"uptime\":1000}");
+  parse(current, "{\"uptime\":1200}");
+  TEST_ASSERT_EQUAL(0, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  parse(current, "{\"uptime\":1300}");
+  TEST_ASSERT_EQUAL(1, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+}
+
+// Un membre sans seuil compare les chaînes et booléens par valeur
+static void test_threshold_ignores_non_numbers() {
+  StaticJsonDocument<256> current, shadow, patch;
+  parse(shadow, "{\"rssi\":\"n/a\"}");
+  parse(current, "{\"rssi\":-70}");
+  TEST_ASSERT_EQUAL(1, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+}
+
+// Sous le seuil, la shadow garde la valeur transmise : la dérive lente finit par partir
+static void test_settle_keeps_sent_values() {
+  StaticJsonDocument<512> current, shadow, patch;
+  parse(shadow, "{\"rssi\":-70,\"a\":1,\"n\":{\"freeHeap\":100000,\"b\":1}}");
+  parse(current, "{\"rssi\":-73,\"a\":2,\"n\":{\"freeHeap\":98000,\"b\":2}}");
+  delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(), patch.to<JsonObject>());
+  JsonDelta::settle(current.as<JsonObject>(), shadow.as<JsonObjectConst>(), patch.as<JsonObjectConst>());
+  TEST_ASSERT_EQUAL(-70, current["rssi"].as<int>());
+  TEST_ASSERT_EQUAL(2, current["a"].as<int>());
+  TEST_ASSERT_EQUAL(100000, current["n"]["freeHeap"].as<long>());
+  TEST_ASSERT_EQUAL(2, current["n"]["b"].as<int>());
+
+  shadow.set(current);
+  parse(current, "{\"rssi\":-76,\"a\":2,\"n\":{\"freeHeap\":98000,\"b\":2}}");
+  TEST_ASSERT_EQUAL(1, delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(),
+                                  patch.to<JsonObject>()));
+  TEST_ASSERT_EQUAL(-76, patch["rssi"].as<int>());
+}
+
+// Le patch appliqué à la shadow redonne l'état courant (hors seuils)
+static void test_patch_applied_to_shadow_matches_current() {
+  StaticJsonDocument<512> current, shadow, patch;
+  parse(shadow, "{\"a\":1,\"s\":\"old\",\"n\":{\"x\":1,\"y\":2},\"gone\":3}");
+  parse(current, "{\"a\":1,\"s\":\"new\",\"n\":{\"x\":1,\"y\":5},\"added\":true}");
+  delta.diff(current.as<JsonObjectConst>(), shadow.as<JsonObjectConst>(), patch.to<JsonObject>());
+  for (JsonPair kv : patch.as<JsonObject>()) {
+    if (kv.value().isNull()) {
+      shadow.remove(kv.key());
+    } else if (kv.value().is<JsonObject>()) {
+      for (JsonPair nested : kv.value().as<JsonObject>()) {
+        shadow[kv.key()][nested.key()] = nested.value();
+      }
+    } else {
+      shadow[kv.key()] = kv.value();
+    }
+  }
+  TEST_ASSERT_TRUE(shadow == current);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_identical_documents_give_empty_patch);
+  RUN_TEST(test_only_changed_members);
+  RUN_TEST(test_nested_objects);
+  RUN_TEST(test_removed_member_is_null);
+  RUN_TEST(test_new_member_is_sent);
+  RUN_TEST(test_absolute_threshold);
+  RUN_TEST(test_relative_threshold);
+  RUN_TEST(test_threshold_ignores_non_numbers);
+  RUN_TEST(test_settle_keeps_sent_values);
+  RUN_TEST(test_patch_applied_to_shadow_matches_current);
+  return UNITY_END();
+}
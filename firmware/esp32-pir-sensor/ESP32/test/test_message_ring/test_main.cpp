@@ -0,0 +1,163 @@
+#include <unity.h>
+
+#include <deque>
+#include <random>
+#include <string>
+
+#include "message_ring.h"
+
+// === FILE DE MESSAGES EN ATTENTE ===
+
+static MessageRingBase::PushResult pushText(MessageRingBase& ring, uint8_t type, const std::string& text,
+                                            uint32_t timestampMs = 0) {
+  return ring.push(type, (const uint8_t*)text.data(), text.size(), timestampMs);
+}
+
+static std::string frontText(const MessageRingBase& ring) {
+  return std::string((const char*)ring.frontPayload(), ring.front().length);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_fifo_and_metadata() {
+  MessageRing<256> ring;
+  TEST_ASSERT_TRUE(ring.empty());
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 1, "alpha", 100));
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 3, "beta", 200));
+  TEST_ASSERT_EQUAL(2, ring.size());
+  TEST_ASSERT_EQUAL(MessageRingBase::recordSize(5) + MessageRingBase::recordSize(4), ring.bytesUsed());
+
+  MessageSlot slot;
+  const uint8_t* payload;
+  TEST_ASSERT_TRUE(ring.peekAt(1, slot, payload));
+  TEST_ASSERT_EQUAL_UINT8(3, slot.type);
+  TEST_ASSERT_EQUAL_UINT32(200, slot.timestampMs);
+  TEST_ASSERT_EQUAL_MEMORY("beta", payload, 4);
+  TEST_ASSERT_FALSE(ring.peekAt(2, slot, payload));
+
+  TEST_ASSERT_EQUAL_UINT8(1, ring.front().type);
+  TEST_ASSERT_EQUAL_STRING("alpha", frontText(ring).c_str());
+  ring.pop();
+  TEST_ASSERT_EQUAL_STRING("beta", frontText(ring).c_str());
+  ring.pop();
+  TEST_ASSERT_TRUE(ring.empty());
+  TEST_ASSERT_EQUAL(0, ring.bytesUsed());
+}
+
+// Record de 4 octets minimum d'alignement : un petit enregistrement ne
+// coûte que son en-tête et son payload arrondi
+static void test_record_size() {
+  TEST_ASSERT_EQUAL(8, MessageRingBase::recordSize(0));
+  TEST_ASSERT_EQUAL(12, MessageRingBase::recordSize(1));
+  TEST_ASSERT_EQUAL(12, MessageRingBase::recordSize(4));
+  TEST_ASSERT_EQUAL(32, MessageRingBase::recordSize(24));
+}
+
+static void test_drop_oldest() {
+  MessageRing<64> ring(EVICT_DROP_OLDEST);
+  std::string payload(20, 'a');
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 0, payload));
+  payload[0] = 'b';
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 0, payload));
+  payload[0] = 'c';
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_DROPPED_OLDEST, pushText(ring, 0, payload));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.dropped());
+  TEST_ASSERT_EQUAL(2, ring.size());
+  TEST_ASSERT_EQUAL('b', frontText(ring)[0]);
+}
+
+static void test_drop_newest() {
+  MessageRing<64> ring(EVICT_DROP_NEWEST);
+  std::string payload(20, 'a');
+  pushText(ring, 0, payload);
+  pushText(ring, 0, payload);
+  TEST_ASSERT_FALSE(ring.fits(20));
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_DROPPED_NEWEST, pushText(ring, 0, "x"));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.dropped());
+  TEST_ASSERT_EQUAL(2, ring.size());
+}
+
+static void test_keep_latest() {
+  MessageRing<128> ring(EVICT_KEEP_LATEST);
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 2, "status-1"));
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_REPLACED, pushText(ring, 2, "status-2"));
+  TEST_ASSERT_EQUAL(1, ring.size());
+  TEST_ASSERT_EQUAL_UINT32(1, ring.replaced());
+  TEST_ASSERT_EQUAL_STRING("status-2", frontText(ring).c_str());
+}
+
+static void test_too_large() {
+  MessageRing<64> ring;
+  std::string payload(ring.payloadCapacity() + 1, 'z');
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_TOO_LARGE, pushText(ring, 0, payload));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.tooLarge());
+  TEST_ASSERT_TRUE(ring.empty());
+  payload.pop_back();
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 0, payload));
+}
+
+// File du statut : dimensionnée par la taille du message, pas par celle d'un paquet MQTT
+static void test_ring_sized_for_payload() {
+  const size_t STATUS_MAX = 1536;
+  MessageRing<MessageRingBase::recordSize(STATUS_MAX)> ring(EVICT_KEEP_LATEST);
+  TEST_ASSERT_TRUE(ring.payloadCapacity() >= STATUS_MAX);
+  std::string first(1275, 'a');
+  std::string second(STATUS_MAX, 'b');
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 4, first));
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_REPLACED, pushText(ring, 4, second));
+  TEST_ASSERT_EQUAL(1, ring.size());
+  TEST_ASSERT_EQUAL(STATUS_MAX, ring.front().length);
+  TEST_ASSERT_EQUAL_UINT32(0, ring.tooLarge());
+}
+
+// Un message n'est jamais coupé en fin d'anneau
+static void test_wrap_keeps_messages_contiguous() {
+  MessageRing<96> ring(EVICT_DROP_NEWEST);
+  std::string a(28, 'a'), b(28, 'b'), c(28, 'c');
+  pushText(ring, 0, a);  // 36 octets
+  pushText(ring, 0, b);  // 72 octets
+  ring.pop();            // Libère le début
+  TEST_ASSERT_TRUE(ring.fits(28));
+  TEST_ASSERT_EQUAL(MessageRingBase::PUSH_OK, pushText(ring, 0, c));
+  TEST_ASSERT_EQUAL_STRING(b.c_str(), frontText(ring).c_str());
+  ring.pop();
+  TEST_ASSERT_EQUAL_STRING(c.c_str(), frontText(ring).c_str());
+}
+
+// Suite aléatoire d'ajouts et de retraits comparée à une file de référence
+static void test_random_against_model() {
+  MessageRing<512> ring(EVICT_DROP_NEWEST);
+  std::deque<std::string> model;
+  std::mt19937 rng(7);
+  for (int i = 0; i < 20000; i++) {
+    if (rng() % 3 != 0) {
+      std::string payload(rng() % 60, (char)('a' + i % 26));
+      bool fits = ring.fits(payload.size());
+      MessageRingBase::PushResult result = pushText(ring, (uint8_t)(i & 0xFF), payload, (uint32_t)i);
+      TEST_ASSERT_EQUAL(fits, result == MessageRingBase::PUSH_OK);
+      if (result == MessageRingBase::PUSH_OK) {
+        model.push_back(payload);
+      }
+    } else if (!model.empty()) {
+      TEST_ASSERT_EQUAL_STRING(model.front().c_str(), frontText(ring).c_str());
+      ring.pop();
+      model.pop_front();
+    }
+    TEST_ASSERT_EQUAL(model.size(), ring.size());
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fifo_and_metadata);
+  RUN_TEST(test_record_size);
+  RUN_TEST(test_drop_oldest);
+  RUN_TEST(test_drop_newest);
+  RUN_TEST(test_keep_latest);
+  RUN_TEST(test_too_large);
+  RUN_TEST(test_ring_sized_for_payload);
+  RUN_TEST(test_wrap_keeps_messages_contiguous);
+  RUN_TEST(test_random_against_model);
+  return UNITY_END();
+}
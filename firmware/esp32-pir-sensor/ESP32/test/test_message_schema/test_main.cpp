@@ -0,0 +1,488 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "message_schema.h"
+#include "../host/telemetry_decoder.h"
+
+// === MESSAGES GÉNÉRÉS : ALLER-RETOUR ENCODAGE → DÉCODAGE ===
+
+void setUp() {}
+void tearDown() {}
+
+static std::string toJson(const JsonDocument& doc) {
+  std::string text;
+  serializeJson(doc, text);
+  return text;
+}
+
+static std::vector<uint8_t> toMsgPack(const JsonDocument& doc) {
+  std::vector<uint8_t> bytes(measureMsgPack(doc));
+  TEST_ASSERT_EQUAL(bytes.size(), serializeMsgPack(doc, bytes.data(), bytes.size()));
+  return bytes;
+}
+
+// Encodé, sérialisé (JSON puis MessagePack), relu avec la capacité XXX_PARSE_SIZE
+// et décodé : chaque champ revient à l'identique
+template <typename M>
+static void checkRoundTrip(const M& message, size_t docSize, size_t parseSize) {
+  DynamicJsonDocument doc(docSize);
+  TEST_ASSERT_TRUE(encodeMessage(message, doc));
+
+  DynamicJsonDocument back(parseSize);
+  M decoded;
+  std::string json = toJson(doc);
+  TEST_ASSERT_TRUE(deserializeJson(back, json) == DeserializationError::Ok);
+  TEST_ASSERT_TRUE(decodeMessage(back.as<JsonObjectConst>(), decoded));
+  TEST_ASSERT_TRUE(decoded == message);
+
+  std::vector<uint8_t> packed = toMsgPack(doc);
+  TEST_ASSERT_TRUE(deserializeMsgPack(back, (const char*)packed.data(), packed.size()) == DeserializationError::Ok);
+  TEST_ASSERT_TRUE(decodeMessage(back.as<JsonObjectConst>(), decoded));
+  TEST_ASSERT_TRUE(decoded == message);
+}
+
+// Même aller-retour côté backend, aiguillé sur "event" et $.ct
+template <typename M>
+static void checkHostDecoder(const M& message, size_t docSize, TelemetryKind kind,
+                             const M& (*field)(const TelemetryDecoder&)) {
+  DynamicJsonDocument doc(docSize);
+  TEST_ASSERT_TRUE(encodeMessage(message, doc));
+  TelemetryDecoder decoder;
+
+  std::string json = toJson(doc);
+  TEST_ASSERT_EQUAL(kind, decoder.decode("application/json", json.data(), json.size()));
+  TEST_ASSERT_TRUE(field(decoder) == message);
+
+  std::vector<uint8_t> packed = toMsgPack(doc);
+  TEST_ASSERT_EQUAL(kind, decoder.decode("application/msgpack", packed.data(), packed.size()));
+  TEST_ASSERT_TRUE(field(decoder) == message);
+}
+
+// --- Messages d'exemple : toutes les options présentes ---
+
+static MotionMessage fullMotion() {
+  MotionMessage message;
+  message.seq = 0x123456789ULL;
+  message.ts = 123456;
+  message.sensor = 3;
+  message.hasTime = true;
+  message.time = 1700000000;
+  message.hasWakeToPublishMs = true;
+  message.wakeToPublishMs = 850;
+  return message;
+}
+
+static MotionBatchMessage fullBatch() {
+  MotionBatchMessage message;
+  message.seq = 18;
+  message.ts = 200000;
+  for (size_t i = 0; i < MOTION_BATCH_MESSAGE_DETECTIONS_MAX; i++) {
+    message.detections[i].ts = 100000 + (uint32_t)i * 250;
+    message.detections[i].sensor = (uint8_t)(i % 4);
+  }
+  message.detectionsCount = MOTION_BATCH_MESSAGE_DETECTIONS_MAX;
+  return message;
+}
+
+static SessionMessage fullSession() {
+  SessionMessage message;
+  message.seq = 19;
+  message.hasStart = true;
+  message.start = 1700000000;
+  message.startMs = 5000;
+  message.dwell = 90000;
+  message.detections = 7;
+  message.retriggers = 3;
+  message.sensors = 0x5;
+  message.hasPartial = true;
+  message.partial = true;
+  return message;
+}
+
+static StatusMessage fullStatus() {
+  StatusMessage status;
+  status.hasSeq = true;
+  status.seq = 1234;
+  status.firmware = "2.0.0";
+  status.uptime = 86400;
+  status.detectionEnabled = true;
+  status.cooldown = 5000;
+  status.detectionCount = 42;
+  status.sessionCount = 9;
+  status.occupied = true;
+  status.powerMode = "modem";
+  StatusSystem& system = status.system;
+  system.rssi = -61;
+  system.hasRssiMin = true;
+  system.rssiMin = -75;
+  system.hasRssiMax = true;
+  system.rssiMax = -50;
+  system.hasRssiAvg = true;
+  system.rssiAvg = -62;
+  system.freeHeap = 206624;
+  system.minFreeHeap = 180000;
+  system.cpuFreq = 240;
+  system.buffered = 12;
+  system.bufferDropped = 1;
+  system.wifiReconnects = 3;
+  system.mqttReconnects = 4;
+  system.failedPublishes = 5;
+  system.unreadableRecords = 6;
+  system.pirEdgesDropped = 7;
+  system.seqNvsWrites = 8;
+  system.hasAvgPublishCycles = true;
+  system.avgPublishCycles = 120000;
+  system.hasMaxPublishCycles = true;
+  system.maxPublishCycles = 480000;
+  system.hasTlsWritesPerPublish = true;
+  system.tlsWritesPerPublish = 1.25f;
+  system.wakeupsPerSec = 0.4f;
+  system.maxWakeLatencyUs = 900;
+  system.avgWakeLatencyUs = 40;
+  system.hasAvgDetectionPublishUs = true;
+  system.avgDetectionPublishUs = 3500;
+  system.hasMaxDetectionPublishUs = true;
+  system.maxDetectionPublishUs = 12000;
+  system.hasDrainRate = true;
+  system.drainRate = 9.5f;
+  system.hasMaxPirGapUs = true;
+  system.maxPirGapUs = 2100;
+  system.hasMaxConnectGapUs = true;
+  system.maxConnectGapUs = 4200;
+  system.hasListenInterval = true;
+  system.listenInterval = 3;
+  system.hasSleepWakes = true;
+  system.sleepWakes = 17;
+  system.hasWakeToPublishMs = true;
+  system.wakeToPublishMs = 850;
+  system.hasWakeEventsDropped = true;
+  system.wakeEventsDropped = 2;
+  system.hasInflight = true;
+  system.inflight = 4;
+  system.hasAvgAckMs = true;
+  system.avgAckMs = 95;
+  system.lanes.twin.pending = 1;
+  system.lanes.session.pending = 2;
+  system.lanes.session.dropped = 3;
+  system.lanes.health.dropped = 4;
+  system.lanes.motion.pending = 5;
+  system.lanes.motion.dropped = 6;
+  system.hasOutbox = true;
+  system.outbox.segments = 352;
+  system.outbox.erases = 1000;
+  system.outbox.corrupt = 1;
+  system.outbox.writeAmp = 1.125f;
+  return status;
+}
+
+static TwinReportedMessage fullTwinReported() {
+  TwinReportedMessage message;
+  message.firmware = "2.0.0";
+  message.uptime = 3600;
+  message.detectionEnabled = true;
+  message.cooldown = 5000;
+  message.minPulse = 50;
+  message.mergeWindow = 300;
+  message.riseHold = 20;
+  message.fallHold = 40;
+  message.sessionMode = true;
+  message.idleTimeout = 120000;
+  message.adaptiveCooldown = true;
+  message.maxMessagesPerHour = 120;
+  message.effectiveCooldown = 20000;
+  message.batchWindow = 2000;
+  message.powerMode = "light";
+  message.c2dLatency = 1000;
+  message.encoding = "msgpack";
+  message.inflightWindow = 4;
+  message.detectionCount = 42;
+  message.interArrival.ewma = 30000;
+  message.interArrival.p50 = 25000;
+  message.interArrival.p90 = 90000;
+  message.interArrival.samples = 64;
+  message.system.rssi = -61;
+  message.system.freeHeap = 206624;
+  message.system.cpuFreq = 80;
+  message.system.buffered = 3;
+  return message;
+}
+
+static TwinDesiredMessage fullTwinDesired() {
+  TwinDesiredMessage message;
+  message.hasDetectionEnabled = true;
+  message.detectionEnabled = true;
+  message.hasCooldown = true;
+  message.cooldown = 5000;
+  message.hasSessionMode = true;
+  message.sessionMode = true;
+  message.hasIdleTimeout = true;
+  message.idleTimeout = 120000;
+  message.hasAdaptiveCooldown = true;
+  message.adaptiveCooldown = true;
+  message.hasMaxMessagesPerHour = true;
+  message.maxMessagesPerHour = 120;
+  message.hasBatchWindow = true;
+  message.batchWindow = 2000;
+  message.hasMinPulse = true;
+  message.minPulse = 50;
+  message.hasMergeWindow = true;
+  message.mergeWindow = 300;
+  message.hasRiseHold = true;
+  message.riseHold = 20;
+  message.hasFallHold = true;
+  message.fallHold = 40;
+  message.hasPowerMode = true;
+  message.powerMode = "modem";
+  message.hasC2dLatency = true;
+  message.c2dLatency = 1000;
+  message.hasEncoding = true;
+  message.encoding = "json";
+  message.hasInflightWindow = true;
+  message.inflightWindow = 16;
+  return message;
+}
+
+static C2dCommandMessage fullC2d() {
+  C2dCommandMessage message;
+  message.command = "setCooldown";
+  message.hasValue = true;
+  message.value = 8000;
+  return message;
+}
+
+// --- Aller-retour ---
+
+static void test_motion() {
+  checkRoundTrip(fullMotion(), MOTION_MESSAGE_DOC_SIZE, MOTION_MESSAGE_PARSE_SIZE);
+  MotionMessage minimal;
+  minimal.seq = 1;
+  checkRoundTrip(minimal, MOTION_MESSAGE_DOC_SIZE, MOTION_MESSAGE_PARSE_SIZE);
+}
+
+static void test_motion_batch() {
+  checkRoundTrip(fullBatch(), MOTION_BATCH_MESSAGE_DOC_SIZE, MOTION_BATCH_MESSAGE_PARSE_SIZE);
+  checkRoundTrip(MotionBatchMessage(), MOTION_BATCH_MESSAGE_DOC_SIZE, MOTION_BATCH_MESSAGE_PARSE_SIZE);
+}
+
+static void test_session() {
+  checkRoundTrip(fullSession(), SESSION_MESSAGE_DOC_SIZE, SESSION_MESSAGE_PARSE_SIZE);
+  checkRoundTrip(SessionMessage(), SESSION_MESSAGE_DOC_SIZE, SESSION_MESSAGE_PARSE_SIZE);
+}
+
+static void test_status() {
+  checkRoundTrip(fullStatus(), STATUS_MESSAGE_DOC_SIZE, STATUS_MESSAGE_PARSE_SIZE);
+  StatusMessage minimal;
+  minimal.firmware = "2.0.0";
+  minimal.powerMode = "none";
+  checkRoundTrip(minimal, STATUS_MESSAGE_DOC_SIZE, STATUS_MESSAGE_PARSE_SIZE);
+}
+
+static void test_twin_reported() {
+  checkRoundTrip(fullTwinReported(), TWIN_REPORTED_MESSAGE_DOC_SIZE, TWIN_REPORTED_MESSAGE_PARSE_SIZE);
+}
+
+static void test_twin_desired() {
+  checkRoundTrip(fullTwinDesired(), TWIN_DESIRED_MESSAGE_DOC_SIZE, TWIN_DESIRED_MESSAGE_PARSE_SIZE);
+  checkRoundTrip(TwinDesiredMessage(), TWIN_DESIRED_MESSAGE_DOC_SIZE, TWIN_DESIRED_MESSAGE_PARSE_SIZE);
+}
+
+static void test_c2d_command() {
+  checkRoundTrip(fullC2d(), C2D_COMMAND_MESSAGE_DOC_SIZE, C2D_COMMAND_MESSAGE_PARSE_SIZE);
+  C2dCommandMessage getStatus;
+  getStatus.command = "getStatus";
+  checkRoundTrip(getStatus, C2D_COMMAND_MESSAGE_DOC_SIZE, C2D_COMMAND_MESSAGE_PARSE_SIZE);
+}
+
+// L'égalité générée voit chaque champ (sinon l'aller-retour ne prouverait rien)
+static void test_equality_sees_every_field() {
+  StatusMessage changed = fullStatus();
+  TEST_ASSERT_TRUE(changed == fullStatus());
+  changed.system.outbox.writeAmp = 1.5f;
+  TEST_ASSERT_TRUE(changed != fullStatus());
+
+  std::string copy = "2.0.0";
+  changed = fullStatus();
+  changed.firmware = copy.c_str();
+  TEST_ASSERT_TRUE(changed == fullStatus());
+
+  MotionBatchMessage batch = fullBatch();
+  batch.detections[31].sensor = 0;
+  TEST_ASSERT_TRUE(batch != fullBatch());
+
+  // Option absente : sa valeur n'est pas comparée
+  MotionMessage motion = fullMotion();
+  MotionMessage other = motion;
+  motion.hasTime = other.hasTime = false;
+  other.time = 1;
+  TEST_ASSERT_TRUE(motion == other);
+}
+
+// --- Décodeur backend ---
+
+static const MotionMessage& motionOf(const TelemetryDecoder& decoder) { return decoder.motion; }
+static const MotionBatchMessage& batchOf(const TelemetryDecoder& decoder) { return decoder.motionBatch; }
+static const SessionMessage& sessionOf(const TelemetryDecoder& decoder) { return decoder.session; }
+static const StatusMessage& statusOf(const TelemetryDecoder& decoder) { return decoder.status; }
+
+static void test_host_decoder() {
+  checkHostDecoder(fullMotion(), MOTION_MESSAGE_DOC_SIZE, TELEMETRY_MOTION, motionOf);
+  checkHostDecoder(fullBatch(), MOTION_BATCH_MESSAGE_DOC_SIZE, TELEMETRY_MOTION_BATCH, batchOf);
+  checkHostDecoder(fullSession(), SESSION_MESSAGE_DOC_SIZE, TELEMETRY_SESSION, sessionOf);
+  checkHostDecoder(fullStatus(), STATUS_MESSAGE_DOC_SIZE, TELEMETRY_STATUS, statusOf);
+
+  StaticJsonDocument<TWIN_REPORTED_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(encodeMessage(fullTwinReported(), doc));
+  std::string json = toJson(doc);
+  TelemetryDecoder decoder;
+  TEST_ASSERT_TRUE(decoder.decodeTwinReported(json.data(), json.size()));
+  TEST_ASSERT_TRUE(decoder.twinReported == fullTwinReported());
+}
+
+// --- Filtres de désérialisation (messages reçus) ---
+
+// Désérialisation en place (char* modifiable), comme dans le buffer de PubSubClient
+template <typename D>
+static bool parseInPlace(D& doc, std::string& payload, const JsonDocument& filter) {
+  return deserializeJson(doc, &payload[0], payload.size(), DeserializationOption::Filter(filter)) ==
+         DeserializationError::Ok;
+}
+
+// Patch desired d'IoT Hub : $version et les champs inconnus n'occupent rien
+static void test_twin_desired_filter() {
+  StaticJsonDocument<TWIN_DESIRED_MESSAGE_FILTER_SIZE> filter;
+  buildTwinDesiredFilter(filter.to<JsonObject>());
+  std::string payload =
+      "{\"cooldown\":8000,\"riseHold\":20,\"fallHold\":40,\"powerMode\":\"light\","
+      "\"unknownSetting\":{\"nested\":[1,2,3,4,5,6,7,8]},\"$version\":12}";
+  StaticJsonDocument<TWIN_DESIRED_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(parseInPlace(doc, payload, filter));
+  TEST_ASSERT_FALSE(doc.containsKey("$version"));
+  TEST_ASSERT_FALSE(doc.containsKey("unknownSetting"));
+
+  TwinDesiredMessage desired;
+  TEST_ASSERT_TRUE(decodeMessage(doc.as<JsonObjectConst>(), desired));
+  TEST_ASSERT_TRUE(desired.hasCooldown && desired.cooldown == 8000);
+  TEST_ASSERT_TRUE(desired.hasRiseHold && desired.riseHold == 20);
+  TEST_ASSERT_TRUE(desired.hasFallHold && desired.fallHold == 40);
+  TEST_ASSERT_EQUAL_STRING("light", desired.powerMode);
+  TEST_ASSERT_FALSE(desired.hasDetectionEnabled);
+}
+
+// Toutes les propriétés desired tiennent dans TWIN_DESIRED_MESSAGE_DOC_SIZE
+static void test_twin_desired_filter_capacity() {
+  StaticJsonDocument<TWIN_DESIRED_MESSAGE_FILTER_SIZE> filter;
+  buildTwinDesiredFilter(filter.to<JsonObject>());
+  DynamicJsonDocument full(TWIN_DESIRED_MESSAGE_DOC_SIZE + JSON_OBJECT_SIZE(1));
+  TEST_ASSERT_TRUE(encodeMessage(fullTwinDesired(), full));
+  full["$version"] = 42;
+  std::string payload = toJson(full);
+
+  StaticJsonDocument<TWIN_DESIRED_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(parseInPlace(doc, payload, filter));
+  TwinDesiredMessage desired;
+  TEST_ASSERT_TRUE(decodeMessage(doc.as<JsonObjectConst>(), desired));
+  TEST_ASSERT_TRUE(desired == fullTwinDesired());
+}
+
+// Réponse au GET : seule la section desired est gardée, reported est écartée
+static void test_twin_get_filter() {
+  StaticJsonDocument<JSON_OBJECT_SIZE(1) + TWIN_DESIRED_MESSAGE_FILTER_SIZE> filter;
+  buildTwinDesiredFilter(filter.to<JsonObject>().createNestedObject("desired"));
+  std::string payload =
+      "{\"desired\":{\"detectionEnabled\":false,\"encoding\":\"msgpack\",\"$version\":3},"
+      "\"reported\":{\"firmware\":\"2.0.0\",\"uptime\":3600,\"cooldown\":5000,\"minPulse\":50,"
+      "\"interArrival\":{\"ewma\":1,\"p50\":2,\"p90\":3,\"samples\":4},\"$version\":90}}";
+  StaticJsonDocument<JSON_OBJECT_SIZE(1) + TWIN_DESIRED_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(parseInPlace(doc, payload, filter));
+  TEST_ASSERT_FALSE(doc.containsKey("reported"));
+  TEST_ASSERT_EQUAL(1, doc.size());
+
+  TwinDesiredMessage desired;
+  TEST_ASSERT_TRUE(decodeMessage(doc["desired"].as<JsonObjectConst>(), desired));
+  TEST_ASSERT_TRUE(desired.hasDetectionEnabled && !desired.detectionEnabled);
+  TEST_ASSERT_EQUAL_STRING("msgpack", desired.encoding);
+  TEST_ASSERT_FALSE(desired.hasCooldown);
+}
+
+// Un type inattendu rejette le message entier plutôt qu'une valeur convertie à 0
+static void test_twin_desired_wrong_type() {
+  StaticJsonDocument<TWIN_DESIRED_MESSAGE_FILTER_SIZE> filter;
+  buildTwinDesiredFilter(filter.to<JsonObject>());
+  const char* payloads[] = {"{\"cooldown\":\"fast\"}", "{\"riseHold\":-5}", "{\"inflightWindow\":300}",
+                            "{\"powerMode\":1}"};
+  for (const char* text : payloads) {
+    std::string payload = text;
+    StaticJsonDocument<TWIN_DESIRED_MESSAGE_DOC_SIZE> doc;
+    TEST_ASSERT_TRUE(parseInPlace(doc, payload, filter));
+    TwinDesiredMessage desired;
+    TEST_ASSERT_FALSE(decodeMessage(doc.as<JsonObjectConst>(), desired));
+  }
+}
+
+static void test_c2d_filter() {
+  StaticJsonDocument<C2D_COMMAND_MESSAGE_FILTER_SIZE> filter;
+  buildC2dCommandFilter(filter.to<JsonObject>());
+  std::string payload =
+      "{\"command\":\"setCooldown\",\"value\":8000,\"requestId\":\"abc-123\",\"meta\":{\"a\":1}}";
+  StaticJsonDocument<C2D_COMMAND_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(parseInPlace(doc, payload, filter));
+  TEST_ASSERT_EQUAL(2, doc.size());
+
+  C2dCommandMessage c2d;
+  TEST_ASSERT_TRUE(decodeMessage(doc.as<JsonObjectConst>(), c2d));
+  TEST_ASSERT_TRUE(c2d == fullC2d());
+}
+
+// --- Débit ---
+
+// Statut complet (le plus gros message) encodé, rendu puis décodé par le backend.
+// Repère, pas une mesure de la cible : l'ESP32 est ~20 fois plus lent que l'hôte
+static void test_throughput() {
+  const int COUNT = 2000;
+  const StatusMessage status = fullStatus();
+  StaticJsonDocument<STATUS_MESSAGE_DOC_SIZE> doc;
+  std::vector<uint8_t> buffer(2048);
+  TelemetryDecoder decoder;
+  const char* types[] = {"application/json", "application/msgpack"};
+  for (const char* contentType : types) {
+    bool msgpack = isMsgPackContentType(contentType);
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < COUNT; i++) {
+      encodeMessage(status, doc);
+      size_t length = msgpack ? serializeMsgPack(doc, buffer.data(), buffer.size())
+                              : serializeJson(doc, (char*)buffer.data(), buffer.size());
+      bytes += length;
+      TEST_ASSERT_EQUAL(TELEMETRY_STATUS, decoder.decode(contentType, buffer.data(), length));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double perSecond = COUNT / seconds;
+    printf("  %s : %.0f statuts/s, %zu octets/statut\n", contentType, perSecond, bytes / COUNT);
+    TEST_ASSERT_TRUE(perSecond > 1000);
+  }
+  TEST_ASSERT_TRUE(decoder.status == status);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_motion);
+  RUN_TEST(test_motion_batch);
+  RUN_TEST(test_session);
+  RUN_TEST(test_status);
+  RUN_TEST(test_twin_reported);
+  RUN_TEST(test_twin_desired);
+  RUN_TEST(test_c2d_command);
+  RUN_TEST(test_equality_sees_every_field);
+  RUN_TEST(test_host_decoder);
+  RUN_TEST(test_twin_desired_filter);
+  RUN_TEST(test_twin_desired_filter_capacity);
+  RUN_TEST(test_twin_get_filter);
+  RUN_TEST(test_twin_desired_wrong_type);
+  RUN_TEST(test_c2d_filter);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,157 @@
+#include <unity.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "message_schema.h"
+
+// === ENCODAGE MESSAGEPACK DE LA TÉLÉMÉTRIE ===
+
+void setUp() {}
+void tearDown() {}
+
+static std::vector<uint8_t> toMsgPack(const JsonDocument& doc) {
+  std::vector<uint8_t> bytes(measureMsgPack(doc));
+  size_t written = serializeMsgPack(doc, bytes.data(), bytes.size());
+  TEST_ASSERT_EQUAL(bytes.size(), written);
+  return bytes;
+}
+
+static std::string toJson(const JsonDocument& doc) {
+  std::string text;
+  serializeJson(doc, text);
+  return text;
+}
+
+// Le corps MessagePack se relit comme le même objet que sa forme JSON,
+// et sa longueur annoncée (publication en flux) est exacte
+static void checkSameAsJson(const JsonDocument& doc) {
+  std::vector<uint8_t> packed = toMsgPack(doc);
+  std::string json = toJson(doc);
+  TEST_ASSERT_TRUE(packed.size() < json.size());
+
+  DynamicJsonDocument back(8192);  // Clés et chaînes copiées
+  TEST_ASSERT_TRUE(deserializeMsgPack(back, (const char*)packed.data(), packed.size()) == DeserializationError::Ok);
+  TEST_ASSERT_EQUAL_STRING(json.c_str(), toJson(back).c_str());
+}
+
+static StatusMessage sampleStatus() {
+  StatusMessage status;
+  status.hasSeq = true;
+  status.seq = 1234;
+  status.firmware = "2.0.0";
+  status.uptime = 86400;
+  status.detectionEnabled = true;
+  status.cooldown = 5000;
+  status.detectionCount = 42;
+  status.powerMode = "modem";
+  status.system.rssi = -61;
+  status.system.freeHeap = 206624;
+  status.system.wifiReconnects = 3;
+  status.system.wakeupsPerSec = 0.4f;
+  status.system.lanes.motion.pending = 12;
+  status.system.lanes.motion.dropped = 1;
+  status.system.hasOutbox = true;
+  status.system.outbox.writeAmp = 1.25f;
+  return status;
+}
+
+static void test_motion() {
+  MotionMessage message;
+  message.seq = 17;
+  message.ts = 123456;
+  message.sensor = 2;
+  StaticJsonDocument<MOTION_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(encodeMessage(message, doc));
+  checkSameAsJson(doc);
+}
+
+// [ts, sensor] : tableau de deux éléments, pas d'objet par détection
+static void test_batch_tuples() {
+  MotionBatchMessage message;
+  message.seq = 18;
+  message.ts = 200000;
+  for (size_t i = 0; i < MOTION_BATCH_MESSAGE_DETECTIONS_MAX; i++) {
+    message.detections[i].ts = 100000 + (uint32_t)i * 250;
+    message.detections[i].sensor = (uint8_t)(i % 4);
+  }
+  message.detectionsCount = MOTION_BATCH_MESSAGE_DETECTIONS_MAX;
+  StaticJsonDocument<MOTION_BATCH_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(encodeMessage(message, doc));
+  checkSameAsJson(doc);
+
+  std::vector<uint8_t> packed = toMsgPack(doc);
+  const uint8_t tuple[] = {0x92, 0xCE, 0x00, 0x01, 0x86, 0xA0, 0x00};  // [100000, 0]
+  TEST_ASSERT_TRUE(std::search(packed.begin(), packed.end(), tuple, tuple + sizeof(tuple)) != packed.end());
+}
+
+static void test_session() {
+  SessionMessage message;
+  message.seq = 19;
+  message.hasStart = true;
+  message.start = 1700000000;
+  message.startMs = 5000;
+  message.dwell = 90000;
+  message.detections = 7;
+  message.retriggers = 3;
+  message.sensors = 0x5;
+  StaticJsonDocument<SESSION_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(encodeMessage(message, doc));
+  checkSameAsJson(doc);
+}
+
+static void test_status() {
+  StaticJsonDocument<STATUS_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(encodeMessage(sampleStatus(), doc));
+  checkSameAsJson(doc);
+}
+
+// seq au-delà de 32 bits : entier 64 bits (0xCF), jamais un flottant
+static void test_seq_64_bits() {
+  MotionMessage message;
+  message.seq = 0x123456789ULL;
+  StaticJsonDocument<MOTION_MESSAGE_DOC_SIZE> doc;
+  TEST_ASSERT_TRUE(encodeMessage(message, doc));
+  std::vector<uint8_t> packed = toMsgPack(doc);
+  const uint8_t seq[] = {0xA3, 's', 'e', 'q', 0xCF, 0x00, 0x00, 0x00, 0x01, 0x23, 0x45, 0x67, 0x89};
+  TEST_ASSERT_TRUE(std::search(packed.begin(), packed.end(), seq, seq + sizeof(seq)) != packed.end());
+
+  StaticJsonDocument<MOTION_MESSAGE_PARSE_SIZE> back;
+  TEST_ASSERT_TRUE(deserializeMsgPack(back, (const char*)packed.data(), packed.size()) == DeserializationError::Ok);
+  TEST_ASSERT_TRUE(back["seq"].as<uint64_t>() == 0x123456789ULL);
+}
+
+// Écrivain en flux (comme le client MQTT) : mêmes octets que vers un tampon
+struct StreamSink {
+  std::vector<uint8_t> bytes;
+  size_t write(uint8_t c) {
+    bytes.push_back(c);
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t length) {
+    bytes.insert(bytes.end(), data, data + length);
+    return length;
+  }
+};
+
+static void test_stream_matches_buffer() {
+  StreamSink sink;
+  StaticJsonDocument<STATUS_MESSAGE_DOC_SIZE> doc;
+  encodeMessage(sampleStatus(), doc);
+  serializeMsgPack(doc, sink);
+  std::vector<uint8_t> packed = toMsgPack(doc);
+  TEST_ASSERT_EQUAL(packed.size(), sink.bytes.size());
+  TEST_ASSERT_EQUAL_MEMORY(packed.data(), sink.bytes.data(), packed.size());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_motion);
+  RUN_TEST(test_batch_tuples);
+  RUN_TEST(test_session);
+  RUN_TEST(test_status);
+  RUN_TEST(test_seq_64_bits);
+  RUN_TEST(test_stream_matches_buffer);
+  return UNITY_END();
+}
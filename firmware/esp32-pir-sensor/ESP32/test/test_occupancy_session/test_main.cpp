@@ -0,0 +1,113 @@
+#include <unity.h>
+
+#include "occupancy_session.h"
+
+// === SESSIONS D'OCCUPATION ===
+
+static const uint64_t SEC = 1000000ULL;
+static const uint64_t IDLE = 60 * SEC;
+static const uint64_t MAX_DURATION = 3600 * SEC;
+
+void setUp() {}
+void tearDown() {}
+
+static void test_session_closes_after_idle_timeout() {
+  OccupancyEngine engine;
+  OccupancySession out;
+  engine.onMotionStart(0, 10 * SEC);
+  engine.onMotionEnd(0, 15 * SEC);
+  engine.onMotionStart(1, 20 * SEC);
+  engine.onActivity(1, 22 * SEC);
+  engine.onMotionEnd(1, 25 * SEC);
+
+  TEST_ASSERT_EQUAL_UINT64(25 * SEC + IDLE, engine.nextDeadlineUs(IDLE, MAX_DURATION));
+  TEST_ASSERT_FALSE(engine.poll(25 * SEC + IDLE - 1, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_TRUE(engine.poll(25 * SEC + IDLE, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_FALSE(out.partial);
+  TEST_ASSERT_EQUAL_UINT64(10 * SEC, out.startUs);
+  TEST_ASSERT_EQUAL_UINT32(15000, out.dwellMs());
+  TEST_ASSERT_EQUAL_UINT32(2, out.detections);
+  TEST_ASSERT_EQUAL_UINT32(2, out.retriggers);
+  TEST_ASSERT_EQUAL_UINT32(0x3, out.sensorMask);
+  TEST_ASSERT_FALSE(engine.isOpen());
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, engine.nextDeadlineUs(IDLE, MAX_DURATION));
+}
+
+// Aucune fermeture tant qu'un capteur est en mouvement
+static void test_no_close_while_active() {
+  OccupancyEngine engine;
+  OccupancySession out;
+  engine.onMotionStart(0, 10 * SEC);
+  TEST_ASSERT_FALSE(engine.poll(10 * SEC + 10 * IDLE, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_TRUE(engine.isOpen());
+}
+
+// Mouvement continu au-delà de maxDuration : session découpée
+static void test_split_while_active() {
+  OccupancyEngine engine;
+  OccupancySession out;
+  engine.onMotionStart(2, 10 * SEC);
+  TEST_ASSERT_EQUAL_UINT64(10 * SEC + MAX_DURATION, engine.nextDeadlineUs(IDLE, MAX_DURATION));
+  TEST_ASSERT_TRUE(engine.poll(10 * SEC + MAX_DURATION, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_TRUE(out.partial);
+  TEST_ASSERT_EQUAL_UINT32(3600000, out.dwellMs());
+  TEST_ASSERT_EQUAL_UINT32(1, out.detections);
+
+  // La suite repart de la découpe et garde le capteur actif
+  TEST_ASSERT_TRUE(engine.isOpen());
+  TEST_ASSERT_EQUAL_UINT32(1UL << 2, engine.current().sensorMask);
+  engine.onMotionEnd(2, 10 * SEC + MAX_DURATION + 5 * SEC);
+  TEST_ASSERT_TRUE(engine.poll(10 * SEC + MAX_DURATION + 5 * SEC + IDLE, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_FALSE(out.partial);
+  TEST_ASSERT_EQUAL_UINT32(5000, out.dwellMs());
+}
+
+// Pièce au repos quand maxDuration est atteint : pas de session vide,
+// la session se ferme normalement à l'expiration de idleTimeout
+static void test_no_empty_split_when_idle() {
+  OccupancyEngine engine;
+  OccupancySession out;
+  uint64_t start = 10 * SEC;
+  engine.onMotionStart(0, start);
+  engine.onMotionEnd(0, start + MAX_DURATION - 10 * SEC);
+
+  uint64_t idleDeadline = start + MAX_DURATION - 10 * SEC + IDLE;
+  TEST_ASSERT_EQUAL_UINT64(idleDeadline, engine.nextDeadlineUs(IDLE, MAX_DURATION));
+  TEST_ASSERT_FALSE(engine.poll(start + MAX_DURATION, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_TRUE(engine.poll(idleDeadline, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_FALSE(out.partial);
+  TEST_ASSERT_EQUAL_UINT32(1, out.detections);
+  TEST_ASSERT_FALSE(engine.isOpen());
+  TEST_ASSERT_FALSE(engine.poll(idleDeadline + MAX_DURATION, IDLE, MAX_DURATION, out));
+}
+
+static void test_all_motion_end() {
+  OccupancyEngine engine;
+  OccupancySession out;
+  engine.onMotionStart(0, 10 * SEC);
+  engine.onMotionStart(1, 11 * SEC);
+  engine.onAllMotionEnd(12 * SEC);
+  TEST_ASSERT_TRUE(engine.poll(12 * SEC + IDLE, IDLE, MAX_DURATION, out));
+  TEST_ASSERT_EQUAL_UINT32(2000, out.dwellMs());
+}
+
+// Activité sans session ouverte : ignorée
+static void test_activity_without_session() {
+  OccupancyEngine engine;
+  OccupancySession out;
+  engine.onActivity(0, 10 * SEC);
+  engine.onMotionEnd(0, 11 * SEC);
+  TEST_ASSERT_FALSE(engine.isOpen());
+  TEST_ASSERT_FALSE(engine.poll(11 * SEC + IDLE, IDLE, MAX_DURATION, out));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_session_closes_after_idle_timeout);
+  RUN_TEST(test_no_close_while_active);
+  RUN_TEST(test_split_while_active);
+  RUN_TEST(test_no_empty_split_when_idle);
+  RUN_TEST(test_all_motion_end);
+  RUN_TEST(test_activity_without_session);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+#include "pir_detector.h"
+
+// === BANC MULTI-PIR ===
+
+struct Event {
+  uint8_t sensor;
+  PirEvent event;
+  uint64_t timestampUs;
+  uint64_t cooldownRemainingUs;
+};
+
+struct Recorder {
+  std::vector<Event> events;
+  void operator()(uint8_t sensor, PirEvent event, uint64_t ts, uint64_t remaining) {
+    events.push_back({sensor, event, ts, remaining});
+  }
+};
+
+static constexpr uint8_t PINS[] = {4, 13, 27};
+
+typedef PirBank<3, DetectionParams, DebounceStage, CooldownStage> Bank;
+
+static uint32_t levelsOf(bool a, bool b, bool c) {
+  return (a ? 1UL << 4 : 0) | (b ? 1UL << 13 : 0) | (c ? 1UL << 27 : 0);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_pin_mask() {
+  static_assert(pirPinMask(PINS) == ((1UL << 4) | (1UL << 13) | (1UL << 27)), "masque");
+  static_assert(pirPinsValid(PINS), "broches valides");
+  static constexpr uint8_t badPins[] = {4, 34};
+  static_assert(!pirPinsValid(badPins), "GPIO34 hors registre 0-31");
+
+  Bank bank(PINS);
+  TEST_ASSERT_EQUAL_UINT32(pirPinMask(PINS), bank.pinMask());
+}
+
+static void test_sensor_index_from_bit() {
+  Bank bank(PINS);
+  Recorder rec;
+  bank.process({10000000, levelsOf(false, true, false)}, rec);
+  bank.process({11000000, levelsOf(false, false, false)}, rec);
+  bank.process({12000000, levelsOf(false, false, true)}, rec);
+
+  TEST_ASSERT_EQUAL(3, rec.events.size());
+  TEST_ASSERT_EQUAL_UINT8(1, rec.events[0].sensor);
+  TEST_ASSERT_EQUAL(PIR_EVENT_MOTION_START, rec.events[0].event);
+  TEST_ASSERT_EQUAL_UINT8(1, rec.events[1].sensor);
+  TEST_ASSERT_EQUAL(PIR_EVENT_MOTION_END, rec.events[1].event);
+  TEST_ASSERT_EQUAL_UINT8(2, rec.events[2].sensor);
+  TEST_ASSERT_EQUAL(PIR_EVENT_MOTION_START, rec.events[2].event);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 2, bank.motionMask());
+  TEST_ASSERT_TRUE(bank.motionInProgress(2));
+  TEST_ASSERT_FALSE(bank.motionInProgress(1));
+}
+
+// Plusieurs capteurs changent dans le même instantané du registre
+static void test_simultaneous_edges() {
+  Bank bank(PINS);
+  Recorder rec;
+  bank.process({10000000, levelsOf(true, true, true)}, rec);
+  TEST_ASSERT_EQUAL(3, rec.events.size());
+  for (uint8_t i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL_UINT8(i, rec.events[i].sensor);
+    TEST_ASSERT_EQUAL(PIR_EVENT_MOTION_START, rec.events[i].event);
+    TEST_ASSERT_EQUAL_UINT64(10000000, rec.events[i].timestampUs);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0x7, bank.motionMask());
+}
+
+// Les autres broches du registre GPIO n'ont aucun effet
+static void test_foreign_bits_ignored() {
+  Bank bank(PINS);
+  Recorder rec;
+  bank.process({1000000, ~levelsOf(true, true, true)}, rec);
+  bank.process({2000000, 0}, rec);
+  TEST_ASSERT_EQUAL(0, rec.events.size());
+}
+
+// Cooldown tenu séparément pour chaque capteur
+static void test_cooldown_per_sensor() {
+  Bank bank(PINS);
+  bank.params().cooldownUs = 5000000;
+  Recorder rec;
+  bank.process({10000000, levelsOf(true, false, false)}, rec);
+  bank.process({11000000, levelsOf(false, false, false)}, rec);
+  bank.process({12000000, levelsOf(true, false, false)}, rec);   // capteur 0 en cooldown
+  bank.process({12000000, levelsOf(true, true, false)}, rec);    // capteur 1 libre
+
+  TEST_ASSERT_EQUAL(4, rec.events.size());
+  TEST_ASSERT_EQUAL(PIR_EVENT_COOLDOWN_REJECTED, rec.events[2].event);
+  TEST_ASSERT_EQUAL_UINT8(0, rec.events[2].sensor);
+  TEST_ASSERT_EQUAL_UINT64(3000000, rec.events[2].cooldownRemainingUs);
+  TEST_ASSERT_EQUAL(PIR_EVENT_MOTION_START, rec.events[3].event);
+  TEST_ASSERT_EQUAL_UINT8(1, rec.events[3].sensor);
+}
+
+// resync() aligne les niveaux sans produire d'événement
+static void test_resync_is_silent() {
+  Bank bank(PINS);
+  Recorder rec;
+  bank.resync({1000000, levelsOf(true, false, true)});
+  bank.process({2000000, levelsOf(true, false, true)}, rec);
+  TEST_ASSERT_EQUAL(0, rec.events.size());
+  bank.process({3000000, levelsOf(false, false, true)}, rec);
+  TEST_ASSERT_EQUAL(0, rec.events.size());  // fin sans début : ignorée par le verrou
+  TEST_ASSERT_FALSE(bank.anyMotion());
+}
+
+// Coût par front quasi constant quel que soit le nombre de capteurs
+template <size_t N>
+static double nsPerEdge() {
+  static uint8_t pins[N];
+  for (size_t i = 0; i < N; i++) {
+    pins[i] = (uint8_t)i;
+  }
+  PirBank<N, DetectionParams, DebounceStage, CooldownStage> bank(pins);
+  bank.params().debounceUs = 1000;
+  bank.params().cooldownUs = 0;
+  uint32_t events = 0;
+  auto sink = [&](uint8_t, PirEvent, uint64_t, uint64_t) { events++; };
+
+  const uint32_t edges = 400000;
+  uint32_t levels = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < edges; i++) {
+    levels ^= 1UL << (i % N);
+    bank.process({10000000 + (uint64_t)i * 10000, levels}, sink);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  TEST_ASSERT_EQUAL_UINT32(edges, events);
+  return std::chrono::duration<double, std::nano>(elapsed).count() / edges;
+}
+
+static void test_cost_flat_with_sensor_count() {
+  double one = nsPerEdge<1>();
+  double eight = nsPerEdge<8>();
+  double thirtyTwo = nsPerEdge<32>();
+  printf("ns/front : 1=%.1f 8=%.1f 32=%.1f\n", one, eight, thirtyTwo);
+  TEST_ASSERT_TRUE(thirtyTwo < 4.0 * one + 20.0);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_pin_mask);
+  RUN_TEST(test_sensor_index_from_bit);
+  RUN_TEST(test_simultaneous_edges);
+  RUN_TEST(test_foreign_bits_ignored);
+  RUN_TEST(test_cooldown_per_sensor);
+  RUN_TEST(test_resync_is_silent);
+  RUN_TEST(test_cost_flat_with_sensor_count);
+  return UNITY_END();
+}
@@ -0,0 +1,93 @@
+#include <unity.h>
+
+#include <thread>
+
+#include "pir_edge_queue.h"
+
+// === FILE DE FRONTS PIR ===
+
+void setUp() {}
+void tearDown() {}
+
+static void test_fifo_order() {
+  PirEdgeQueue<8> queue;
+  TEST_ASSERT_TRUE(queue.empty());
+  for (uint32_t i = 0; i < 5; i++) {
+    TEST_ASSERT_TRUE(queue.push({1000ULL * i, i}));
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, queue.size());
+
+  PirEdge edge;
+  for (uint32_t i = 0; i < 5; i++) {
+    TEST_ASSERT_TRUE(queue.pop(edge));
+    TEST_ASSERT_EQUAL_UINT64(1000ULL * i, edge.timestampUs);
+    TEST_ASSERT_EQUAL_UINT32(i, edge.levels);
+  }
+  TEST_ASSERT_FALSE(queue.pop(edge));
+  TEST_ASSERT_TRUE(queue.empty());
+}
+
+static void test_full_queue_counts_drops() {
+  PirEdgeQueue<4> queue;
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(queue.push({i, i}));
+  }
+  TEST_ASSERT_FALSE(queue.push({99, 99}));
+  TEST_ASSERT_FALSE(queue.push({100, 100}));
+  TEST_ASSERT_EQUAL_UINT32(2, queue.dropped());
+  TEST_ASSERT_EQUAL_UINT32(4, queue.size());
+
+  // Les fronts perdus sont les plus récents : la file garde les plus anciens
+  PirEdge edge;
+  TEST_ASSERT_TRUE(queue.pop(edge));
+  TEST_ASSERT_EQUAL_UINT64(0, edge.timestampUs);
+  TEST_ASSERT_TRUE(queue.push({4, 4}));
+  TEST_ASSERT_EQUAL_UINT32(2, queue.dropped());
+}
+
+static void test_wraparound() {
+  PirEdgeQueue<4> queue;
+  PirEdge edge;
+  for (uint32_t i = 0; i < 1000; i++) {
+    TEST_ASSERT_TRUE(queue.push({i, i}));
+    if (i % 3 == 2) {
+      TEST_ASSERT_TRUE(queue.push({i, i + 1}));
+      TEST_ASSERT_TRUE(queue.pop(edge));
+    }
+    TEST_ASSERT_TRUE(queue.pop(edge));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, queue.dropped());
+}
+
+// Producteur et consommateur sur deux threads : aucun front perdu ni réordonné
+static void test_spsc_threads() {
+  static PirEdgeQueue<64> queue;
+  const uint32_t count = 200000;
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < count; i++) {
+      while (!queue.push({i, i})) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  PirEdge edge;
+  while (expected < count) {
+    if (queue.pop(edge)) {
+      TEST_ASSERT_EQUAL_UINT32(expected, edge.levels);
+      expected++;
+    }
+  }
+  producer.join();
+  TEST_ASSERT_TRUE(queue.empty());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fifo_order);
+  RUN_TEST(test_full_queue_counts_drops);
+  RUN_TEST(test_wraparound);
+  RUN_TEST(test_spsc_threads);
+  return UNITY_END();
+}
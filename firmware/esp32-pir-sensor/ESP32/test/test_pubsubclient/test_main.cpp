@@ -0,0 +1,413 @@
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include <PubSubClient.h>
+#include "fake_client.h"
+
+// === PUBSUBCLIENT EMBARQUÉ : LECTURE PAR BLOCS ===
+
+static int callbacks;
+static std::string lastTopic;
+static std::vector<uint8_t> lastPayload;
+static std::vector<uint16_t> pubAcks;
+
+static void onMessage(char* topic, uint8_t* payload, unsigned int length) {
+  callbacks++;
+  lastTopic = topic;
+  lastPayload.assign(payload, payload + length);
+}
+
+static void onPubAck(uint16_t packetId) {
+  pubAcks.push_back(packetId);
+}
+
+void setUp() {
+  fakeClock() = FakeClock();
+  callbacks = 0;
+  lastTopic.clear();
+  lastPayload.clear();
+  pubAcks.clear();
+}
+void tearDown() {}
+
+static std::vector<uint8_t> bytesOf(size_t length, uint8_t seed) {
+  std::vector<uint8_t> bytes(length);
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = (uint8_t)(seed + i * 7);
+  }
+  return bytes;
+}
+
+// Paquet PUBLISH reçu (QoS 1 si packetId != 0)
+static std::vector<uint8_t> publishPacket(const std::string& topic, const std::vector<uint8_t>& payload,
+                                          uint16_t packetId = 0) {
+  std::vector<uint8_t> body;
+  body.push_back((uint8_t)(topic.size() >> 8));
+  body.push_back((uint8_t)topic.size());
+  body.insert(body.end(), topic.begin(), topic.end());
+  if (packetId != 0) {
+    body.push_back((uint8_t)(packetId >> 8));
+    body.push_back((uint8_t)packetId);
+  }
+  body.insert(body.end(), payload.begin(), payload.end());
+
+  std::vector<uint8_t> packet;
+  packet.push_back(packetId != 0 ? (MQTTPUBLISH | MQTTQOS1) : MQTTPUBLISH);
+  size_t remaining = body.size();
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    packet.push_back(remaining > 0 ? (digit | 0x80) : digit);
+  } while (remaining > 0);
+  packet.insert(packet.end(), body.begin(), body.end());
+  return packet;
+}
+
+static void connectClient(PubSubClient& mqtt, FakeClient& client) {
+  mqtt.setServer("broker", 8883);
+  mqtt.setCallback(onMessage);
+  mqtt.setPubAckCallback(onPubAck);
+  client.receive({MQTTCONNACK, 2, 0, 0});
+  TEST_ASSERT_TRUE(mqtt.connect("device"));
+  client.written.clear();
+  client.readCalls = 0;
+  client.writeCalls = 0;
+}
+
+// Le corps arrive d'un bloc : un read() par octet d'en-tête, un seul pour le reste
+static void test_body_read_in_one_call() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  connectClient(mqtt, client);
+  std::vector<uint8_t> payload = bytesOf(600, 1);
+  client.receive(publishPacket("devices/d/messages/devicebound/x", payload));
+
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(1, callbacks);
+  TEST_ASSERT_EQUAL_STRING("devices/d/messages/devicebound/x", lastTopic.c_str());
+  TEST_ASSERT_TRUE(lastPayload == payload);
+  TEST_ASSERT_EQUAL(4, client.readCalls);  // Type, 2 octets de longueur, corps
+}
+
+// Corps réparti sur plusieurs enregistrements TLS : un read() par enregistrement
+static void test_body_split_across_records() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  connectClient(mqtt, client);
+  std::vector<uint8_t> payload = bytesOf(700, 3);
+  std::vector<uint8_t> packet = publishPacket("t", payload);
+  client.receiveSplit(packet, 128);
+
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(1, callbacks);
+  TEST_ASSERT_EQUAL_STRING("t", lastTopic.c_str());
+  TEST_ASSERT_TRUE(lastPayload == payload);
+  TEST_ASSERT_EQUAL(3 + (packet.size() + 127) / 128, client.readCalls);
+}
+
+// Identifiant de message lu dans le buffer : hors du payload, renvoyé dans le PUBACK
+static void test_qos1_message_id_and_puback() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  connectClient(mqtt, client);
+  std::vector<uint8_t> payload = bytesOf(40, 9);
+  client.receive(publishPacket("$iothub/twin/PATCH/properties/desired/?$version=3", payload, 0x1234));
+
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(1, callbacks);
+  TEST_ASSERT_EQUAL_STRING("$iothub/twin/PATCH/properties/desired/?$version=3", lastTopic.c_str());
+  TEST_ASSERT_TRUE(lastPayload == payload);
+  const std::vector<uint8_t> puback = {MQTTPUBACK, 2, 0x12, 0x34};
+  TEST_ASSERT_TRUE(client.written == puback);
+}
+
+static void test_puback_callback() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  connectClient(mqtt, client);
+  client.receive({MQTTPUBACK, 2, 0x01, 0x07});
+
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(1, pubAcks.size());
+  TEST_ASSERT_EQUAL(0x0107, pubAcks[0]);
+}
+
+// Plus grand que le buffer : lu jusqu'au bout et ignoré, le paquet suivant reste aligné
+static void test_oversized_packet_skipped() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  connectClient(mqtt, client);
+  client.receive(publishPacket("big", bytesOf(MQTT_MAX_PACKET_SIZE + 500, 5)));
+  std::vector<uint8_t> payload = bytesOf(20, 11);
+  client.receive(publishPacket("small", payload));
+
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(0, callbacks);
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(1, callbacks);
+  TEST_ASSERT_EQUAL_STRING("small", lastTopic.c_str());
+  TEST_ASSERT_TRUE(lastPayload == payload);
+}
+
+// Le délai de lecture repart à chaque bloc reçu, et un corps incomplet finit par expirer
+static void test_stalled_body_times_out() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  mqtt.setSocketTimeout(2);
+  connectClient(mqtt, client);
+  std::vector<uint8_t> packet = publishPacket("t", bytesOf(300, 2));
+  client.receive(std::vector<uint8_t>(packet.begin(), packet.begin() + 100));
+  client.receive(std::vector<uint8_t>(packet.begin() + 100, packet.begin() + 200), 1500);
+
+  unsigned long start = millis();
+  mqtt.loop();
+  TEST_ASSERT_EQUAL(0, callbacks);
+  TEST_ASSERT_TRUE(millis() - start >= 1500 + 2000);
+  TEST_ASSERT_TRUE(millis() - start < 1500 + 2100);
+}
+
+// === CONNEXION : ATTENTE DU CONNACK ===
+
+// connect() tourne dans sa propre tâche : il dort entre deux essais au lieu de tourner à vide
+static void test_connect_sleeps_until_connack() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  mqtt.setServer("broker", 8883);
+  client.receive({MQTTCONNACK, 2, 0, 0}, 250);
+
+  TEST_ASSERT_TRUE(mqtt.connect("device"));
+  TEST_ASSERT_EQUAL(MQTT_CONNECTED, mqtt.state());
+  TEST_ASSERT_EQUAL(250, millis());
+  TEST_ASSERT_EQUAL(250, fakeClock().delayCalls);
+  TEST_ASSERT_EQUAL(MQTTCONNECT, client.written[0]);
+}
+
+// CONNACK déjà là : pas d'attente
+static void test_connect_without_wait() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  mqtt.setServer("broker", 8883);
+  client.receive({MQTTCONNACK, 2, 0, 0});
+
+  TEST_ASSERT_TRUE(mqtt.connect("device"));
+  TEST_ASSERT_EQUAL(0, fakeClock().delayCalls);
+}
+
+// Pas de CONNACK : abandon après socketTimeout, toujours en dormant
+static void test_connect_times_out() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  mqtt.setServer("broker", 8883);
+  mqtt.setSocketTimeout(3);
+
+  TEST_ASSERT_FALSE(mqtt.connect("device"));
+  TEST_ASSERT_EQUAL(MQTT_CONNECTION_TIMEOUT, mqtt.state());
+  TEST_ASSERT_EQUAL(3000, millis());
+  TEST_ASSERT_EQUAL(3000, fakeClock().delayCalls);
+  TEST_ASSERT_EQUAL(0, fakeClock().yieldCalls);
+  TEST_ASSERT_EQUAL(1, client.stopCalls);
+}
+
+// CONNACK de refus (code 5 : non autorisé) : état renvoyé, connexion fermée
+static void test_connect_refused() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  mqtt.setServer("broker", 8883);
+  client.receive({MQTTCONNACK, 2, 0, 5}, 10);
+
+  TEST_ASSERT_FALSE(mqtt.connect("device"));
+  TEST_ASSERT_EQUAL(5, mqtt.state());
+  TEST_ASSERT_FALSE(client.connected());
+}
+
+// === REGROUPEMENT DES ÉCRITURES ===
+
+static const size_t PUBLISH_SIZE = 2 + 2 + 5 + 40;  // En-tête, longueur du topic, "topic", payload
+
+static void publishSample(PubSubClient& mqtt) {
+  std::vector<uint8_t> payload = bytesOf(40, 4);
+  TEST_ASSERT_TRUE(mqtt.publish("topic", payload.data(), payload.size()));
+}
+
+// Sans buffer d'écriture (défaut) : un write() par paquet
+static void test_no_write_buffer() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  connectClient(mqtt, client);
+  publishSample(mqtt);
+  publishSample(mqtt);
+  TEST_ASSERT_EQUAL(2, client.writeCalls);
+  TEST_ASSERT_EQUAL(2 * PUBLISH_SIZE, client.written.size());
+}
+
+static void test_packets_combined_until_flush() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(4096, 20));
+  connectClient(mqtt, client);
+  for (int i = 0; i < 3; i++) {
+    publishSample(mqtt);
+  }
+  TEST_ASSERT_EQUAL(0, client.writeCalls);
+
+  TEST_ASSERT_TRUE(mqtt.flushWrites());
+  TEST_ASSERT_EQUAL(1, client.writeCalls);
+  TEST_ASSERT_EQUAL(3 * PUBLISH_SIZE, client.written.size());
+  TEST_ASSERT_EQUAL(MQTTPUBLISH, client.written[0]);
+  TEST_ASSERT_EQUAL(MQTTPUBLISH, client.written[2 * PUBLISH_SIZE]);
+
+  // Rien en attente : pas d'écriture vide
+  TEST_ASSERT_TRUE(mqtt.flushWrites());
+  TEST_ASSERT_EQUAL(1, client.writeCalls);
+}
+
+// CONNECT part tout de suite : le CONNACK en dépend
+static void test_connect_not_buffered() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(4096, 20));
+  mqtt.setServer("broker", 8883);
+  client.receive({MQTTCONNACK, 2, 0, 0}, 5);
+  TEST_ASSERT_TRUE(mqtt.connect("device"));
+  TEST_ASSERT_EQUAL(1, client.writeCalls);
+  TEST_ASSERT_EQUAL(MQTTCONNECT, client.written[0]);
+}
+
+// loop() écrit le buffer quand son premier octet a flushDelay ms
+static void test_loop_flushes_after_delay() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(4096, 20));
+  connectClient(mqtt, client);
+  TEST_ASSERT_EQUAL_UINT32(1000, mqtt.msUntilFlush(1000));
+
+  publishSample(mqtt);
+  fakeClock().now += 10;
+  publishSample(mqtt);
+  TEST_ASSERT_EQUAL_UINT32(10, mqtt.msUntilFlush(1000));
+  TEST_ASSERT_EQUAL_UINT32(5, mqtt.msUntilFlush(5));
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(0, client.writeCalls);
+
+  fakeClock().now += 10;
+  TEST_ASSERT_EQUAL_UINT32(0, mqtt.msUntilFlush(1000));
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(1, client.writeCalls);
+  TEST_ASSERT_EQUAL(2 * PUBLISH_SIZE, client.written.size());
+  TEST_ASSERT_EQUAL_UINT32(1000, mqtt.msUntilFlush(1000));
+}
+
+// Buffer plein : écrit aussitôt, le paquet continue dans le buffer vidé
+static void test_full_buffer_written_at_once() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(64, 20));
+  connectClient(mqtt, client);
+  for (int i = 0; i < 3; i++) {
+    publishSample(mqtt);
+  }
+  TEST_ASSERT_EQUAL(3 * PUBLISH_SIZE / 64, client.writeCalls);
+  TEST_ASSERT_EQUAL(3 * PUBLISH_SIZE / 64 * 64, client.written.size());
+
+  TEST_ASSERT_TRUE(mqtt.flushWrites());
+  TEST_ASSERT_EQUAL(3 * PUBLISH_SIZE, client.written.size());
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL(MQTTPUBLISH, client.written[i * PUBLISH_SIZE]);
+    TEST_ASSERT_EQUAL(PUBLISH_SIZE - 2, client.written[i * PUBLISH_SIZE + 1]);
+  }
+}
+
+// Publication en flux (beginPublish / write / endPublish) : même buffer
+static void test_streamed_publish_buffered() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(4096, 20));
+  connectClient(mqtt, client);
+  std::vector<uint8_t> payload = bytesOf(40, 4);
+  TEST_ASSERT_TRUE(mqtt.beginPublish("topic", payload.size(), false));
+  TEST_ASSERT_EQUAL(20, mqtt.write(payload.data(), 20));
+  for (size_t i = 20; i < payload.size(); i++) {
+    TEST_ASSERT_EQUAL(1, mqtt.write(payload[i]));
+  }
+  TEST_ASSERT_EQUAL(1, mqtt.endPublish());
+  publishSample(mqtt);
+  TEST_ASSERT_EQUAL(0, client.writeCalls);
+
+  TEST_ASSERT_TRUE(mqtt.flushWrites());
+  TEST_ASSERT_EQUAL(1, client.writeCalls);
+  TEST_ASSERT_TRUE(std::vector<uint8_t>(client.written.begin(), client.written.begin() + PUBLISH_SIZE) ==
+                   std::vector<uint8_t>(client.written.begin() + PUBLISH_SIZE, client.written.end()));
+}
+
+// Le PUBACK d'un message reçu attend avec le reste
+static void test_puback_reply_buffered() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(4096, 20));
+  connectClient(mqtt, client);
+  client.receive(publishPacket("t", bytesOf(10, 1), 0x0A0B));
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_EQUAL(1, callbacks);
+  TEST_ASSERT_EQUAL(0, client.writeCalls);
+
+  TEST_ASSERT_TRUE(mqtt.flushWrites());
+  const std::vector<uint8_t> puback = {MQTTPUBACK, 2, 0x0A, 0x0B};
+  TEST_ASSERT_TRUE(client.written == puback);
+}
+
+// Écriture partielle : le flux MQTT ne peut pas reprendre, la connexion est fermée
+static void test_partial_write_closes_connection() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(4096, 20));
+  connectClient(mqtt, client);
+  publishSample(mqtt);
+  client.writeLimit = 10;
+
+  TEST_ASSERT_FALSE(mqtt.flushWrites());
+  TEST_ASSERT_EQUAL(1, client.stopCalls);
+  TEST_ASSERT_FALSE(mqtt.connected());
+  TEST_ASSERT_FALSE(mqtt.loop());
+}
+
+// Buffer plein écrit en partie pendant un publish : le buffer est vide
+// ensuite, seul connected() dit que les paquets précédents sont perdus
+static void test_partial_write_of_full_buffer() {
+  FakeClient client;
+  PubSubClient mqtt(client);
+  TEST_ASSERT_TRUE(mqtt.setWriteBuffer(64, 20));
+  connectClient(mqtt, client);
+  publishSample(mqtt);
+  client.writeLimit = 10;
+  std::vector<uint8_t> payload = bytesOf(40, 4);
+  TEST_ASSERT_FALSE(mqtt.publish("topic", payload.data(), payload.size()));
+
+  TEST_ASSERT_TRUE(mqtt.flushWrites());
+  TEST_ASSERT_FALSE(mqtt.connected());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_body_read_in_one_call);
+  RUN_TEST(test_body_split_across_records);
+  RUN_TEST(test_qos1_message_id_and_puback);
+  RUN_TEST(test_puback_callback);
+  RUN_TEST(test_oversized_packet_skipped);
+  RUN_TEST(test_stalled_body_times_out);
+  RUN_TEST(test_connect_sleeps_until_connack);
+  RUN_TEST(test_connect_without_wait);
+  RUN_TEST(test_connect_times_out);
+  RUN_TEST(test_connect_refused);
+  RUN_TEST(test_no_write_buffer);
+  RUN_TEST(test_packets_combined_until_flush);
+  RUN_TEST(test_connect_not_buffered);
+  RUN_TEST(test_loop_flushes_after_delay);
+  RUN_TEST(test_full_buffer_written_at_once);
+  RUN_TEST(test_streamed_publish_buffered);
+  RUN_TEST(test_puback_reply_buffered);
+  RUN_TEST(test_partial_write_closes_connection);
+  RUN_TEST(test_partial_write_of_full_buffer);
+  return UNITY_END();
+}
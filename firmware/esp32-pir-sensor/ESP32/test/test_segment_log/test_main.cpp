@@ -0,0 +1,491 @@
+#include <unity.h>
+
+#include <deque>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "segment_log.h"
+
+// === JOURNAL PERSISTANT EN FLASH ===
+
+// Flash NOR en RAM : une écriture ne fait passer des bits que de 1 à 0
+struct RamFlash {
+  std::vector<uint8_t> mem;
+  size_t writes = 0;
+
+  explicit RamFlash(size_t bytes) : mem(bytes, 0xFF) {}
+  size_t size() const { return mem.size(); }
+  bool read(size_t offset, void* dst, size_t length) {
+    if (offset + length > mem.size()) {
+      return false;
+    }
+    memcpy(dst, &mem[offset], length);
+    return true;
+  }
+  bool write(size_t offset, const void* src, size_t length) {
+    if (offset + length > mem.size()) {
+      return false;
+    }
+    const uint8_t* p = (const uint8_t*)src;
+    for (size_t i = 0; i < length; i++) {
+      mem[offset + i] &= p[i];
+    }
+    writes++;
+    return true;
+  }
+  bool eraseSector(size_t offset) {
+    memset(&mem[offset], 0xFF, SEGMENT_LOG_SECTOR_SIZE);
+    return true;
+  }
+};
+
+typedef SegmentLog<RamFlash, 1024> Log;
+
+static uint8_t payload[Log::maxPayload()];
+
+static void append(Log& log, const std::string& text, uint8_t type = 1) {
+  TEST_ASSERT_TRUE(log.append(type, (const uint8_t*)text.data(), text.size()));
+}
+
+static std::string peekText(Log& log) {
+  LogRecordInfo info;
+  if (!log.peek(info, payload)) {
+    return "";
+  }
+  return std::string((const char*)payload, info.length);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_format_append_read() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  append(log, "one");
+  append(log, "two", 3);
+  TEST_ASSERT_EQUAL(2, log.pending());
+  TEST_ASSERT_EQUAL_STRING("", peekText(log).c_str());  // Rien en flash avant flush()
+
+  size_t writes = flash.writes;
+  TEST_ASSERT_TRUE(log.flush());
+  TEST_ASSERT_EQUAL(writes + 1, flash.writes);  // Un lot = une écriture
+
+  LogRecordInfo info;
+  TEST_ASSERT_TRUE(log.peek(info, payload));
+  TEST_ASSERT_EQUAL_UINT8(1, info.type);
+  log.consume();
+  TEST_ASSERT_TRUE(log.peek(info, payload));
+  TEST_ASSERT_EQUAL_UINT8(3, info.type);
+  TEST_ASSERT_EQUAL_MEMORY("two", payload, 3);
+  log.consume();
+  TEST_ASSERT_FALSE(log.peek(info, payload));
+  TEST_ASSERT_EQUAL(0, log.pending());
+}
+
+// Au remontage, seul ce qui suit la dernière marque est renvoyé
+static void test_remount_resumes_after_commit() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  {
+    Log log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (int i = 0; i < 5; i++) {
+      append(log, "msg" + std::to_string(i));
+    }
+    log.flush();
+    for (int i = 0; i < 3; i++) {
+      peekText(log);
+      log.consume();
+    }
+    TEST_ASSERT_TRUE(log.commit());
+    peekText(log);
+    log.consume();  // Consommé sans marque : renvoyé après un redémarrage
+  }
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL(2, log.pending());
+  TEST_ASSERT_EQUAL_STRING("msg3", peekText(log).c_str());
+}
+
+// Enregistrement abîmé : ignoré, sans fausser le compte des messages en attente
+static void test_corrupt_record_keeps_pending_exact() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  {
+    Log log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    append(log, "first-record");
+    append(log, "second-record");
+    append(log, "third-record");
+    log.flush();
+  }
+  // Payload du premier enregistrement (en-tête de segment 16 + en-tête 8)
+  flash.mem[16 + 8 + 2] ^= 0x01;
+
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL(2, log.pending());
+  TEST_ASSERT_EQUAL_STRING("second-record", peekText(log).c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, log.corrupt());
+  TEST_ASSERT_EQUAL(2, log.pending());
+  log.consume();
+  TEST_ASSERT_EQUAL(1, log.pending());
+  TEST_ASSERT_EQUAL_STRING("third-record", peekText(log).c_str());
+  log.consume();
+  TEST_ASSERT_EQUAL(0, log.pending());
+}
+
+// Journal plein : le segment le plus ancien est sacrifié
+static void test_full_log_drops_oldest_segment() {
+  RamFlash flash(3 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  std::string filler(500, 'x');
+  int written = 0;
+  while (log.dropped() == 0) {
+    append(log, std::to_string(written++) + filler);
+    log.flush();
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(0, log.dropped());
+  TEST_ASSERT_EQUAL(written - log.dropped(), log.pending());
+
+  // La lecture reprend au premier enregistrement survivant, dans l'ordre
+  int expected = (int)log.dropped();
+  while (log.pending() > 0) {
+    std::string text = peekText(log);
+    TEST_ASSERT_EQUAL(expected++, atoi(text.c_str()));
+    log.consume();
+  }
+  TEST_ASSERT_EQUAL(written, expected);
+}
+
+// PUBACK reçu après d'autres lectures : marque jusqu'à la position lue
+static void test_commit_through_position() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  {
+    Log log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (int i = 0; i < 4; i++) {
+      append(log, "m" + std::to_string(i));
+    }
+    log.flush();
+    LogPosition positions[4];
+    for (int i = 0; i < 4; i++) {
+      peekText(log);
+      positions[i] = log.position();
+      log.consume();
+    }
+    TEST_ASSERT_TRUE(log.commitThrough(positions[1]));
+  }
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL(2, log.pending());
+  TEST_ASSERT_EQUAL_STRING("m2", peekText(log).c_str());
+}
+
+// Lit `count` enregistrements et garde leur position (fenêtre QoS 1)
+static std::vector<LogPosition> readPositions(Log& log, size_t count) {
+  std::vector<LogPosition> positions;
+  for (size_t i = 0; i < count && log.pending() > 0; i++) {
+    peekText(log);
+    positions.push_back(log.position());
+    log.consume();
+  }
+  return positions;
+}
+
+// Position dans un segment déjà quitté par la lecture
+static void test_commit_through_previous_segment() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  std::string filler(900, 'x');
+  {
+    Log log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (int i = 0; i < 8; i++) {
+      append(log, std::to_string(i) + filler);
+      log.flush();
+    }
+    std::vector<LogPosition> positions = readPositions(log, 6);
+    TEST_ASSERT_TRUE(positions[5].segmentSeq != positions[2].segmentSeq);
+    TEST_ASSERT_TRUE(log.commitThrough(positions[2]));
+  }
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL(5, log.pending());
+  TEST_ASSERT_EQUAL(3, atoi(peekText(log).c_str()));
+}
+
+// PUBACK de la dernière lecture : le commit() suivant n'écrit plus rien
+static void test_commit_through_last_read_settles_commit() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  append(log, "a");
+  append(log, "b");
+  log.flush();
+  std::vector<LogPosition> positions = readPositions(log, 2);
+  TEST_ASSERT_TRUE(log.commitThrough(positions[1]));
+  size_t writes = flash.writes;
+  TEST_ASSERT_TRUE(log.commit());
+  TEST_ASSERT_EQUAL(writes, flash.writes);
+}
+
+// Segment recyclé entre la lecture et le PUBACK (journal plein) : sans effet
+static void test_commit_through_recycled_segment() {
+  RamFlash flash(3 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  std::string filler(500, 'x');
+  int written = 0;
+  append(log, std::to_string(written++) + filler);
+  log.flush();
+  std::vector<LogPosition> positions = readPositions(log, 1);
+  while (log.dropped() == 0) {
+    append(log, std::to_string(written++) + filler);
+    log.flush();
+  }
+  size_t pending = log.pending();
+  size_t writes = flash.writes;
+  TEST_ASSERT_TRUE(log.commitThrough(positions[0]));
+  TEST_ASSERT_EQUAL(writes, flash.writes);
+  TEST_ASSERT_EQUAL(pending, log.pending());
+
+  Log remounted(flash);
+  TEST_ASSERT_TRUE(remounted.mount());
+  TEST_ASSERT_EQUAL(pending, remounted.pending());
+}
+
+// PUBACK dans le désordre : une position antérieure ne fait pas reculer la marque
+static void test_commit_through_out_of_order() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  {
+    Log log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (int i = 0; i < 5; i++) {
+      append(log, "m" + std::to_string(i));
+    }
+    log.flush();
+    std::vector<LogPosition> positions = readPositions(log, 4);
+    TEST_ASSERT_TRUE(log.commitThrough(positions[3]));
+    TEST_ASSERT_TRUE(log.commitThrough(positions[1]));
+  }
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL(1, log.pending());
+  TEST_ASSERT_EQUAL_STRING("m4", peekText(log).c_str());
+}
+
+static void test_commit_through_unmounted() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  append(log, "a");
+  log.flush();
+  std::vector<LogPosition> positions = readPositions(log, 1);
+  log.unmount();
+  size_t writes = flash.writes;
+  TEST_ASSERT_TRUE(log.commitThrough(positions[0]));
+  TEST_ASSERT_EQUAL(writes, flash.writes);
+}
+
+// Envoi regroupé qui échoue : la lecture revient à la marque, pending compris,
+// et la marque de consommation déjà en attente est conservée
+static void test_rewind_rereads_consumed() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  for (int i = 0; i < 6; i++) {
+    append(log, "m" + std::to_string(i));
+  }
+  log.flush();
+  TEST_ASSERT_EQUAL_STRING("m0", peekText(log).c_str());
+  log.consume();
+
+  LogReadMark mark = log.readMark();
+  for (int i = 1; i < 4; i++) {
+    TEST_ASSERT_EQUAL_STRING(("m" + std::to_string(i)).c_str(), peekText(log).c_str());
+    log.consume();
+  }
+  TEST_ASSERT_EQUAL(2, log.pending());
+  append(log, "m6");
+  log.flush();
+
+  TEST_ASSERT_TRUE(log.rewind(mark));
+  TEST_ASSERT_EQUAL(6, log.pending());
+  TEST_ASSERT_EQUAL_STRING("m1", peekText(log).c_str());
+
+  // Le commit ne marque que m0, consommé avant la marque
+  TEST_ASSERT_TRUE(log.commit());
+  Log remounted(flash);
+  TEST_ASSERT_TRUE(remounted.mount());
+  TEST_ASSERT_EQUAL(6, remounted.pending());
+  TEST_ASSERT_EQUAL_STRING("m1", peekText(remounted).c_str());
+}
+
+static void test_rewind_recycled_segment() {
+  RamFlash flash(3 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  std::string filler(500, 'x');
+  int written = 0;
+  append(log, std::to_string(written++) + filler);
+  log.flush();
+  peekText(log);
+  LogReadMark mark = log.readMark();
+  log.consume();
+  while (log.dropped() == 0) {
+    append(log, std::to_string(written++) + filler);
+    log.flush();
+  }
+  size_t pending = log.pending();
+  std::string front = peekText(log);
+  TEST_ASSERT_FALSE(log.rewind(mark));
+  TEST_ASSERT_EQUAL(pending, log.pending());
+  TEST_ASSERT_EQUAL_STRING(front.c_str(), peekText(log).c_str());
+}
+
+static void test_discard_all() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  {
+    Log log(flash);
+    TEST_ASSERT_TRUE(log.mount());
+    append(log, "a");
+    append(log, "b");
+    log.flush();
+    append(log, "staged");
+    log.discardAll();
+    TEST_ASSERT_EQUAL(0, log.pending());
+  }
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL(0, log.pending());
+}
+
+static void test_too_large() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  std::string big(Log::maxPayload() + 1, 'z');
+  TEST_ASSERT_FALSE(log.append(1, (const uint8_t*)big.data(), big.size()));
+  TEST_ASSERT_EQUAL_UINT32(1, log.tooLarge());
+}
+
+// Zone déplacée ou ancien firmware : les segments d'un autre format sont effacés
+static void test_foreign_layout_erased() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  {
+    Log log(flash, 1);
+    TEST_ASSERT_TRUE(log.mount());
+    for (int i = 0; i < 5; i++) {  // 4 par segment : deux segments
+      append(log, std::string(1000, 'a' + i));
+      log.flush();
+    }
+  }
+  Log log(flash, 2);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL(0, log.pending());
+  TEST_ASSERT_EQUAL_UINT32(2, log.foreignSegments());
+  append(log, "new");
+  log.flush();
+
+  // Plus rien de l'ancien format au montage suivant
+  Log again(flash, 2);
+  TEST_ASSERT_TRUE(again.mount());
+  TEST_ASSERT_EQUAL_UINT32(0, again.foreignSegments());
+  TEST_ASSERT_EQUAL(1, again.pending());
+  TEST_ASSERT_EQUAL_STRING("new", peekText(again).c_str());
+}
+
+// Segment sans identifiant de format (champ resté à 0xFFFFFFFF) : effacé
+// comme un autre format
+static void test_untagged_segments_erased() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  {
+    Log log(flash, 7);
+    TEST_ASSERT_TRUE(log.mount());
+    append(log, "old");
+    log.flush();
+  }
+  memset(&flash.mem[12], 0xFF, 4);
+  Log log(flash, 7);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL_UINT32(1, log.foreignSegments());
+  TEST_ASSERT_EQUAL(0, log.pending());
+  append(log, "new");
+  log.flush();
+
+  Log again(flash, 7);
+  TEST_ASSERT_TRUE(again.mount());
+  TEST_ASSERT_EQUAL(1, again.pending());
+  TEST_ASSERT_EQUAL_STRING("new", peekText(again).c_str());
+}
+
+static void test_unmount() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  Log log(flash);
+  TEST_ASSERT_TRUE(log.mount());
+  append(log, "staged");
+  log.unmount();
+  TEST_ASSERT_FALSE(log.mounted());
+  TEST_ASSERT_EQUAL(0, log.pending());
+}
+
+// Ajouts, lectures, marques et redémarrages aléatoires : jamais de perte
+// hors journal plein, jamais de désordre
+static void test_random_with_remounts() {
+  RamFlash flash(4 * SEGMENT_LOG_SECTOR_SIZE);
+  Log* log = new Log(flash);
+  TEST_ASSERT_TRUE(log->mount());
+  std::mt19937 rng(3);
+  int next = 0;
+  int lastRead = -1;
+  for (int step = 0; step < 20000; step++) {
+    uint32_t op = rng() % 100;
+    if (op < 60) {
+      append(*log, std::to_string(next++) + std::string(rng() % 200, 'p'));
+    } else if (op < 70) {
+      log->flush();
+    } else if (op < 90) {
+      std::string text = peekText(*log);
+      if (!text.empty()) {
+        int id = atoi(text.c_str());
+        TEST_ASSERT_TRUE(id > lastRead);
+        lastRead = id;
+        log->consume();
+      }
+    } else if (op < 98) {
+      TEST_ASSERT_TRUE(log->commit());
+    } else {
+      log->flush();
+      delete log;
+      log = new Log(flash);
+      TEST_ASSERT_TRUE(log->mount());
+      lastRead = -1;  // Les consommés non marqués sont renvoyés
+    }
+  }
+  delete log;
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_format_append_read);
+  RUN_TEST(test_remount_resumes_after_commit);
+  RUN_TEST(test_corrupt_record_keeps_pending_exact);
+  RUN_TEST(test_full_log_drops_oldest_segment);
+  RUN_TEST(test_commit_through_position);
+  RUN_TEST(test_commit_through_previous_segment);
+  RUN_TEST(test_commit_through_last_read_settles_commit);
+  RUN_TEST(test_commit_through_recycled_segment);
+  RUN_TEST(test_commit_through_out_of_order);
+  RUN_TEST(test_commit_through_unmounted);
+  RUN_TEST(test_rewind_rereads_consumed);
+  RUN_TEST(test_rewind_recycled_segment);
+  RUN_TEST(test_discard_all);
+  RUN_TEST(test_too_large);
+  RUN_TEST(test_foreign_layout_erased);
+  RUN_TEST(test_untagged_segments_erased);
+  RUN_TEST(test_unmount);
+  RUN_TEST(test_random_with_remounts);
+  return UNITY_END();
+}
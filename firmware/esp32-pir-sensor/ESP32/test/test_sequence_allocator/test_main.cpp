@@ -0,0 +1,145 @@
+#include <unity.h>
+
+#include "sequence_allocator.h"
+
+// === NUMÉROS DE SÉQUENCE PERSISTANTS ===
+
+// NVS simulée : garde la dernière valeur écrite, peut refuser les écritures
+struct MemoryStore {
+  bool stored = false;
+  uint64_t value = 0;
+  bool failWrites = false;
+  uint32_t saves = 0;
+
+  bool load(uint64_t& out) {
+    if (!stored) {
+      return false;
+    }
+    out = value;
+    return true;
+  }
+  bool save(uint64_t in) {
+    if (failWrites) {
+      return false;
+    }
+    stored = true;
+    value = in;
+    saves++;
+    return true;
+  }
+};
+
+typedef SequenceAllocator<MemoryStore> Allocator;
+
+void setUp() {}
+void tearDown() {}
+
+static void test_block_reservation() {
+  MemoryStore store;
+  Allocator sequence(store, 100);
+  TEST_ASSERT_TRUE(sequence.begin());
+  TEST_ASSERT_TRUE(store.value == 100);
+  for (uint64_t i = 0; i < 250; i++) {
+    TEST_ASSERT_TRUE(sequence.next() == i);
+  }
+  // Une écriture par bloc entamé
+  TEST_ASSERT_EQUAL_UINT32(3, sequence.writes());
+  TEST_ASSERT_TRUE(store.value == 300);
+}
+
+// Redémarrage non prévu : reprise à la fin du bloc, jamais de numéro réutilisé
+static void test_unplanned_restart_skips_block() {
+  MemoryStore store;
+  {
+    Allocator sequence(store, 100);
+    sequence.begin();
+    for (int i = 0; i < 42; i++) {
+      sequence.next();
+    }
+  }
+  Allocator sequence(store, 100);
+  sequence.begin();
+  TEST_ASSERT_TRUE(sequence.next() == 100);
+}
+
+// Redémarrage prévu : position exacte, pas de trou
+static void test_persist_keeps_exact_position() {
+  MemoryStore store;
+  {
+    Allocator sequence(store, 100);
+    sequence.begin();
+    for (int i = 0; i < 42; i++) {
+      sequence.next();
+    }
+    TEST_ASSERT_TRUE(sequence.persist());
+  }
+  Allocator sequence(store, 100);
+  sequence.begin();
+  TEST_ASSERT_TRUE(sequence.next() == 42);
+}
+
+static void test_release_last_only() {
+  MemoryStore store;
+  Allocator sequence(store, 100);
+  sequence.begin();
+  uint64_t a = sequence.next();
+  uint64_t b = sequence.next();
+  TEST_ASSERT_FALSE(sequence.release(a));
+  TEST_ASSERT_TRUE(sequence.release(b));
+  TEST_ASSERT_TRUE(sequence.next() == b);
+}
+
+// Réveil de deep sleep : aucun accès au stockage
+static void test_resume_without_store() {
+  MemoryStore store;
+  Allocator sequence(store, 100);
+  sequence.resume(150, 200);
+  TEST_ASSERT_TRUE(sequence.next() == 150);
+  TEST_ASSERT_EQUAL_UINT32(0, store.saves);
+  TEST_ASSERT_TRUE(sequence.reservedEnd() == 200);
+}
+
+// Écriture refusée : le bloc est distribué quand même
+static void test_failed_write_still_numbers() {
+  MemoryStore store;
+  store.failWrites = true;
+  Allocator sequence(store, 10);
+  TEST_ASSERT_FALSE(sequence.begin());
+  for (uint64_t i = 0; i < 25; i++) {
+    TEST_ASSERT_TRUE(sequence.next() == i);
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, sequence.failedWrites());
+  TEST_ASSERT_EQUAL_UINT32(0, sequence.writes());
+}
+
+// Longue série avec redémarrages : numéros strictement croissants
+static void test_monotonic_across_restarts() {
+  MemoryStore store;
+  uint64_t last = 0;
+  bool first = true;
+  for (int boot = 0; boot < 50; boot++) {
+    Allocator sequence(store, 1000);
+    sequence.begin();
+    for (int i = 0; i < 337 * (boot % 5); i++) {
+      uint64_t seq = sequence.next();
+      TEST_ASSERT_TRUE(first || seq > last);
+      last = seq;
+      first = false;
+    }
+    if (boot % 3 == 0) {
+      sequence.persist();
+    }
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_block_reservation);
+  RUN_TEST(test_unplanned_restart_skips_block);
+  RUN_TEST(test_persist_keeps_exact_position);
+  RUN_TEST(test_release_last_only);
+  RUN_TEST(test_resume_without_store);
+  RUN_TEST(test_failed_write_still_numbers);
+  RUN_TEST(test_monotonic_across_restarts);
+  return UNITY_END();
+}